@@ -0,0 +1,426 @@
+//===- Benchmark.cpp ------------------------------------------------------===//
+//
+// Microbenchmarks of the hot paths of lsmmap. Each benchmark runs against
+// generated proc trees (see Fixture.h) of several sizes and the results are
+// written as JSON to stdout.
+//
+// Next to the times the number of heap allocations of each run is recorded by
+// replacing the global operator new.
+//
+// Usage:
+// lsmmap-bench [ -s <pages>[,<pages>...] ] [ -r <ranges> ] [ -i <iterations> ]
+//              [ -d <directory> ] [ -k ]
+//
+//===----------------------------------------------------------------------===//
+
+#include "CmdOptions.h"
+#include "Fixture.h"
+#include "Output.h"
+#include "PageVisitor.h"
+#include "PMemory.h"
+#include "Process.h"
+#include "Scanner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ftw.h>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Number of ranges of the generated process. The number of pages per range is
+// derived from the requested total number of pages.
+static const unsigned bench_num_ranges = 64;
+
+// Number of heap allocations since the start of the program
+static std::atomic<uint64_t> bench_allocations(0);
+
+void* operator new(std::size_t size) {
+  bench_allocations.fetch_add(1, std::memory_order_relaxed);
+  void *ptr = malloc((size > 0) ? size : 1);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+  free(ptr);
+}
+
+/**
+ * A stream buffer that discards everything written to it and only counts the
+ * written bytes. It is used to measure the formatting costs without the costs
+ * of any terminal or file.
+ */
+class NullBuffer : public std::streambuf {
+private:
+  uint64_t written_bytes;
+
+protected:
+  int overflow(int c) override {
+    ++written_bytes;
+    return c;
+  }
+  std::streamsize xsputn(const char*, std::streamsize n) override {
+    written_bytes += n;
+    return n;
+  }
+
+public:
+  NullBuffer(void) : written_bytes(0) {}
+  uint64_t getWrittenBytes(void) const { return written_bytes; }
+};
+
+/**
+ * The timing results of a single benchmark. The number of allocations is the
+ * one of the last run.
+ */
+struct BenchResult {
+  std::string name;
+  uint64_t num_pages;
+  uint64_t num_items;
+  uint64_t num_allocations;
+  std::vector<double> times_ns;
+};
+
+/**
+ * \brief Runs the given function \c iterations times and records the time of
+ * \brief each run. The \c setup function is called before each run and is not
+ * \brief timed.
+ */
+static BenchResult runBenchmark(const std::string &name, uint64_t num_pages,
+    unsigned iterations, const std::function<void(void)> &setup,
+    const std::function<uint64_t(void)> &run) {
+  BenchResult result;
+  result.name = name;
+  result.num_pages = num_pages;
+  result.num_items = 0;
+  result.num_allocations = 0;
+  for (unsigned i = 0; i < iterations; ++i) {
+    setup();
+    const uint64_t start_allocations = bench_allocations.load();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    result.num_items = run();
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    result.num_allocations = bench_allocations.load() - start_allocations;
+    result.times_ns.push_back(
+        std::chrono::duration<double, std::nano>(end - start).count());
+  }
+  return result;
+}
+
+/**
+ * \brief Runs all benchmarks on a fixture with the given number of pages.
+ */
+static bool benchmarkFixture(const std::string &root_path, uint64_t num_pages,
+    unsigned iterations, std::vector<BenchResult> &results) {
+  FixtureConfig config;
+  config.num_processes = 1;
+  config.vmas_per_process = bench_num_ranges;
+  config.pages_per_vma = std::max<uint64_t>(num_pages / bench_num_ranges, 1);
+  config.resident_ratio = 0.5;
+  config.thp_ratio = 0.1;
+  if (generateFixture(config, root_path) == false) {
+    return false;
+  }
+  const std::string pid(std::to_string(config.first_pid));
+  CmdOptions cmd_opts;
+  cmd_opts.cmd_proc_root = root_path;
+
+  std::vector<Process> processes;
+  try {
+    processes.emplace_back(pid, root_path);
+  } catch(const std::invalid_argument &inv_arg_exc) {
+    std::cerr << "Could not open the fixture in " << root_path << std::endl;
+    return false;
+  }
+  Process &proc = processes.front();
+
+  // Maps parsing
+  results.push_back(runBenchmark("maps_parse", num_pages, iterations,
+      [](void) {},
+      [&cmd_opts, &proc](void) -> uint64_t {
+        return proc.populateFileRanges(cmd_opts);
+      }));
+
+  // Pagemap decoding. The pagemap file stays open between the runs.
+  results.push_back(runBenchmark("pagemap_decode", num_pages, iterations,
+      [](void) {},
+      [&cmd_opts, &proc](void) -> uint64_t {
+        return proc.populatePages(cmd_opts);
+      }));
+
+  // Decoding only the frame numbers of the present pages with the visitor
+  results.push_back(runBenchmark("visitor_present_frames", num_pages, iterations,
+      [](void) {},
+      [&cmd_opts, &proc](void) -> uint64_t {
+        return collectPages(cmd_opts, proc, AnyRange(), PresentPage(),
+                            PageFrameNumber()).size();
+      }));
+
+  // Resolving the address of each page to its range, once one by one and
+  // once as a batch
+  const std::vector<uint64_t> addresses =
+      collectPages(cmd_opts, proc, AnyRange(), AnyPage(), PageAddress());
+  results.push_back(runBenchmark("range_lookup", num_pages, iterations,
+      [](void) {},
+      [&proc, &addresses](void) -> uint64_t {
+        uint64_t found = 0;
+        for (uint64_t cur_address : addresses) {
+          found += (proc.findVPageRange(cur_address) != nullptr) ? 1 : 0;
+        }
+        return found;
+      }));
+  std::vector<const VPageRange*> found_ranges;
+  results.push_back(runBenchmark("range_lookup_batch", num_pages, iterations,
+      [](void) {},
+      [&proc, &addresses, &found_ranges](void) -> uint64_t {
+        proc.findVPageRanges(addresses, found_ranges);
+        return found_ranges.size();
+      }));
+
+  // Loading the frames of all present pages
+  const std::vector<uint64_t> frames = collectFrameNumbers(processes);
+  PMemory pmem;
+  results.push_back(runBenchmark("frame_load", num_pages, iterations,
+      [&pmem](void) { pmem = PMemory(); },
+      [&cmd_opts, &pmem, &frames](void) -> uint64_t {
+        return pmem.addPFrames(cmd_opts, frames.begin(), frames.end());
+      }));
+
+  // Looking up the frame of each present page
+  volatile uint64_t lookup_sink = 0;
+  results.push_back(runBenchmark("frame_lookup", num_pages, iterations,
+      [](void) {},
+      [&pmem, &frames, &lookup_sink](void) -> uint64_t {
+        const PMemory::PF_Map_Ty &frame_map = pmem.getPFrameMap();
+        uint64_t found = 0;
+        for (uint64_t cur_frame : frames) {
+          PMemory::PF_Map_Ty::const_iterator frame_it = frame_map.find(cur_frame);
+          if (frame_it != frame_map.end()) {
+            lookup_sink = lookup_sink + frame_it->second.getRawFrameProperties();
+            ++found;
+          }
+        }
+        return found;
+      }));
+
+  // Formatting the results of all pages
+  NullBuffer null_buffer;
+  std::ostream null_stream(&null_buffer);
+  results.push_back(runBenchmark("print_results", num_pages, iterations,
+      [](void) {},
+      [&cmd_opts, &null_stream, &processes, &pmem](void) -> uint64_t {
+        printResults(cmd_opts, null_stream, processes, pmem);
+        return processes.front().getVPageRanges().size();
+      }));
+  return true;
+}
+
+/**
+ * \brief Runs the benchmarks of the range handling on a fixture with the given
+ * \brief number of small ranges.
+ *
+ * Processes with many small mappings stress the per range costs of parsing
+ * and populating instead of the per page costs. Half of the ranges map a file
+ * so their paths do not fit into the small string buffer.
+ */
+static bool benchmarkManyRanges(const std::string &root_path, unsigned num_ranges,
+    unsigned iterations, std::vector<BenchResult> &results) {
+  FixtureConfig config;
+  config.num_processes = 1;
+  config.vmas_per_process = num_ranges;
+  config.pages_per_vma = 4;
+  config.resident_ratio = 0.5;
+  config.shared_ratio = 0.5;
+  if (generateFixture(config, root_path) == false) {
+    return false;
+  }
+  const std::string pid(std::to_string(config.first_pid));
+  CmdOptions cmd_opts;
+  cmd_opts.cmd_proc_root = root_path;
+
+  std::vector<Process> processes;
+  try {
+    processes.emplace_back(pid, root_path);
+  } catch(const std::invalid_argument &inv_arg_exc) {
+    std::cerr << "Could not open the fixture in " << root_path << std::endl;
+    return false;
+  }
+  Process &proc = processes.front();
+
+  const uint64_t num_pages = static_cast<uint64_t>(num_ranges) * config.pages_per_vma;
+  results.push_back(runBenchmark("maps_parse_many_ranges", num_pages, iterations,
+      [](void) {},
+      [&cmd_opts, &proc](void) -> uint64_t {
+        return proc.populateFileRanges(cmd_opts);
+      }));
+  results.push_back(runBenchmark("pagemap_decode_many_ranges", num_pages,
+      iterations,
+      [](void) {},
+      [&cmd_opts, &proc](void) -> uint64_t {
+        return proc.populatePages(cmd_opts);
+      }));
+  return true;
+}
+
+/**
+ * \brief Writes the results as JSON to the given stream.
+ */
+static void printResultsJSON(std::ostream &stream, unsigned iterations,
+    const std::vector<BenchResult> &results) {
+  stream << "{" << std::endl;
+  stream << "  \"page_size\": " << sysconf(_SC_PAGESIZE) << "," << std::endl;
+  stream << "  \"iterations\": " << iterations << "," << std::endl;
+  stream << "  \"results\": [" << std::endl;
+  for (size_t i = 0; i < results.size(); ++i) {
+    std::vector<double> times(results[i].times_ns);
+    std::sort(times.begin(), times.end());
+    double total = 0.0;
+    for (double cur_time : times) {
+      total += cur_time;
+    }
+    const double median = times[times.size() / 2];
+    stream << "    {\"name\": \"" << results[i].name << "\""
+           << ", \"pages\": " << results[i].num_pages
+           << ", \"items\": " << results[i].num_items
+           << ", \"allocations\": " << results[i].num_allocations
+           << ", \"min_ns\": " << static_cast<uint64_t>(times.front())
+           << ", \"median_ns\": " << static_cast<uint64_t>(median)
+           << ", \"mean_ns\": " << static_cast<uint64_t>(total / times.size())
+           << ", \"max_ns\": " << static_cast<uint64_t>(times.back())
+           << ", \"ns_per_page\": "
+           << ((results[i].num_pages > 0) ? median / results[i].num_pages : 0.0)
+           << "}" << ((i + 1 < results.size()) ? "," : "") << std::endl;
+  }
+  stream << "  ]" << std::endl;
+  stream << "}" << std::endl;
+}
+
+static int removeEntry(const char *path, const struct stat*, int, struct FTW*) {
+  return remove(path);
+}
+
+static void printUsage(std::ostream &stream) {
+  stream << "lsmmap-bench - microbenchmarks of lsmmap" << std::endl << std::endl;
+  stream << "Usage:" << std::endl
+         << "lsmmap-bench [OPTIONS]" << std::endl;
+  stream << std::endl;
+  stream << "OPTIONS:" << std::endl;
+  stream << "  -s n,m Comma separated list of fixture sizes in pages " << std::endl
+         << "         (default 16384,262144,1048576)." << std::endl;
+  stream << "  -r n   Number of ranges of the fixture with many small " << std::endl
+         << "         ranges (default 100000, 0 disables it)." << std::endl;
+  stream << "  -i n   Number of runs of each benchmark (default 5)." << std::endl;
+  stream << "  -d d   Generate the fixtures in directory d instead of " << std::endl
+         << "         a temporary directory." << std::endl;
+  stream << "  -k     Keep the generated fixtures." << std::endl;
+  stream << "  -h     Print this help message." << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<uint64_t> sizes = {16384, 262144, 1048576};
+  unsigned long iterations = 5;
+  unsigned long many_ranges = 100000;
+  std::string work_path;
+  bool keep_fixtures = false;
+  bool created_work_path = false;
+  bool valid_opts = true;
+  int c;
+  while ((c = getopt(argc, argv, "hs:r:i:d:k")) != -1) {
+    switch(c) {
+      case 'h':
+        printUsage(std::cout);
+        exit(EXIT_SUCCESS);
+        break;
+      case 's': {
+        sizes.clear();
+        std::istringstream size_list(optarg);
+        std::string cur_size;
+        unsigned long value = 0;
+        while (std::getline(size_list, cur_size, ',')) {
+          if ((str2ulong(cur_size, &value, 10) == false) || (value == 0)) {
+            std::cerr << cur_size << " is not a valid fixture size!" << std::endl;
+            valid_opts = false;
+          }
+          sizes.push_back(value);
+        }
+        break;
+      }
+      case 'r':
+        if (str2ulong(optarg, &many_ranges, 10) == false) {
+          std::cerr << optarg << " is not a valid number of ranges!" << std::endl;
+          valid_opts = false;
+        }
+        break;
+      case 'i':
+        if ((str2ulong(optarg, &iterations, 10) == false) || (iterations == 0)) {
+          std::cerr << optarg << " is not a valid number of iterations!" << std::endl;
+          valid_opts = false;
+        }
+        break;
+      case 'd':
+        work_path = optarg;
+        break;
+      case 'k':
+        keep_fixtures = true;
+        break;
+      default:
+        valid_opts = false;
+        break;
+    }
+  }
+  if ((valid_opts == false) || (optind != argc) || (sizes.empty() == true)) {
+    printUsage(std::cerr);
+    exit(EXIT_FAILURE);
+  }
+  if (work_path.empty() == true) {
+    const char *tmp_dir = getenv("TMPDIR");
+    std::string path_template(std::string((tmp_dir != nullptr) ? tmp_dir : "/tmp")
+                              + "/lsmmap-bench-XXXXXX");
+    if (mkdtemp(&path_template[0]) == nullptr) {
+      std::cerr << "Could not create a temporary directory!" << std::endl;
+      perror("mkdtemp:");
+      exit(EXIT_FAILURE);
+    }
+    work_path = path_template;
+    created_work_path = true;
+  }
+
+  std::vector<BenchResult> results;
+  bool success = true;
+  for (uint64_t cur_size : sizes) {
+    const std::string fixture_path(work_path + "/" + std::to_string(cur_size));
+    if (benchmarkFixture(fixture_path, cur_size, iterations, results) == false) {
+      success = false;
+      break;
+    }
+    if (keep_fixtures == false) {
+      nftw(fixture_path.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+    }
+  }
+  if ((success == true) && (many_ranges > 0)) {
+    const std::string fixture_path(work_path + "/ranges-" + std::to_string(many_ranges));
+    success = benchmarkManyRanges(fixture_path, many_ranges, iterations, results);
+    if (keep_fixtures == false) {
+      nftw(fixture_path.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+    }
+  }
+  if ((keep_fixtures == false) && (created_work_path == true)) {
+    rmdir(work_path.c_str());
+  }
+  if (success == false) {
+    exit(EXIT_FAILURE);
+  }
+  printResultsJSON(std::cout, iterations, results);
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,123 @@
+//===- Arena.h ------------------------------------------------------------===//
+//
+// This file contains the Arena class that hands out memory from large
+// anonymous mappings and the ArenaAllocator that lets standard containers
+// allocate from an arena.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_ARENA_H_INCLUDE_
+#define LSMMAP_ARENA_H_INCLUDE_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/**
+ * This class manages memory in blocks that are mapped at once. The first block
+ * is small and each further block doubles in size up to the maximal block size
+ * (unless a single allocation needs a larger block). Blocks of at least
+ * \c huge_page_bytes are backed by transparent huge pages where available.
+ * Small allocations are carved from the current block and rounded up to one of
+ * a fixed set of size classes. Freed memory is kept in a free list per size
+ * class and reused by later allocations of the same class. The blocks are only
+ * returned to the system when the arena is destroyed, \c reset() frees all
+ * allocations at once but keeps the blocks. Allocations larger than
+ * \c max_small_bytes get a mapping of their own that is unmapped when they are
+ * freed.
+ *
+ * An arena is not synchronized, it must only be used by one thread at a time.
+ */
+class Arena {
+public:
+  static const size_t min_block_bytes = 64 << 10;
+  static const size_t default_block_bytes = 32 << 20;
+  static const size_t huge_page_bytes = 2 << 20;
+  static const size_t max_small_bytes = 1 << 20;
+
+private:
+  // 8 classes of 16 byte steps up to 128 bytes, then 4 classes per power of two
+  static const unsigned num_size_classes = 8 + 4 * 13;
+
+  size_t max_block_bytes;
+  size_t next_block_bytes;
+  std::vector<std::pair<char*, size_t> > blocks;
+  size_t next_block;
+  std::map<void*, size_t> large_mappings;
+  char *cur_pos;
+  char *cur_end;
+  void *free_lists[num_size_classes];
+  uint64_t reserved_bytes;
+
+  static unsigned getSizeClass(size_t bytes, size_t &class_bytes);
+  void* mapMemory(size_t bytes);
+
+public:
+  Arena(size_t maxblockbytes = default_block_bytes);
+  Arena(const Arena &other) = delete;
+  Arena& operator=(const Arena &other) = delete;
+  ~Arena(void);
+
+  void* allocate(size_t bytes);
+  void deallocate(void *ptr, size_t bytes);
+  void reset(void);
+  uint64_t getReservedBytes(void) const;
+};
+
+/**
+ * This class is an allocator for standard containers that takes its memory
+ * from the arena it holds. Without an arena the memory is taken from the
+ * heap. The arena must outlive all containers using it, so it is handed over
+ * when a container is moved or swapped but copies of a container use the
+ * heap.
+ */
+template<class T>
+class ArenaAllocator {
+public:
+  typedef T value_type;
+  typedef std::false_type propagate_on_container_copy_assignment;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  Arena *arena;
+
+  ArenaAllocator(void) noexcept : arena(nullptr) {}
+  explicit ArenaAllocator(Arena *allocarena) noexcept : arena(allocarena) {}
+  template<class U>
+  ArenaAllocator(const ArenaAllocator<U> &other) noexcept
+   : arena(other.arena) {}
+
+  ArenaAllocator select_on_container_copy_construction(void) const {
+    return ArenaAllocator();
+  }
+
+  T* allocate(size_t n) {
+    static_assert(alignof(T) <= 16, "Arena memory is aligned to 16 bytes only");
+    if (arena == nullptr) {
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<T*>(arena->allocate(n * sizeof(T)));
+  }
+  void deallocate(T *ptr, size_t n) noexcept {
+    if (arena == nullptr) {
+      ::operator delete(ptr);
+      return;
+    }
+    arena->deallocate(ptr, n * sizeof(T));
+  }
+};
+
+template<class T, class U>
+bool operator==(const ArenaAllocator<T> &lhs, const ArenaAllocator<U> &rhs) {
+  return lhs.arena == rhs.arena;
+}
+
+template<class T, class U>
+bool operator!=(const ArenaAllocator<T> &lhs, const ArenaAllocator<U> &rhs) {
+  return lhs.arena != rhs.arena;
+}
+
+#endif
@@ -0,0 +1,46 @@
+//===- Budget.h -----------------------------------------------------------===//
+//
+// This file contains the MemoryBudget class and the scan that keeps the
+// memory used for pages and frames within such a budget.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_BUDGET_H_INCLUDE_
+#define LSMMAP_BUDGET_H_INCLUDE_
+
+#include "CmdOptions.h"
+#include "Process.h"
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/**
+ * This class keeps track of the memory charged against a fixed limit and of
+ * the peak amount of charged memory. The charged amounts are estimates given
+ * by the caller, nothing is measured. Charging more than the limit is not
+ * prevented; it is up to the caller to size its allocations by
+ * \c getAvailable().
+ */
+class MemoryBudget {
+private:
+  uint64_t limit;
+  uint64_t used;
+  uint64_t peak;
+
+public:
+  MemoryBudget(uint64_t limitbytes);
+
+  uint64_t getLimit(void) const;
+  uint64_t getUsed(void) const;
+  uint64_t getPeak(void) const;
+  uint64_t getAvailable(void) const;
+
+  void charge(uint64_t bytes);
+  void release(uint64_t bytes);
+};
+
+bool printResultsWithinBudget(const CmdOptions &cmd_opts, std::ostream &stream,
+    std::vector<Process> &processes, MemoryBudget &budget);
+
+#endif
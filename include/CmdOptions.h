@@ -11,17 +11,21 @@
 #include <cstdint>
 #include <string>
 #include <unistd.h>
+#include <utility>
 #include <vector>
 
 bool isPID(const std::string &str);
 bool str2long(const std::string &str, long int *value = nullptr, int base = 0);
 bool str2ulong(const std::string &str, unsigned long int *value = nullptr, int base = 0);
+bool str2double(const std::string &str, double *value = nullptr);
+bool str2size(const std::string &str, uint64_t *value = nullptr);
 
 class CmdOptions {
 public:
   enum class ErrorType {NoError = 0, Option, PID, ShowHelp};
   enum class ProgMode {Mappings = 0, Pages};
   typedef std::vector<std::string> PID_List_Ty;
+  typedef std::vector<std::pair<uint64_t, uint64_t> > FR_List_Ty;
 
   bool parsed_from_cmdl;
   uint64_t cmd_lower_address;
@@ -34,9 +38,38 @@ public:
   ProgMode cmd_prog_mode;
   bool cmd_only_vpranges;
   PID_List_Ty cmd_req_pid;
+  std::string cmd_save_path;
+  std::string cmd_load_path;
+  std::string cmd_diff_path;
+  double cmd_watch_interval;
+  double cmd_softdirty_interval;
+  bool cmd_all_processes;
+  unsigned cmd_num_workers;
+  std::string cmd_comm_regex;
+  std::string cmd_cmdline_regex;
+  unsigned long cmd_uid;
+  bool cmd_uid_userset;
+  std::string cmd_cgroup_path;
+  std::string cmd_proc_root;
+  bool cmd_stats;
+  bool cmd_stats_json;
+  std::string cmd_trace_path;
+  bool cmd_translate;
+  unsigned long cmd_sample_size;
+  bool cmd_sample_strided;
+  uint64_t cmd_max_mem;
+  bool cmd_files;
+  bool cmd_content;
+  uint64_t cmd_content_rate;
+  bool cmd_swap;
+  FR_List_Ty cmd_frame_ranges;
+  bool cmd_contiguity;
+  bool cmd_fragmentation;
+  std::string cmd_translate_path;
 
   CmdOptions();
   ErrorType parseFromCommandLine(int argc, char *argv[]);
+  bool hasProcessSelectors(void) const;
 };
 
 #endif
@@ -0,0 +1,110 @@
+//===- Content.h ----------------------------------------------------------===//
+//
+// This file contains the classes to analyze the contents of the resident
+// pages of processes, i.e. to find pages that only contain zeros and pages
+// with identical contents.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_CONTENT_H_INCLUDE_
+#define LSMMAP_CONTENT_H_INCLUDE_
+
+#include "CmdOptions.h"
+#include "Process.h"
+#include "VPage.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * This class holds the 128 bit hash of the contents of a page.
+ */
+class PageHash {
+public:
+  uint64_t low;
+  uint64_t high;
+
+  PageHash(void) : low(0), high(0) {}
+  PageHash(uint64_t lowbits, uint64_t highbits) : low(lowbits), high(highbits) {}
+
+  bool operator==(const PageHash &other) const {
+    return (low == other.low) && (high == other.high);
+  }
+  bool operator<(const PageHash &other) const {
+    return (high != other.high) ? (high < other.high) : (low < other.low);
+  }
+};
+
+/**
+ * This class limits the rate at which the contents of pages are read. The
+ * limit is shared by all threads, so it bounds the total rate of a scan.
+ * A rate of 0 disables the limit.
+ */
+class ContentThrottle {
+private:
+  std::mutex throttle_mutex;
+  uint64_t bytes_per_second;
+  std::chrono::steady_clock::time_point next_read;
+
+public:
+  ContentThrottle(uint64_t bytespersecond);
+
+  void acquire(uint64_t bytes);
+};
+
+/**
+ * This class holds the results of the content analysis of a single page
+ * range. The range is referenced and not copied so the process it belongs to
+ * must outlive this object.
+ *
+ * Zero pages could be replaced by the shared zero page, pages that already
+ * map it are not counted. Zero pages whose frame is unknown (e.g. because
+ * the frame numbers are hidden) are counted as unresolved zero pages and are
+ * not considered reclaimable. Duplicate pages have
+ * the same contents as another page that is stored in a different frame and
+ * could be merged with it (e.g. by KSM). Duplicates whose identical pages
+ * belong to other processes are also counted as cross-process duplicates.
+ * Pages mapping the same frame are only counted once.
+ */
+class RangeContent {
+public:
+  const VPageRange *vp_range;
+  uint64_t scanned_pages;
+  uint64_t unreadable_pages;
+  uint64_t zero_pages;
+  uint64_t unresolved_zero_pages;
+  uint64_t duplicate_pages;
+  uint64_t cross_duplicate_pages;
+
+  RangeContent(const VPageRange &range);
+
+  uint64_t getReclaimableBytes(void) const;
+};
+
+/**
+ * This class holds the results of the content analysis of all scanned ranges
+ * of a process.
+ */
+class ProcessContent {
+public:
+  typedef std::vector<RangeContent> RC_List_Ty;
+
+  std::string process_id;
+  RC_List_Ty range_contents;
+
+  ProcessContent(const std::string &pid);
+
+  uint64_t getPages(uint64_t RangeContent::*counter) const;
+  uint64_t getReclaimableBytes(void) const;
+};
+
+bool isZeroPage(const void *data, size_t size);
+PageHash hashPage(const void *data, size_t size, uint64_t seed = 0);
+std::vector<ProcessContent> analyzeContent(const CmdOptions &cmd_opts,
+    const std::vector<Process> &processes);
+
+#endif
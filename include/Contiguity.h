@@ -0,0 +1,94 @@
+//===- Contiguity.h -------------------------------------------------------===//
+//
+// This file contains the classes to analyze how physically contiguous the
+// frames backing the ranges of processes are and how fragmented the free
+// memory of the buddy allocator is.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_CONTIGUITY_H_INCLUDE_
+#define LSMMAP_CONTIGUITY_H_INCLUDE_
+
+#include "CmdOptions.h"
+#include "Process.h"
+#include "VPage.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * This class holds the physical contiguity of the resident pages of a single
+ * range. A run is a maximal sequence of pages at adjacent virtual addresses
+ * whose frames are adjacent as well. The runs are counted per order, i.e. a
+ * run of n pages counts towards order floor(log2(n)); the last order also
+ * counts all longer runs. Present pages whose frame number is hidden (e.g.
+ * without root privileges) are counted as unresolved pages and end a run.
+ * The range is referenced and not copied so the process it belongs to must
+ * outlive this object.
+ */
+class RangeContiguity {
+public:
+  static const unsigned num_orders = 20;
+
+  const VPageRange *vp_range;
+  uint64_t resident_pages;
+  uint64_t unresolved_pages;
+  uint64_t num_runs;
+  uint64_t largest_run;
+  uint64_t run_orders[num_orders];
+
+  RangeContiguity(const VPageRange &range);
+
+  double getMeanRunLength(void) const;
+};
+
+/**
+ * This class holds the physical contiguity of all ranges of a process with
+ * resident pages.
+ */
+class ProcessContiguity {
+public:
+  typedef std::vector<RangeContiguity> RC_List_Ty;
+
+  std::string process_id;
+  RC_List_Ty range_contiguities;
+
+  ProcessContiguity(const std::string &pid);
+
+  uint64_t getCount(uint64_t RangeContiguity::*counter) const;
+  uint64_t getLargestRun(void) const;
+};
+
+/**
+ * This class holds the free blocks of the buddy allocator found within the
+ * frames of a single memory zone. Blocks of orders above the last order are
+ * counted towards the last one.
+ */
+class ZoneFragmentation {
+public:
+  // Orders 0 to 10 of the buddy allocator
+  static const unsigned num_orders = 11;
+
+  int node_no;
+  std::string zone_name;
+  uint64_t first_frame;
+  uint64_t num_frames;
+  uint64_t free_pages;
+  uint64_t free_blocks[num_orders];
+
+  ZoneFragmentation(int nodeno, const std::string &zonename,
+      uint64_t firstframe, uint64_t numframes);
+
+  uint64_t getFreePages(unsigned min_order) const;
+  double getUnusableIndex(unsigned order) const;
+};
+
+std::vector<ProcessContiguity> computeContiguity(
+    const std::vector<Process> &processes);
+std::vector<ZoneFragmentation> readZones(const CmdOptions &cmd_opts);
+bool scanFreeBlocks(const CmdOptions &cmd_opts,
+    std::vector<ZoneFragmentation> &zones);
+unsigned getHugePageOrder(void);
+
+#endif
@@ -0,0 +1,21 @@
+//===- Diagnostics.h ------------------------------------------------------===//
+//
+// This file contains the streams all error and verbose messages of the
+// library are written to. By default they refer to std::cerr and std::clog.
+// Programs embedding the library can redirect them (e.g. into their own log)
+// or silence them.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_DIAGNOSTICS_H_INCLUDE_
+#define LSMMAP_DIAGNOSTICS_H_INCLUDE_
+
+#include <ostream>
+
+std::ostream& errs(void);
+std::ostream& logs(void);
+void setErrorStream(std::ostream *stream);
+void setLogStream(std::ostream *stream);
+void printSystemError(const char *prefix);
+
+#endif
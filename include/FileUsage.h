@@ -0,0 +1,48 @@
+//===- FileUsage.h --------------------------------------------------------===//
+//
+// This file contains the classes to aggregate the page cache usage of the
+// mapped files over all scanned processes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_FILEUSAGE_H_INCLUDE_
+#define LSMMAP_FILEUSAGE_H_INCLUDE_
+
+#include "PathTable.h"
+#include "PMemory.h"
+#include "Process.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * This class holds the memory used by a single mapped file. A frame that is
+ * mapped several times (by one or by several processes) is counted once.
+ * Frames mapped by more than one of the scanned processes are shared. The
+ * resident frames are the page cache frames of the file; private copies of
+ * written pages are anonymous and counted as copied frames instead. The
+ * dirty and writeback counts only include frames whose flags could be read.
+ * Present pages whose frame number is hidden (e.g. without root privileges)
+ * cannot be deduplicated and are counted as unresolved pages instead.
+ */
+class FileUsage {
+public:
+  PathTable::PathID path_id;
+  uint64_t num_processes;
+  uint64_t num_ranges;
+  uint64_t mapped_pages;
+  uint64_t resident_frames;
+  uint64_t shared_frames;
+  uint64_t dirty_frames;
+  uint64_t writeback_frames;
+  uint64_t copied_frames;
+  uint64_t unresolved_pages;
+  uint64_t page_size;
+
+  FileUsage(PathTable::PathID id, uint64_t pagesize);
+};
+
+std::vector<FileUsage> computeFileUsage(const std::vector<Process> &processes,
+    const PMemory &pmem);
+
+#endif
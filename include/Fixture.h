@@ -0,0 +1,67 @@
+//===- Fixture.h ----------------------------------------------------------===//
+//
+// This file contains the functions to generate a synthetic directory tree that
+// mimics the layout of /proc. lsmmap can read such a tree using --proc-root
+// which allows repeatable runs on address spaces of arbitrary size without
+// root privileges.
+//
+// The generated tree looks as follows:
+//
+//   <root>/kpageflags         (frame flags, sparse)
+//   <root>/kpagecount         (frame reference counts, sparse)
+//   <root>/<pid>/maps
+//   <root>/<pid>/pagemap      (sparse, indexed by virtual page number)
+//   <root>/<pid>/stat
+//   <root>/<pid>/status       (only the Uid line, owned by the caller)
+//   <root>/<pid>/cmdline
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_FIXTURE_H_INCLUDE_
+#define LSMMAP_FIXTURE_H_INCLUDE_
+
+#include <cstdint>
+#include <string>
+
+/**
+ * This class holds the parameters of a generated fixture.
+ *
+ * Every process gets \c vmas_per_process ranges of \c pages_per_vma pages.
+ * A page is present in RAM with the probability \c resident_ratio. Each
+ * 2 MiB aligned block of a range is backed by a transparent huge page with
+ * the probability \c thp_ratio. A range is a shared file mapping with the
+ * probability \c shared_ratio. Shared ranges with the same index map the
+ * same frames in all processes.
+ */
+class FixtureConfig {
+public:
+  unsigned num_processes;
+  unsigned vmas_per_process;
+  uint64_t pages_per_vma;
+  double resident_ratio;
+  double thp_ratio;
+  double shared_ratio;
+  uint64_t seed;
+  unsigned first_pid;
+
+  FixtureConfig(void);
+};
+
+/**
+ * This class summarizes the content of a generated fixture.
+ */
+class FixtureSummary {
+public:
+  uint64_t num_processes;
+  uint64_t num_ranges;
+  uint64_t num_pages;
+  uint64_t num_resident_pages;
+  uint64_t num_frames;
+
+  FixtureSummary(void);
+};
+
+bool generateFixture(const FixtureConfig &config, const std::string &root_path,
+    FixtureSummary *summary = nullptr);
+
+#endif
@@ -12,8 +12,19 @@
 #include <type_traits>
 #include <vector>
 
+#include "Content.h"
+#include "Contiguity.h"
+#include "FileUsage.h"
 #include "Process.h"
 #include "PMemory.h"
+#include "ReverseMap.h"
+#include "Sampling.h"
+#include "Scanner.h"
+#include "SnapshotDiff.h"
+#include "SoftDirty.h"
+#include "Swap.h"
+#include "Translate.h"
+#include "Watch.h"
 
 inline char getTristateChar(const VPageRange::TriState &val, char TrueC,
     char FalseC = '-', char UnknownC = '?');
@@ -21,8 +32,43 @@ inline char getBoolChar(const bool val, char TrueC, char FalseC = '-');
 void printHelpMessage(std::ostream &stream);
 void printPageRangeHeadline(const CmdOptions &cmd_opts, std::ostream &stream);
 void printMappingHeadline(const CmdOptions &cmd_opts, std::ostream &stream);
+void printVPageRange(const CmdOptions &cmd_opts, std::ostream &stream,
+    const VPageRange &vp_range);
+void printVPage(const CmdOptions &cmd_opts, std::ostream &stream,
+    const VPage &vpage, const PMemory &pmem);
+void printVPages(const CmdOptions &cmd_opts, std::ostream &stream,
+    const VPageRange::VP_List_Ty &vpages, const PMemory &pmem,
+    uint64_t &no_omitted_pages);
+void printOmittedVPages(const CmdOptions &cmd_opts, std::ostream &stream,
+    const VPageRange &vp_range, uint64_t no_omitted_pages);
 void printResults(const CmdOptions &cmd_opts, std::ostream &stream,
     const std::vector<Process> &processes, const PMemory &pmem);
+void printSnapshotDiff(const CmdOptions &cmd_opts, std::ostream &stream,
+    const PD_List_Ty &proc_diffs);
+void printWatchDeltas(const CmdOptions &cmd_opts, std::ostream &stream,
+    double timestamp, const PDelta_List_Ty &deltas);
+void printWriteSets(const CmdOptions &cmd_opts, std::ostream &stream,
+    const std::vector<ProcessWriteSet> &write_sets, const PMemory &pmem,
+    double interval);
+void printSamples(const CmdOptions &cmd_opts, std::ostream &stream,
+    const std::vector<ProcessSample> &samples);
+void printTranslations(const CmdOptions &cmd_opts, std::ostream &stream,
+    const std::vector<AddressTranslation> &translations, const PMemory &pmem);
+void printFileUsage(const CmdOptions &cmd_opts, std::ostream &stream,
+    const std::vector<FileUsage> &usages);
+void printContent(const CmdOptions &cmd_opts, std::ostream &stream,
+    const std::vector<ProcessContent> &contents);
+void printSwapLayout(const CmdOptions &cmd_opts, std::ostream &stream,
+    const SwapLayout &layout);
+void printFrameMappings(const CmdOptions &cmd_opts, std::ostream &stream,
+    const std::vector<Process> &processes, const ReverseLookup &lookup,
+    const PMemory &pmem);
+void printContiguity(const CmdOptions &cmd_opts, std::ostream &stream,
+    const std::vector<ProcessContiguity> &contiguities);
+void printFragmentation(const CmdOptions &cmd_opts, std::ostream &stream,
+    const std::vector<ZoneFragmentation> &zones);
+void printScanResult(const CmdOptions &cmd_opts, std::ostream &stream,
+    const ScanResult &result);
 
 
 #endif
@@ -7,17 +7,20 @@
 #ifndef LSMMAP_PMEMORY_H_INCLUDE_
 #define LSMMAP_PMEMORY_H_INCLUDE_
 
+#include "Arena.h"
 #include "CmdOptions.h"
 #include "PFrame.h"
 
 #include <cstdint>
+#include <functional>
 #include <iterator>
 #include <map>
 #include <type_traits>
 
 class PMemory {
 public:
-  typedef std::map<uint64_t, PFrame> PF_Map_Ty;
+  typedef std::map<uint64_t, PFrame, std::less<uint64_t>,
+      ArenaAllocator<std::pair<const uint64_t, PFrame> > > PF_Map_Ty;
 
 private:
   PF_Map_Ty p_frames;
@@ -28,6 +31,7 @@ protected:
 
 public:
   PMemory(void);
+  explicit PMemory(Arena *frame_arena);
 
   template<class It_Ty>
   typename std::enable_if<
@@ -36,6 +40,11 @@ public:
   , size_t>::type
   addPFrames(const CmdOptions &cmd_opts, It_Ty it_begin, It_Ty it_end);
   bool addPFrame(const CmdOptions &cmd_opts, uint64_t frame_no);
+  bool insertPFrame(uint64_t frame_no, const PFrame &frame);
+
+  static bool openFrameFiles(const CmdOptions &cmd_opts, int &flags_fd,
+      int &refcount_fd);
+  static void closeFrameFiles(void);
 
   const PF_Map_Ty& getPFrameMap(void) const;
 };
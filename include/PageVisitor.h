@@ -0,0 +1,210 @@
+//===- PageVisitor.h ------------------------------------------------------===//
+//
+// This file contains a visitor interface that decodes the pagemap entries of
+// a process and hands only the matching pages to the caller. The filters and
+// projections are passed as function objects whose types are template
+// parameters so the compiler can inline them into the decode loop. Pages that
+// do not match are never turned into objects.
+//
+// Example: collect the frame numbers and soft-dirty bits of all present pages
+// in writable anonymous ranges.
+//
+//   typedef AndPredicate<AnonymousRange, WritableRange> RangeFilter;
+//   std::vector<std::pair<uint64_t, bool>> result = collectPages(cmd_opts,
+//       proc, RangeFilter(), PresentPage(),
+//       PairProjection<PageFrameNumber, PageSoftDirty>());
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_PAGEVISITOR_H_INCLUDE_
+#define LSMMAP_PAGEVISITOR_H_INCLUDE_
+
+#include "Process.h"
+#include "VPage.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * This class is a lightweight view of a single decoded pagemap entry. It is
+ * only valid during the call of the predicate, projection or consumer it is
+ * passed to.
+ */
+class RawPage {
+public:
+  uint64_t address;
+  uint64_t page_word;
+  const VPageRange *vp_range;
+
+  bool isPresentRAM(void) const { return PagemapEntry::isPresentRAM(page_word); }
+  bool isPresentSwap(void) const { return PagemapEntry::isPresentSwap(page_word); }
+  bool isFileMapped(void) const { return PagemapEntry::isFileMapped(page_word); }
+  bool isExclusive(void) const { return PagemapEntry::isExclusive(page_word); }
+  bool isSoftDirty(void) const { return PagemapEntry::isSoftDirty(page_word); }
+  uint64_t getFrameNumber(void) const { return PagemapEntry::getFrameNumber(page_word); }
+  uint8_t getSwapType(void) const { return PagemapEntry::getSwapType(page_word); }
+  uint64_t getSwapOffset(void) const { return PagemapEntry::getSwapOffset(page_word); }
+};
+
+//===- Range predicates ---------------------------------------------------===//
+
+struct AnyRange {
+  bool operator()(const VPageRange&) const { return true; }
+};
+
+struct AnonymousRange {
+  bool operator()(const VPageRange &vp_range) const {
+    return vp_range.getMappingType() == VPageRange::MappingType::Anonymous;
+  }
+};
+
+struct FileRange {
+  bool operator()(const VPageRange &vp_range) const {
+    return vp_range.getMappingType() == VPageRange::MappingType::Filemapping;
+  }
+};
+
+struct ReadableRange {
+  bool operator()(const VPageRange &vp_range) const {
+    return vp_range.canRead() == VPageRange::TriState::True;
+  }
+};
+
+struct WritableRange {
+  bool operator()(const VPageRange &vp_range) const {
+    return vp_range.canWrite() == VPageRange::TriState::True;
+  }
+};
+
+struct ExecutableRange {
+  bool operator()(const VPageRange &vp_range) const {
+    return vp_range.canExec() == VPageRange::TriState::True;
+  }
+};
+
+struct PrivateRange {
+  bool operator()(const VPageRange &vp_range) const {
+    return vp_range.isPrivate() == VPageRange::TriState::True;
+  }
+};
+
+//===- Page predicates ----------------------------------------------------===//
+
+struct AnyPage {
+  bool operator()(const RawPage&) const { return true; }
+};
+
+struct PresentPage {
+  bool operator()(const RawPage &page) const { return page.isPresentRAM(); }
+};
+
+struct SwappedPage {
+  bool operator()(const RawPage &page) const { return page.isPresentSwap(); }
+};
+
+struct FileMappedPage {
+  bool operator()(const RawPage &page) const { return page.isFileMapped(); }
+};
+
+struct ExclusivePage {
+  bool operator()(const RawPage &page) const { return page.isExclusive(); }
+};
+
+struct SoftDirtyPage {
+  bool operator()(const RawPage &page) const { return page.isSoftDirty(); }
+};
+
+//===- Predicate combinators ----------------------------------------------===//
+
+template<class LHS_Ty, class RHS_Ty>
+struct AndPredicate {
+  LHS_Ty lhs;
+  RHS_Ty rhs;
+
+  AndPredicate(LHS_Ty l = LHS_Ty(), RHS_Ty r = RHS_Ty()) : lhs(l), rhs(r) {}
+  template<class Arg_Ty>
+  bool operator()(const Arg_Ty &arg) const { return lhs(arg) && rhs(arg); }
+};
+
+template<class LHS_Ty, class RHS_Ty>
+struct OrPredicate {
+  LHS_Ty lhs;
+  RHS_Ty rhs;
+
+  OrPredicate(LHS_Ty l = LHS_Ty(), RHS_Ty r = RHS_Ty()) : lhs(l), rhs(r) {}
+  template<class Arg_Ty>
+  bool operator()(const Arg_Ty &arg) const { return lhs(arg) || rhs(arg); }
+};
+
+template<class Pred_Ty>
+struct NotPredicate {
+  Pred_Ty pred;
+
+  NotPredicate(Pred_Ty p = Pred_Ty()) : pred(p) {}
+  template<class Arg_Ty>
+  bool operator()(const Arg_Ty &arg) const { return !pred(arg); }
+};
+
+//===- Projections --------------------------------------------------------===//
+
+struct PageAddress {
+  uint64_t operator()(const RawPage &page) const { return page.address; }
+};
+
+struct PageWord {
+  uint64_t operator()(const RawPage &page) const { return page.page_word; }
+};
+
+struct PageFrameNumber {
+  uint64_t operator()(const RawPage &page) const { return page.getFrameNumber(); }
+};
+
+struct PageSoftDirty {
+  bool operator()(const RawPage &page) const { return page.isSoftDirty(); }
+};
+
+struct PageObject {
+  VPage operator()(const RawPage &page) const {
+    VPage vpage(page.address);
+    vpage.setRawPageProperties(page.page_word, true);
+    return vpage;
+  }
+};
+
+template<class First_Ty, class Second_Ty>
+struct PairProjection {
+  First_Ty first;
+  Second_Ty second;
+
+  typedef decltype(std::declval<const First_Ty&>()(std::declval<const RawPage&>()))
+      First_Result_Ty;
+  typedef decltype(std::declval<const Second_Ty&>()(std::declval<const RawPage&>()))
+      Second_Result_Ty;
+
+  PairProjection(First_Ty f = First_Ty(), Second_Ty s = Second_Ty())
+   : first(f), second(s) {}
+  std::pair<First_Result_Ty, Second_Result_Ty>
+  operator()(const RawPage &page) const {
+    return std::make_pair(first(page), second(page));
+  }
+};
+
+//===- Visitor functions --------------------------------------------------===//
+
+template<class PagePred_Ty, class Consumer_Ty>
+size_t visitRangePages(int pagemap_fd, const VPageRange &vp_range,
+    PagePred_Ty page_pred, Consumer_Ty &consumer);
+
+template<class RangePred_Ty, class PagePred_Ty, class Consumer_Ty>
+size_t visitPages(const CmdOptions &cmd_opts, Process &proc,
+    RangePred_Ty range_pred, PagePred_Ty page_pred, Consumer_Ty &consumer);
+
+template<class RangePred_Ty, class PagePred_Ty, class Proj_Ty>
+std::vector<decltype(std::declval<Proj_Ty&>()(std::declval<const RawPage&>()))>
+collectPages(const CmdOptions &cmd_opts, Process &proc, RangePred_Ty range_pred,
+    PagePred_Ty page_pred, Proj_Ty proj);
+
+#include "PageVisitor.tcc"
+
+#endif
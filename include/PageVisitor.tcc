@@ -0,0 +1,118 @@
+//===- PageVisitor.tcc ----------------------------------------------------===//
+//
+// Implementation of template functions
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_PAGEVISITOR_TCC_INCLUDE_
+#define LSMMAP_PAGEVISITOR_TCC_INCLUDE_
+
+#include "Diagnostics.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <climits>
+#include <unistd.h>
+
+/**
+ * \brief Decodes the pagemap entries of a single range and calls
+ * \brief \c consumer for each page matching \c page_pred.
+ * \param pagemap_fd The open pagemap file of the process owning the range.
+ *
+ * The entries are read in chunks into a reused buffer and decoded in place.
+ * Returns the number of matching pages.
+ */
+template<class PagePred_Ty, class Consumer_Ty>
+size_t visitRangePages(int pagemap_fd, const VPageRange &vp_range,
+    PagePred_Ty page_pred, Consumer_Ty &consumer) {
+  if ((pagemap_fd < 0)
+   || (vp_range.getMappingType() == VPageRange::MappingType::Unmapped)) {
+    return 0;
+  }
+  const uint64_t page_size = vp_range.getPageSize();
+  const uint64_t first_address = vp_range.getFirstAddress() & (~(page_size - 1));
+  const uint64_t next_address = (vp_range.getNextAddress() + page_size - 1)
+                                & (~(page_size - 1));
+  const uint64_t max_chunk_entries = 4096;
+  uint64_t page_words[max_chunk_entries];
+  size_t matched_pages = 0;
+  RawPage cur_page;
+  cur_page.vp_range = &vp_range;
+  for (uint64_t cur_address = first_address; cur_address < next_address; ) {
+    const uint64_t cur_chunk_entries =
+        std::min((next_address - cur_address) / page_size, max_chunk_entries);
+    const off_t cur_offset = (cur_address / page_size) * (64 / CHAR_BIT);
+    const ssize_t read_bytes = pread(pagemap_fd, page_words,
+        cur_chunk_entries * sizeof(uint64_t), cur_offset);
+    ScanStats::count(ScanStats::Counter::Syscalls);
+    if (read_bytes <= 0) {
+      if (read_bytes == -1) {
+        errs() << "Could not properly read from pagemap file!" << std::endl;
+        printSystemError("pread:");
+      }
+      break;
+    }
+    ScanStats::count(ScanStats::Counter::BytesRead, read_bytes);
+    const uint64_t valid_entries = read_bytes / sizeof(uint64_t);
+    for (uint64_t i = 0; i < valid_entries; ++i) {
+      cur_page.address = cur_address + i * page_size;
+      cur_page.page_word = page_words[i];
+      if (page_pred(cur_page) == true) {
+        consumer(cur_page);
+        ++matched_pages;
+      }
+    }
+    if (valid_entries < cur_chunk_entries) {
+      break;
+    }
+    cur_address += cur_chunk_entries * page_size;
+  }
+  return matched_pages;
+}
+
+/**
+ * \brief Calls \c consumer for each page of the process that lies in a range
+ * \brief matching \c range_pred and matches \c page_pred.
+ *
+ * The ranges of the process must have been populated before, its pages do
+ * not have to. The pagemap file of the process is reused and stays open
+ * after the call like for \c Process::populatePages(). Processes which are
+ * not backed by /proc have no pages to visit. Returns the number of
+ * matching pages.
+ */
+template<class RangePred_Ty, class PagePred_Ty, class Consumer_Ty>
+size_t visitPages(const CmdOptions &cmd_opts, Process &proc,
+    RangePred_Ty range_pred, PagePred_Ty page_pred, Consumer_Ty &consumer) {
+  const int pagemap_fd = proc.getPageMapFD(cmd_opts);
+  if (pagemap_fd == -1) {
+    return 0;
+  }
+  size_t matched_pages = 0;
+  for (const VPageRange &cur_vp_range : proc.getVPageRanges()) {
+    if (range_pred(cur_vp_range) == false) {
+      continue;
+    }
+    matched_pages += visitRangePages(pagemap_fd, cur_vp_range, page_pred, consumer);
+  }
+  return matched_pages;
+}
+
+/**
+ * \brief Returns the projections of all matching pages of the process.
+ *
+ * See \c visitPages for the selection of the pages.
+ */
+template<class RangePred_Ty, class PagePred_Ty, class Proj_Ty>
+std::vector<decltype(std::declval<Proj_Ty&>()(std::declval<const RawPage&>()))>
+collectPages(const CmdOptions &cmd_opts, Process &proc, RangePred_Ty range_pred,
+    PagePred_Ty page_pred, Proj_Ty proj) {
+  typedef decltype(std::declval<Proj_Ty&>()(std::declval<const RawPage&>())) Result_Ty;
+  std::vector<Result_Ty> results;
+  auto consumer = [&results, &proj](const RawPage &page) {
+    results.push_back(proj(page));
+  };
+  visitPages(cmd_opts, proc, range_pred, page_pred, consumer);
+  return results;
+}
+
+#endif
@@ -0,0 +1,76 @@
+//===- PathTable.h --------------------------------------------------------===//
+//
+// This file contains the PathTable class that stores each mapped file path
+// once and identifies it by an integer id.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_PATHTABLE_H_INCLUDE_
+#define LSMMAP_PATHTABLE_H_INCLUDE_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * This class interns paths. Every distinct path is stored once and gets an id
+ * that remains valid for the lifetime of the table. The empty path always has
+ * the id \c empty_path. All functions can be used from several threads at
+ * once. Only \c intern() takes a lock, paths are looked up without one.
+ */
+class PathTable {
+public:
+  typedef uint32_t PathID;
+  static const PathID empty_path = 0;
+
+private:
+  // The first chunk of path pointers holds 2^first_chunk_shift paths, each
+  // further chunk is twice as large. So a few chunks hold all possible ids.
+  static const unsigned first_chunk_shift = 8;
+  static const unsigned num_chunks = 33 - first_chunk_shift;
+
+  struct PathHash {
+    size_t operator()(const std::string *path) const {
+      return std::hash<std::string>()(*path);
+    }
+  };
+  struct PathEqual {
+    bool operator()(const std::string *lhs, const std::string *rhs) const {
+      return *lhs == *rhs;
+    }
+  };
+
+  typedef std::unordered_map<const std::string*, PathID, PathHash, PathEqual>
+      PathID_Map_Ty;
+
+  std::mutex intern_mutex;
+  // The elements of a deque do not move when it grows
+  std::deque<std::string> paths;
+  PathID_Map_Ty path_ids;
+  // Indexing the deque while it grows is not safe, so the paths are looked up
+  // through chunks of pointers that never move once they are allocated. A
+  // path is published by increasing num_paths after its pointer was stored.
+  std::unique_ptr<const std::string*[]> path_chunks[num_chunks];
+  std::atomic<PathID> num_paths;
+
+  static void locateID(PathID id, unsigned &chunk, size_t &offset);
+
+public:
+  PathTable(void);
+  PathTable(const PathTable &other) = delete;
+  PathTable& operator=(const PathTable &other) = delete;
+
+  PathID intern(const std::string &path);
+  const std::string& getPath(PathID id) const;
+  size_t size(void) const;
+
+  static PathTable& getShared(void);
+};
+
+#endif
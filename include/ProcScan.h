@@ -0,0 +1,71 @@
+//===- ProcScan.h ---------------------------------------------------------===//
+//
+// This file contains functions to enumerate and select the processes in /proc
+// and to scan many processes in parallel.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_PROCSCAN_H_INCLUDE_
+#define LSMMAP_PROCSCAN_H_INCLUDE_
+
+#include "CmdOptions.h"
+#include "Process.h"
+
+#include <functional>
+#include <regex>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/**
+ * The fields of /proc/pid/stat needed to select processes.
+ */
+struct ProcStat {
+  std::string comm;
+  unsigned long flags;
+};
+
+/**
+ * This class decides which processes are scanned based on their command
+ * name, command line, owner and cgroup. It only reads the cheap per-process
+ * files so that unrelated processes can be dropped before their maps are
+ * parsed.
+ */
+class ProcessSelector {
+private:
+  bool match_comm;
+  bool match_cmdline;
+  bool match_uid;
+  bool match_cgroup;
+  std::regex comm_regex;
+  std::regex cmdline_regex;
+  uid_t uid;
+  std::string proc_root;
+  std::vector<unsigned long> cgroup_pids;
+
+  bool readCgroupPIDs(const std::string &cgroup_path, bool is_child);
+  bool readCmdline(const std::string &pid, std::string &cmdline) const;
+  bool readEffectiveUid(const std::string &pid, uid_t &effective_uid) const;
+
+public:
+  ProcessSelector(const CmdOptions &cmd_opts);
+
+  bool empty(void) const;
+  bool matches(const std::string &pid, const ProcStat &proc_stat) const;
+};
+
+bool readProcStat(const std::string &proc_root, const std::string &pid,
+    ProcStat &proc_stat);
+bool isKernelThread(const ProcStat &proc_stat);
+CmdOptions::PID_List_Ty enumeratePIDs(const CmdOptions &cmd_opts,
+    const ProcessSelector &selector);
+void selectPIDs(const CmdOptions &cmd_opts, const ProcessSelector &selector,
+    CmdOptions::PID_List_Ty &pids);
+std::vector<Process> createProcesses(CmdOptions &cmd_opts);
+unsigned getNumWorkers(const CmdOptions &cmd_opts, size_t num_jobs);
+void runParallel(const CmdOptions &cmd_opts, size_t num_jobs,
+    const std::function<void(size_t)> &job);
+size_t populateProcesses(const CmdOptions &cmd_opts,
+    std::vector<Process> &processes);
+
+#endif
@@ -6,6 +6,7 @@
 
 #include "CmdOptions.h"
 #include "VPage.h"
+#include "VPRangeIndex.h"
 
 #include <cstdint>
 #include <string>
@@ -17,24 +18,66 @@ public:
 
 private:
   std::string process_id;
+  std::string proc_root;
   std::string maps_filepath;
   std::string pagemap_filepath;
   VPR_List_Ty vp_ranges;
+  VPRangeIndex range_index;
+  std::string maps_content;
+  Arena *page_arena;
+  int pid_fd;
+  int proc_dir_fd;
+  int maps_fd;
+  int pagemap_fd;
+  bool accessible;
 
+  static int duplicateFD(int fd);
   bool checkForFiles(void);
+  void openPidFD(void);
+  void closeFiles(void);
+  bool readMapsFile(std::string &content);
+  bool hasVanished(void) const;
+  bool isAddressSpaceGone(const VPageRange &vp_range);
+  bool openPageMapFile(const CmdOptions &cmd_opts);
+  size_t parseFileRanges(const CmdOptions &cmd_opts);
 
 public:
-  Process(std::string pid);
+  Process(std::string pid, const std::string &procroot = "/proc");
+  Process(std::string pid, const VPR_List_Ty &ranges);
+  Process(std::string pid, VPR_List_Ty &&ranges);
+  Process(const Process &other);
+  Process(Process &&other) noexcept;
+  Process& operator=(const Process &other);
+  Process& operator=(Process &&other) noexcept;
+  ~Process(void);
 
   const std::string& getPID(void) const;
 
   std::string getMapsFilePath(void) const;
   std::string getPageMapFilePath(void) const;
   const VPR_List_Ty& getVPageRanges(void) const;
+  const VPRangeIndex& getVPRangeIndex(void) const;
+  const VPageRange* findVPageRange(uint64_t address) const;
+  std::vector<const VPageRange*> findVPageRanges(uint64_t lower_address,
+      uint64_t upper_address) const;
+  void findVPageRanges(const std::vector<uint64_t> &addresses,
+      std::vector<const VPageRange*> &ranges) const;
 
   size_t populateMixedRange(const CmdOptions &cmd_opts);
   size_t populateFileRanges(const CmdOptions &cmd_opts);
+  bool refreshFileRanges(const CmdOptions &cmd_opts);
   size_t populatePages(const CmdOptions &cmd_opts);
+  size_t populateRangePages(const CmdOptions &cmd_opts, size_t range_pos,
+      uint64_t first_page, uint64_t max_pages);
+  void releaseRangePages(size_t range_pos);
+  void releaseFileRanges(void);
+  void setPageArena(Arena *arena);
+  int getPageMapFD(const CmdOptions &cmd_opts);
+  void closePageMapFile(void);
+  bool clearSoftDirtyBits(void) const;
+  bool isAccessible(void) const;
+  bool hasExited(void) const;
+  bool checkAlive(void);
 };
 
 #endif
@@ -0,0 +1,120 @@
+//===- ReverseMap.h -------------------------------------------------------===//
+//
+// This file contains the classes to find the processes and virtual addresses
+// that map a given set of physical frames.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_REVERSEMAP_H_INCLUDE_
+#define LSMMAP_REVERSEMAP_H_INCLUDE_
+
+#include "CmdOptions.h"
+#include "PageVisitor.h"
+#include "Process.h"
+#include "VPage.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * This class is a set of frame numbers built from ranges of them. If the
+ * frames lie close together the set is stored as a bitmap, otherwise the
+ * merged ranges are searched. Either way a lookup is cheap enough to be done
+ * for every decoded pagemap entry.
+ */
+class FrameSet {
+public:
+  // Sets spanning more frames are not stored as a bitmap (16 MiB)
+  static const uint64_t max_bitmap_frames = 1ULL << 27;
+
+private:
+  CmdOptions::FR_List_Ty frame_ranges;
+  std::vector<uint64_t> frame_bitmap;
+  uint64_t first_frame;
+  uint64_t last_frame;
+
+public:
+  FrameSet(const CmdOptions::FR_List_Ty &ranges);
+
+  bool empty(void) const { return frame_ranges.empty(); }
+  uint64_t size(void) const;
+
+  bool contains(uint64_t frame_no) const {
+    if ((frame_no < first_frame) || (frame_no > last_frame)) {
+      return false;
+    }
+    if (frame_bitmap.empty() == false) {
+      const uint64_t bit_no = frame_no - first_frame;
+      return ((frame_bitmap[bit_no / 64] >> (bit_no % 64)) & 1) != 0;
+    }
+    // Find the first range ending at or above the frame
+    CmdOptions::FR_List_Ty::const_iterator range_it = std::lower_bound(
+        frame_ranges.begin(), frame_ranges.end(), frame_no,
+        [](const std::pair<uint64_t, uint64_t> &range, uint64_t frameno) {
+          return range.second < frameno;
+        });
+    return (range_it != frame_ranges.end()) && (range_it->first <= frame_no);
+  }
+};
+
+/**
+ * A page predicate for the page visitor that matches the pages present in a
+ * frame of the set.
+ */
+struct FrameSetPage {
+  const FrameSet *frame_set;
+
+  FrameSetPage(const FrameSet &frameset) : frame_set(&frameset) {}
+  bool operator()(const RawPage &page) const {
+    return page.isPresentRAM() && frame_set->contains(page.getFrameNumber());
+  }
+};
+
+/**
+ * A page predicate that matches the present pages whose frame number is
+ * hidden (e.g. without root privileges).
+ */
+struct HiddenFramePage {
+  bool operator()(const RawPage &page) const {
+    return page.isPresentRAM() && (page.getFrameNumber() == 0);
+  }
+};
+
+/**
+ * This class holds a single virtual page that maps one of the requested
+ * frames. The range is referenced and not copied so the process it belongs
+ * to must outlive this object.
+ */
+class FrameMapping {
+public:
+  uint64_t frame_no;
+  uint32_t process_no;
+  VPage vpage;
+  const VPageRange *vp_range;
+
+  FrameMapping(uint32_t processno, const RawPage &page);
+
+  bool operator<(const FrameMapping &other) const;
+};
+
+/**
+ * This class holds the result of a reverse lookup: the mappings of the
+ * requested frames sorted by frame, process and address, and the number of
+ * present pages that could not be checked as their frame number is hidden.
+ */
+class ReverseLookup {
+public:
+  std::vector<FrameMapping> frame_mappings;
+  uint64_t hidden_pages;
+
+  ReverseLookup(void);
+
+  size_t getNumFrames(void) const;
+  size_t getNumProcesses(void) const;
+};
+
+ReverseLookup lookupFrames(const CmdOptions &cmd_opts,
+    std::vector<Process> &processes);
+
+#endif
@@ -0,0 +1,77 @@
+//===- Sampling.h ---------------------------------------------------------===//
+//
+// This file contains the classes to estimate the page statistics of page
+// ranges from a sample of their pages instead of reading all of them.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_SAMPLING_H_INCLUDE_
+#define LSMMAP_SAMPLING_H_INCLUDE_
+
+#include "CmdOptions.h"
+#include "PMemory.h"
+#include "Process.h"
+#include "VPage.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * This class estimates the fraction of the pages of a population that have
+ * some property from the number of sampled pages having it. The confidence
+ * interval is the Wilson score interval. As the pages are sampled without
+ * replacement its width is reduced by the finite population correction, so
+ * the interval collapses to the exact value if all pages were sampled.
+ */
+class ProportionEstimate {
+public:
+  uint64_t hits;
+  uint64_t sampled;
+  uint64_t population;
+
+  ProportionEstimate(void);
+
+  double getFraction(void) const;
+  void getInterval(double &lower, double &upper) const;
+};
+
+/**
+ * This class holds the estimates for a single page range. The range is
+ * referenced and not copied so the process it belongs to must outlive this
+ * object.
+ */
+class RangeSample {
+public:
+  const VPageRange *vp_range;
+  uint64_t sampled_pages;
+  ProportionEstimate resident;
+  ProportionEstimate swapped;
+  ProportionEstimate dirty;
+  ProportionEstimate thp;
+
+  RangeSample(const VPageRange &range);
+};
+
+/**
+ * This class holds the estimates of all mapped ranges of a process.
+ */
+class ProcessSample {
+public:
+  typedef std::vector<RangeSample> RS_List_Ty;
+
+  std::string process_id;
+  uint64_t sampled_pages;
+  uint64_t total_pages;
+  RS_List_Ty range_samples;
+
+  ProcessSample(const std::string &pid);
+};
+
+std::vector<uint64_t> choosePageSample(uint64_t num_pages, uint64_t sample_size,
+    bool strided, std::mt19937_64 &generator);
+ProcessSample sampleProcess(const CmdOptions &cmd_opts, const Process &proc,
+    std::mt19937_64 &generator);
+
+#endif
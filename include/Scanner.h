@@ -0,0 +1,127 @@
+//===- Scanner.h ----------------------------------------------------------===//
+//
+// This file contains the Scanner class that runs the whole scan pipeline and
+// returns its results as objects. It is the entry point for programs that
+// embed liblsmmap instead of running the lsmmap executable.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_SCANNER_H_INCLUDE_
+#define LSMMAP_SCANNER_H_INCLUDE_
+
+#include "Arena.h"
+#include "CmdOptions.h"
+#include "Content.h"
+#include "Contiguity.h"
+#include "FileUsage.h"
+#include "PMemory.h"
+#include "Process.h"
+#include "ReverseMap.h"
+#include "Sampling.h"
+#include "SnapshotDiff.h"
+#include "SoftDirty.h"
+#include "Swap.h"
+#include "Watch.h"
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+/**
+ * The kinds of scans selected by the options. Translate, Watch and Budget
+ * stream their results while scanning, all others fill a \c ScanResult.
+ */
+enum class ScanMode {Pages = 0, Save, Files, Swap, Contiguity, FrameLookup,
+                     Content, Sample, SoftDirty, Fragmentation, Diff,
+                     Translate, Watch, Budget};
+
+/**
+ * This class holds the results of a scan: the scanned processes with their
+ * ranges and pages and the frames the pages are mapped to. Only the analysis
+ * of the mode the scan was run in is filled, the others stay empty. Several
+ * analyses refer to the processes, so they must not be moved out of the
+ * result while the analyses are used.
+ *
+ * The pages of each process and the frames are stored in arenas owned by the
+ * result. Each arena is only used by the thread reading its process, so no
+ * arena needs to be synchronized. The arenas are released with the result,
+ * hence they are declared before anything stored in them.
+ */
+class ScanResult {
+public:
+  std::vector<std::unique_ptr<Arena> > arenas;
+  ScanMode mode;
+  std::vector<Process> processes;
+  PMemory pmem;
+  std::vector<FileUsage> file_usages;
+  SwapLayout swap_layout;
+  std::vector<ProcessContiguity> contiguities;
+  ReverseLookup frame_lookup;
+  std::vector<ProcessContent> contents;
+  std::vector<ProcessSample> samples;
+  std::vector<ProcessWriteSet> write_sets;
+  double write_interval;
+  std::vector<ZoneFragmentation> zones;
+  PD_List_Ty proc_diffs;
+
+  ScanResult(void);
+  ScanResult(ScanResult &&other) = default;
+  ScanResult& operator=(ScanResult &&other) = delete;
+
+  Arena* createArena(void);
+  uint64_t getReservedBytes(void) const;
+};
+
+/**
+ * This class scans the processes selected by the given options.
+ *
+ * The options are the same as the ones of the lsmmap executable. They can be
+ * parsed from a command line or be set directly. None of the functions prints
+ * any results or exits the program, only the streaming modes write their
+ * results to the given stream or consumer while scanning. Error messages are
+ * written to \c errs().
+ */
+class Scanner {
+public:
+  typedef std::function<void(double, const PDelta_List_Ty&)> WatchConsumer_Ty;
+
+private:
+  CmdOptions cmd_opts;
+
+  bool selectProcesses(ScanResult &result);
+  bool readPages(ScanResult &result, bool with_frames);
+  bool loadSnapshot(ScanResult &result);
+  bool captureSnapshot(ScanResult &result);
+  bool analyzeFiles(ScanResult &result);
+  bool analyzeSwap(ScanResult &result);
+  bool analyzeContiguity(ScanResult &result);
+  bool lookupFrames(ScanResult &result);
+  bool analyzeContent(ScanResult &result);
+  bool sampleProcesses(ScanResult &result);
+  bool trackWrites(ScanResult &result);
+  bool scanFragmentation(ScanResult &result);
+  bool diffSnapshots(ScanResult &result);
+
+public:
+  Scanner(const CmdOptions &opts);
+
+  const CmdOptions& getOptions(void) const;
+  ScanMode getMode(void) const;
+
+  bool selectProcesses(std::vector<Process> &processes);
+  size_t populateProcesses(std::vector<Process> &processes) const;
+  size_t loadFrames(const std::vector<Process> &processes, PMemory &pmem) const;
+  bool scan(ScanResult &result);
+  bool run(ScanResult &result);
+
+  bool translate(std::istream &requests, std::ostream &answers);
+  bool watch(const WatchConsumer_Ty &consumer);
+  bool scanWithinBudget(std::ostream &stream);
+};
+
+std::vector<uint64_t> collectFrameNumbers(const std::vector<Process> &processes);
+
+#endif
@@ -0,0 +1,127 @@
+//===- Snapshot.h ---------------------------------------------------------===//
+//
+// This file contains the functions to save collected page ranges, pages and
+// frames into a snapshot file and the Snapshot class that gives zero-copy
+// access to such a file.
+//
+// A snapshot file is laid out so that it can be mapped into memory and used
+// without any further parsing. All sections start at 8 byte aligned offsets
+// and are stored in the native byte order of the capturing host:
+//
+//   SnapshotHeader
+//   SnapshotProcess[num_processes]
+//   SnapshotRange[num_ranges]
+//   uint64_t page_words[num_pages]        (raw pagemap entries)
+//   uint64_t page_valid[(num_pages+63)/64] (one validity bit per page)
+//   SnapshotFrame[num_frames]              (sorted by frame number)
+//   char strings[strings_size]             (pids and mapped file paths)
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_SNAPSHOT_H_INCLUDE_
+#define LSMMAP_SNAPSHOT_H_INCLUDE_
+
+#include "CmdOptions.h"
+#include "PMemory.h"
+#include "Process.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+static const char snapshot_magic[8] = {'L', 'S', 'M', 'M', 'A', 'P', 'S', 'N'};
+static const uint32_t snapshot_version = 1;
+static const uint64_t snapshot_byte_order = 0x0102030405060708;
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint64_t byte_order;
+  uint64_t page_size;
+  uint64_t prog_mode;
+  uint64_t capture_time;
+  uint64_t num_processes;
+  uint64_t num_ranges;
+  uint64_t num_pages;
+  uint64_t num_frames;
+  uint64_t processes_offset;
+  uint64_t ranges_offset;
+  uint64_t pages_offset;
+  uint64_t valid_offset;
+  uint64_t frames_offset;
+  uint64_t strings_offset;
+  uint64_t strings_size;
+  uint64_t file_size;
+};
+
+struct SnapshotProcess {
+  uint64_t pid_offset;
+  uint64_t pid_length;
+  uint64_t first_range;
+  uint64_t num_ranges;
+};
+
+struct SnapshotRange {
+  uint64_t first_address;
+  uint64_t next_address;
+  uint64_t map_offset;
+  uint64_t first_page;
+  uint64_t num_pages;
+  uint64_t path_offset;
+  uint32_t path_length;
+  uint32_t range_no;
+  uint8_t map_ty;
+  uint8_t perm_canread;
+  uint8_t perm_canwrite;
+  uint8_t perm_canexec;
+  uint8_t perm_isprivate;
+  uint8_t reserved[7];
+};
+
+struct SnapshotFrame {
+  uint64_t frame_no;
+  uint64_t frame_props;
+  uint64_t frame_refcount;
+  uint64_t frame_props_valid;
+};
+
+bool saveSnapshot(const CmdOptions &cmd_opts, const std::string &path,
+    const std::vector<Process> &processes, const PMemory &pmem);
+
+/**
+ * This class maps a snapshot file into memory and provides direct access to
+ * the stored records. The processes, ranges, pages and frames can also be
+ * materialized into the regular \c Process and \c PMemory objects so that all
+ * output functions can be used on a snapshot.
+ */
+class Snapshot {
+private:
+  int snapshot_fd;
+  const char *mapped_data;
+  size_t mapped_size;
+  const SnapshotHeader *header;
+
+  Snapshot(const Snapshot &) = delete;
+  Snapshot& operator=(const Snapshot &) = delete;
+
+public:
+  Snapshot(const std::string &path);
+  ~Snapshot(void);
+
+  const SnapshotHeader& getHeader(void) const;
+  const SnapshotProcess* getProcesses(void) const;
+  const SnapshotRange* getRanges(void) const;
+  const uint64_t* getPageWords(void) const;
+  bool isPageValid(uint64_t page_no) const;
+  const SnapshotFrame* getFrames(void) const;
+  const SnapshotFrame* findFrame(uint64_t frame_no) const;
+  bool isProcessRecordValid(const SnapshotProcess &record) const;
+  bool isRangeRecordValid(const SnapshotRange &record) const;
+  std::string getString(uint64_t offset, uint64_t length) const;
+  VPageRange makeVPageRange(const SnapshotRange &record) const;
+
+  size_t materialize(std::vector<Process> &processes, PMemory &pmem) const;
+};
+
+#endif
@@ -0,0 +1,91 @@
+//===- SnapshotDiff.h -----------------------------------------------------===//
+//
+// This file contains the classes to compute the differences between two
+// snapshots of the same processes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_SNAPSHOTDIFF_H_INCLUDE_
+#define LSMMAP_SNAPSHOTDIFF_H_INCLUDE_
+
+#include "Snapshot.h"
+#include "VPage.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * This class describes how a single virtual page changed between two
+ * snapshots. A page that only exists in one of the snapshots has an invalid
+ * page word for the other one.
+ */
+class PageChange {
+public:
+  enum ChangeKind {
+    PageAdded       = 1 << 0,
+    PageRemoved     = 1 << 1,
+    NewlyResident   = 1 << 2,
+    SwappedOut      = 1 << 3,
+    Dropped         = 1 << 4,
+    FrameChanged    = 1 << 5,
+    BecameDirty     = 1 << 6,
+    BecameClean     = 1 << 7,
+    BecameActive    = 1 << 8,
+    BecameInactive  = 1 << 9
+  };
+  static const unsigned num_change_kinds = 10;
+
+  uint64_t address;
+  uint64_t old_page_word;
+  uint64_t new_page_word;
+  bool old_page_valid;
+  bool new_page_valid;
+  unsigned changes;
+
+  PageChange(uint64_t pageaddress);
+};
+
+/**
+ * This class aggregates the page changes of one virtual page range. Pages that
+ * exist in the new snapshot are counted for the range of the new snapshot, all
+ * others for the range of the old snapshot.
+ */
+class RangeDiff {
+public:
+  enum class Status {Kept = 0, Added, Removed};
+  typedef std::vector<PageChange> PC_List_Ty;
+
+  Status status;
+  VPageRange vp_range;
+  uint64_t change_counts[PageChange::num_change_kinds];
+  PC_List_Ty page_changes;
+
+  RangeDiff(Status rangestatus, const VPageRange &range);
+
+  bool hasChanges(void) const;
+  uint64_t getChangeCount(PageChange::ChangeKind kind) const;
+  void addPageChange(const PageChange &change, bool keep_page);
+};
+
+/**
+ * This class holds the differences of one process between two snapshots.
+ */
+class ProcessDiff {
+public:
+  enum class Status {Kept = 0, Added, Removed};
+  typedef std::vector<RangeDiff> RD_List_Ty;
+
+  Status status;
+  std::string process_id;
+  RD_List_Ty range_diffs;
+
+  ProcessDiff(Status procstatus, const std::string &pid);
+};
+
+typedef std::vector<ProcessDiff> PD_List_Ty;
+
+PD_List_Ty diffSnapshots(const Snapshot &old_snapshot,
+    const Snapshot &new_snapshot, bool keep_pages);
+
+#endif
@@ -0,0 +1,50 @@
+//===- SoftDirty.h --------------------------------------------------------===//
+//
+// This file contains the classes to determine the set of pages a process
+// wrote to since its soft-dirty bits were cleared.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_SOFTDIRTY_H_INCLUDE_
+#define LSMMAP_SOFTDIRTY_H_INCLUDE_
+
+#include "Process.h"
+#include "VPage.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * This class holds the number of written pages of a single page range. The
+ * range is referenced and not copied so the process it belongs to must
+ * outlive this object.
+ */
+class RangeWriteSet {
+public:
+  const VPageRange *vp_range;
+  uint64_t written_pages;
+  uint64_t resident_pages;
+
+  RangeWriteSet(const VPageRange &range);
+};
+
+/**
+ * This class holds the write set of a process, i.e. the ranges that contain
+ * pages whose soft-dirty bit is set.
+ */
+class ProcessWriteSet {
+public:
+  typedef std::vector<RangeWriteSet> RWS_List_Ty;
+
+  std::string process_id;
+  uint64_t written_pages;
+  uint64_t written_bytes;
+  RWS_List_Ty range_write_sets;
+
+  ProcessWriteSet(const std::string &pid);
+};
+
+ProcessWriteSet computeWriteSet(const Process &proc);
+
+#endif
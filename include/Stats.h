@@ -0,0 +1,80 @@
+//===- Stats.h ------------------------------------------------------------===//
+//
+// This file contains the ScanStats class that collects the time spent in the
+// phases of a scan and counts the system calls and processed data.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_STATS_H_INCLUDE_
+#define LSMMAP_STATS_H_INCLUDE_
+
+#include "Trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * This class collects statistics about a scan. All functions are static and
+ * can be used from several threads at once. Nothing is recorded unless the
+ * statistics are enabled, so the instrumentation is cheap when --stats is not
+ * given.
+ */
+class ScanStats {
+public:
+  enum class Phase {PIDValidation = 0, MapsParsing, PagemapReads,
+                    FrameCollection, FrameReads, ContentReads, Output};
+  static const unsigned num_phases = 7;
+  enum class Counter {Syscalls = 0, BytesRead, Processes, Ranges, Pages, Frames};
+  static const unsigned num_counters = 6;
+
+  /**
+   * Measures the wall and CPU time from its construction to its destruction
+   * and adds them to the given phase. The phase is also recorded as a span
+   * if tracing is enabled.
+   */
+  class PhaseTimer {
+  private:
+    Phase phase;
+    TraceSpan span;
+    std::chrono::steady_clock::time_point wall_start;
+    uint64_t cpu_start_ns;
+
+  public:
+    PhaseTimer(Phase timedphase);
+    ~PhaseTimer(void);
+  };
+
+private:
+  static std::atomic<bool> enabled;
+  static std::atomic<uint64_t> counters[num_counters];
+  static std::atomic<uint64_t> phase_wall_ns[num_phases];
+  static std::atomic<uint64_t> phase_cpu_ns[num_phases];
+  static std::atomic<uint64_t> budget_limit;
+  static std::atomic<uint64_t> budget_peak;
+  static std::atomic<uint64_t> budget_rss_growth;
+  static std::atomic<uint64_t> arena_peak;
+
+public:
+  static void enable(void);
+  static bool isEnabled(void);
+
+  /**
+   * \brief Adds \c value to the given counter if the statistics are enabled.
+   */
+  static void count(Counter counter, uint64_t value = 1) {
+    if (enabled.load(std::memory_order_relaxed) == true) {
+      counters[static_cast<unsigned>(counter)].fetch_add(value,
+          std::memory_order_relaxed);
+    }
+  }
+  static uint64_t getCounter(Counter counter);
+  static void recordBudget(uint64_t limit, uint64_t peak, uint64_t rss_growth);
+  static void recordArenaBytes(uint64_t reserved);
+  static uint64_t getResidentBytes(void);
+  static uint64_t getPeakResidentBytes(void);
+  static void print(std::ostream &stream, bool json);
+};
+
+#endif
@@ -0,0 +1,107 @@
+//===- Swap.h -------------------------------------------------------------===//
+//
+// This file contains the classes to analyze where the swapped pages of
+// processes are stored on the swap devices and how costly it is to fault
+// them back in.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_SWAP_H_INCLUDE_
+#define LSMMAP_SWAP_H_INCLUDE_
+
+#include "CmdOptions.h"
+#include "Process.h"
+#include "VPage.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * This class holds the swap layout of a single page range. The range is
+ * referenced and not copied so the process it belongs to must outlive this
+ * object.
+ *
+ * The swapped pages are visited in the order of their addresses. A run is a
+ * maximal sequence of them whose swap slots directly follow each other on the
+ * same device. Between two runs on the same device the distance of the slots
+ * is added to the seek distance. Faulting in a page reads the whole aligned
+ * cluster of 2^page-cluster slots containing it (the swap readahead of the
+ * kernel), so the reads are the distinct clusters of the range and the read
+ * amplification is the number of slots read per swapped page. Swapped pages
+ * whose location is hidden (e.g. without root privileges) are counted as
+ * unresolved pages and do not take part in the layout.
+ */
+class RangeSwap {
+public:
+  const VPageRange *vp_range;
+  uint64_t swapped_pages;
+  uint64_t unresolved_pages;
+  uint64_t num_runs;
+  uint64_t num_seeks;
+  uint64_t seek_distance;
+  uint64_t num_reads;
+  unsigned page_cluster;
+
+  RangeSwap(const VPageRange &range, unsigned pagecluster);
+
+  uint64_t getReadPages(void) const;
+  double getMeanRunLength(void) const;
+  double getMeanSeekDistance(void) const;
+  double getReadAmplification(void) const;
+};
+
+/**
+ * This class holds the swap layout of all ranges of a process that contain
+ * swapped pages.
+ */
+class ProcessSwap {
+public:
+  typedef std::vector<RangeSwap> RS_List_Ty;
+
+  std::string process_id;
+  RS_List_Ty range_swaps;
+
+  ProcessSwap(const std::string &pid);
+
+  uint64_t getCount(uint64_t RangeSwap::*counter) const;
+  uint64_t getReadPages(void) const;
+};
+
+/**
+ * This class holds the slots of a swap device that are used by the scanned
+ * processes. A slot referenced by several pages (e.g. after a fork) is
+ * counted once. The clusters are the aligned clusters of 2^page-cluster
+ * slots that contain at least one of the used slots.
+ */
+class SwapDevice {
+public:
+  unsigned swap_type;
+  std::string device_path;
+  uint64_t used_slots;
+  uint64_t num_processes;
+  uint64_t first_slot;
+  uint64_t last_slot;
+  uint64_t num_clusters;
+
+  SwapDevice(unsigned swaptype, const std::string &devicepath);
+};
+
+/**
+ * This class holds the result of the swap analysis of several processes.
+ */
+class SwapLayout {
+public:
+  unsigned page_cluster;
+  std::vector<ProcessSwap> process_swaps;
+  std::vector<SwapDevice> swap_devices;
+
+  SwapLayout(unsigned pagecluster);
+};
+
+unsigned readPageCluster(const CmdOptions &cmd_opts);
+std::vector<std::string> readSwapDevicePaths(const CmdOptions &cmd_opts);
+SwapLayout analyzeSwap(const CmdOptions &cmd_opts,
+    const std::vector<Process> &processes);
+
+#endif
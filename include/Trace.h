@@ -0,0 +1,58 @@
+//===- Trace.h ------------------------------------------------------------===//
+//
+// This file contains the classes to record the execution of a scan as spans
+// and to export them in the Chrome trace-event format (which can be viewed
+// with chrome://tracing or Perfetto).
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_TRACE_H_INCLUDE_
+#define LSMMAP_TRACE_H_INCLUDE_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * This class collects the recorded spans. Each thread records into its own
+ * buffer so that recording does not need any locks. The buffers are only
+ * merged when the trace is written.
+ */
+class Tracer {
+private:
+  static std::atomic<bool> enabled;
+
+public:
+  static void enable(void);
+  static bool isEnabled(void) {
+    return enabled.load(std::memory_order_relaxed);
+  }
+  static bool write(const std::string &path);
+};
+
+/**
+ * This class records a single span from its construction to its destruction.
+ * If tracing is disabled nothing is recorded. The span may carry one argument
+ * that is either a string or a number.
+ */
+class TraceSpan {
+private:
+  const char *name;
+  const char *arg_name;
+  std::string arg_str;
+  uint64_t arg_num;
+  bool numeric_arg;
+  bool active;
+  std::chrono::steady_clock::time_point start;
+
+public:
+  TraceSpan(const char *spanname);
+  TraceSpan(const char *spanname, const char *argname, const std::string &argvalue);
+  TraceSpan(const char *spanname, const char *argname, uint64_t argvalue);
+  TraceSpan(const TraceSpan &other) = delete;
+  TraceSpan& operator=(const TraceSpan &other) = delete;
+  ~TraceSpan(void);
+};
+
+#endif
@@ -0,0 +1,85 @@
+//===- Translate.h --------------------------------------------------------===//
+//
+// This file contains the classes to translate single virtual addresses of
+// processes to physical addresses without populating whole page ranges.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_TRANSLATE_H_INCLUDE_
+#define LSMMAP_TRANSLATE_H_INCLUDE_
+
+#include "CmdOptions.h"
+#include "VPage.h"
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * This class holds a single request to translate the virtual address of a
+ * process.
+ */
+class TranslationRequest {
+public:
+  std::string process_id;
+  uint64_t virt_address;
+
+  TranslationRequest(const std::string &pid, uint64_t address);
+};
+
+bool parseTranslationRequest(const std::string &line, TranslationRequest &request);
+
+/**
+ * This class holds the result of a translation. The page holds the pagemap
+ * entry of the page containing the requested address. It is only valid if
+ * the translation succeeded.
+ */
+class AddressTranslation {
+public:
+  enum class Status {Translated = 0, NoProcess, ReadError};
+
+  std::string process_id;
+  uint64_t virt_address;
+  VPage vpage;
+  Status status;
+
+  AddressTranslation(const TranslationRequest &request, uint64_t page_address);
+  uint64_t getPhysAddress(uint64_t frame_address) const;
+};
+
+/**
+ * This class translates batches of virtual addresses. The requests of a
+ * batch are grouped by process and sorted by their offset within the
+ * pagemap file so that the entries of one page table are read with a single
+ * system call. Only the entries of the requested pages are read. The pagemap
+ * files are kept open between batches.
+ */
+class AddressTranslator {
+private:
+  std::string proc_root;
+  std::map<std::string, int> pagemap_fds;
+  uint64_t page_size;
+
+  int getPageMapFD(const std::string &pid);
+  void closePageMapFD(const std::string &pid);
+  bool readPageMapEntries(const std::string &pid, uint64_t first_page,
+      size_t num_pages, uint64_t *entries);
+
+public:
+  AddressTranslator(const std::string &procroot);
+  AddressTranslator(const AddressTranslator &other) = delete;
+  AddressTranslator& operator=(const AddressTranslator &other) = delete;
+  ~AddressTranslator(void);
+
+  std::vector<AddressTranslation> translate(
+      const std::vector<TranslationRequest> &requests);
+  void closePageMapFiles(void);
+};
+
+bool translateAddresses(const CmdOptions &cmd_opts, std::istream &in,
+    std::ostream &out);
+
+#endif
@@ -0,0 +1,46 @@
+//===- VPRangeIndex.h -----------------------------------------------------===//
+//
+// This file contains an index over the page ranges of a process that answers
+// address queries in logarithmic time.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_VPRANGEINDEX_H_INCLUDE_
+#define LSMMAP_VPRANGEINDEX_H_INCLUDE_
+
+#include "VPage.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * This class indexes the mapped ranges of a sorted list of non-overlapping
+ * page ranges. The boundaries are stored in two sorted arrays so lookups are
+ * binary searches over contiguous memory. The index stores the positions of
+ * the ranges within the indexed list (not pointers) so it remains valid when
+ * the list is copied or moved. Unmapped ranges are not indexed.
+ */
+class VPRangeIndex {
+private:
+  std::vector<uint64_t> first_addresses;
+  std::vector<uint64_t> next_addresses;
+  std::vector<size_t> positions;
+
+public:
+  static const size_t npos = static_cast<size_t>(-1);
+
+  VPRangeIndex(void);
+
+  void build(const std::vector<VPageRange> &vp_ranges);
+  void clear(void);
+  bool empty(void) const;
+  size_t size(void) const;
+
+  size_t find(uint64_t address) const;
+  std::vector<size_t> findWindow(uint64_t lower_address,
+      uint64_t upper_address) const;
+  std::vector<size_t> findBatch(const std::vector<uint64_t> &addresses) const;
+};
+
+#endif
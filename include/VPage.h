@@ -8,13 +8,45 @@
 #ifndef LSMMAP_VPAGE_H_INCLUDE_
 #define LSMMAP_VPAGE_H_INCLUDE_
 
+#include "Arena.h"
 #include "CmdOptions.h"
+#include "PathTable.h"
 
 #include <cstdint>
 #include <ostream>
 #include <string>
 #include <vector>
 
+/**
+ * This class holds the layout of the 64bit entries of the pagemap file (see
+ * Documentation/admin-guide/mm/pagemap.rst). All decoders of pagemap entries
+ * use it, so they cannot disagree about the meaning of a bit.
+ */
+class PagemapEntry {
+public:
+  static const uint64_t present_ram_bit  = 1ULL << 63;  // Since 2.6.25
+  static const uint64_t present_swap_bit = 1ULL << 62;  // Since 2.6.25
+  static const uint64_t file_mapped_bit  = 1ULL << 61;  // Since 3.5
+  static const uint64_t exclusive_bit    = 1ULL << 56;  // Since 4.2
+  static const uint64_t soft_dirty_bit   = 1ULL << 55;  // Since 3.11
+  static const uint64_t frame_mask       = (1ULL << 55) - 1;
+  static const uint64_t swap_type_mask   = (1ULL << 5) - 1;
+  static const unsigned swap_offset_shift = 5;
+
+  static bool isPresentRAM(uint64_t entry) { return (entry & present_ram_bit) != 0; }
+  static bool isPresentSwap(uint64_t entry) { return (entry & present_swap_bit) != 0; }
+  static bool isFileMapped(uint64_t entry) { return (entry & file_mapped_bit) != 0; }
+  static bool isExclusive(uint64_t entry) { return (entry & exclusive_bit) != 0; }
+  static bool isSoftDirty(uint64_t entry) { return (entry & soft_dirty_bit) != 0; }
+  static uint64_t getFrameNumber(uint64_t entry) { return entry & frame_mask; }
+  static uint8_t getSwapType(uint64_t entry) {
+    return static_cast<uint8_t>(entry & swap_type_mask);
+  }
+  static uint64_t getSwapOffset(uint64_t entry) {
+    return (entry & frame_mask) >> swap_offset_shift;
+  }
+};
+
 /**
  * This class represents a single virtual page in the address space of a
  * process and stores all the flags available.
@@ -53,13 +85,13 @@ class VPageRange {
 public:
   enum class MappingType {Unmapped = 0, Anonymous, Filemapping, Mixed};
   enum class TriState {Unknown = 0, True, False};
-  typedef std::vector<VPage> VP_List_Ty;
+  typedef std::vector<VPage, ArenaAllocator<VPage> > VP_List_Ty;
 
 private:
   MappingType map_ty;
   uint64_t first_address;
   uint64_t next_address;
-  std::string mapped_file_path;
+  PathTable::PathID mapped_file_id;
   uint64_t map_offset;
   long page_size;
   TriState perm_canread;
@@ -77,7 +109,8 @@ public:
   uint64_t getNextAddress(void) const;
   MappingType getMappingType(void) const;
   void setMappingType(MappingType newtype);
-  std::string getMappedFilePath(void) const;
+  const std::string& getMappedFilePath(void) const;
+  PathTable::PathID getMappedFileID(void) const;
   void setMappedFilePath(const std::string &path);
   uint64_t getMappingOffset(void) const;
   void setMappingOffset(uint64_t offset);
@@ -93,12 +126,19 @@ public:
   unsigned getVPRangeNumber(void) const;
   void setVPRangeNumber (unsigned new_no);
   const VP_List_Ty& getVPages(void) const;
+  void setVPages(const VP_List_Ty &pages);
+  void setVPages(VP_List_Ty &&pages);
+  void releaseVPages(void);
+  void setPageArena(Arena *arena);
+  void clip(uint64_t lower_address, uint64_t upper_address);
 
   bool empty(void) const;
   uint64_t size(void) const;
   uint64_t num(void) const;
 
   size_t populatePages(const int fd, const CmdOptions &cmd_opts);
+  size_t populatePages(const int fd, const CmdOptions &cmd_opts,
+      uint64_t first_page, uint64_t max_pages);
 };
 std::ostream& operator<<(std::ostream &stream, const VPageRange &vp_range);
 
@@ -0,0 +1,80 @@
+//===- Watch.h ------------------------------------------------------------===//
+//
+// This file contains the Watcher class that repeatedly rescans a set of
+// processes and determines how their page ranges changed between two scans.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LSMMAP_WATCH_H_INCLUDE_
+#define LSMMAP_WATCH_H_INCLUDE_
+
+#include "CmdOptions.h"
+#include "Process.h"
+#include "VPage.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * This class describes how a single page range changed between two scans.
+ */
+class RangeDelta {
+public:
+  enum class Status {Added = 0, Removed, ResidentChanged};
+
+  Status status;
+  VPageRange vp_range;
+  uint64_t old_resident;
+  uint64_t new_resident;
+
+  RangeDelta(Status deltastatus, const VPageRange &range, uint64_t oldresident,
+      uint64_t newresident);
+};
+
+/**
+ * This class holds the range deltas of one process. A process whose files
+ * could not be read anymore is marked as exited.
+ */
+class ProcessDelta {
+public:
+  typedef std::vector<RangeDelta> RD_List_Ty;
+
+  std::string process_id;
+  bool exited;
+  RD_List_Ty range_deltas;
+
+  ProcessDelta(const std::string &pid);
+};
+
+typedef std::vector<ProcessDelta> PDelta_List_Ty;
+
+/**
+ * This class keeps the watched processes and their open files alive between
+ * scans. Each call of \c update rescans all processes. The maps file is only
+ * parsed again if its content changed.
+ */
+class Watcher {
+private:
+  // The ranges of the last scan without their pages and the number of pages
+  // that were present in RAM for each of them
+  struct WatchState {
+    std::vector<VPageRange> range_shapes;
+    std::vector<uint64_t> resident_counts;
+  };
+
+  std::vector<Process> processes;
+  std::vector<WatchState> states;
+  bool first_update;
+
+  void scanProcess(const CmdOptions &cmd_opts, Process &proc, WatchState &state,
+      ProcessDelta &delta);
+
+public:
+  Watcher(std::vector<Process> &&procs);
+
+  bool empty(void) const;
+  PDelta_List_Ty update(const CmdOptions &cmd_opts);
+};
+
+#endif
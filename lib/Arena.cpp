@@ -0,0 +1,163 @@
+//===- Arena.cpp ----------------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "Arena.h"
+
+#include <algorithm>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+const size_t Arena::min_block_bytes;
+const size_t Arena::huge_page_bytes;
+
+Arena::Arena(size_t maxblockbytes)
+ : max_block_bytes(maxblockbytes),
+   next_block_bytes(std::min(min_block_bytes, maxblockbytes)), next_block(0),
+   cur_pos(nullptr), cur_end(nullptr),
+   reserved_bytes(0) {
+  for (unsigned i = 0; i < num_size_classes; ++i) {
+    free_lists[i] = nullptr;
+  }
+}
+
+Arena::~Arena(void) {
+  for (const std::pair<char*, size_t> &cur_block : blocks) {
+    munmap(cur_block.first, cur_block.second);
+  }
+  for (const std::pair<void* const, size_t> &cur_mapping : large_mappings) {
+    munmap(cur_mapping.first, cur_mapping.second);
+  }
+}
+
+/**
+ * \brief Returns the size class of an allocation of \c bytes bytes and stores
+ * \brief the number of bytes of that class in \c class_bytes.
+ *
+ * Up to 128 bytes the classes are 16 bytes apart. Above each power of two is
+ * divided into four classes so at most a fifth of an allocation is wasted.
+ */
+unsigned Arena::getSizeClass(size_t bytes, size_t &class_bytes) {
+  if (bytes <= 128) {
+    class_bytes = (bytes <= 16) ? 16
+                                : ((bytes + 15) & ~static_cast<size_t>(15));
+    return class_bytes / 16 - 1;
+  }
+  // bytes lies within (2^shift, 2^(shift + 1)]
+  const unsigned shift = 63 - __builtin_clzll(bytes - 1);
+  const size_t spacing = static_cast<size_t>(1) << (shift - 2);
+  class_bytes = (bytes + spacing - 1) & ~(spacing - 1);
+  return 8 + (shift - 7) * 4 + (class_bytes >> (shift - 2)) - 5;
+}
+
+/**
+ * \brief Maps \c bytes bytes of anonymous memory. Throws \c std::bad_alloc if
+ * \brief the mapping fails.
+ */
+void* Arena::mapMemory(size_t bytes) {
+  void *mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (mapping == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+#ifdef MADV_HUGEPAGE
+  // Only a hint, the memory is usable without huge pages as well. Smaller
+  // mappings would be blown up to a whole huge page.
+  if (bytes >= huge_page_bytes) {
+    madvise(mapping, bytes, MADV_HUGEPAGE);
+  }
+#endif
+  return mapping;
+}
+
+/**
+ * \brief Allocates \c bytes bytes aligned to 16 bytes.
+ */
+void* Arena::allocate(size_t bytes) {
+  if (bytes > max_small_bytes) {
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t mapping_bytes = (bytes + page_size - 1) & ~(page_size - 1);
+    void *mapping = mapMemory(mapping_bytes);
+    large_mappings[mapping] = mapping_bytes;
+    reserved_bytes += mapping_bytes;
+    return mapping;
+  }
+  size_t class_bytes = 0;
+  const unsigned size_class = getSizeClass(bytes, class_bytes);
+  if (free_lists[size_class] != nullptr) {
+    void *ptr = free_lists[size_class];
+    free_lists[size_class] = *static_cast<void**>(ptr);
+    return ptr;
+  }
+  if (static_cast<size_t>(cur_end - cur_pos) < class_bytes) {
+    // The rest of the current block is abandoned. Blocks kept by reset()
+    // are reused before a new one is mapped.
+    while ((next_block < blocks.size())
+        && (blocks[next_block].second < class_bytes)) {
+      ++next_block;
+    }
+    if (next_block == blocks.size()) {
+      const size_t cur_block_bytes = std::max(next_block_bytes, class_bytes);
+      char *block = static_cast<char*>(mapMemory(cur_block_bytes));
+      blocks.push_back(std::make_pair(block, cur_block_bytes));
+      reserved_bytes += cur_block_bytes;
+      next_block_bytes = std::min(2 * next_block_bytes, max_block_bytes);
+    }
+    cur_pos = blocks[next_block].first;
+    cur_end = cur_pos + blocks[next_block].second;
+    ++next_block;
+  }
+  void *ptr = cur_pos;
+  cur_pos += class_bytes;
+  return ptr;
+}
+
+/**
+ * \brief Frees the memory at \c ptr that was allocated with \c bytes bytes.
+ */
+void Arena::deallocate(void *ptr, size_t bytes) {
+  if (ptr == nullptr) {
+    return;
+  }
+  if (bytes > max_small_bytes) {
+    std::map<void*, size_t>::iterator mapping_it = large_mappings.find(ptr);
+    if (mapping_it != large_mappings.end()) {
+      munmap(mapping_it->first, mapping_it->second);
+      reserved_bytes -= mapping_it->second;
+      large_mappings.erase(mapping_it);
+    }
+    return;
+  }
+  size_t class_bytes = 0;
+  const unsigned size_class = getSizeClass(bytes, class_bytes);
+  *static_cast<void**>(ptr) = free_lists[size_class];
+  free_lists[size_class] = ptr;
+}
+
+/**
+ * \brief Frees all memory allocated from the arena at once.
+ *
+ * The blocks stay mapped and are reused by later allocations, the large
+ * allocations are unmapped. None of the memory allocated before must be
+ * used or freed afterwards.
+ */
+void Arena::reset(void) {
+  for (const std::pair<void* const, size_t> &cur_mapping : large_mappings) {
+    munmap(cur_mapping.first, cur_mapping.second);
+    reserved_bytes -= cur_mapping.second;
+  }
+  large_mappings.clear();
+  for (unsigned i = 0; i < num_size_classes; ++i) {
+    free_lists[i] = nullptr;
+  }
+  next_block = 0;
+  cur_pos = nullptr;
+  cur_end = nullptr;
+}
+
+/**
+ * \brief Returns the number of bytes mapped by the arena.
+ */
+uint64_t Arena::getReservedBytes(void) const {
+  return reserved_bytes;
+}
@@ -0,0 +1,245 @@
+//===- Budget.cpp ---------------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "Budget.h"
+#include "Arena.h"
+#include "Diagnostics.h"
+#include "Output.h"
+#include "PMemory.h"
+#include "Stats.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <iomanip>
+
+// The costs below are estimates of the memory needed, charging them does not
+// measure anything. The measured growth of the resident set is recorded next
+// to the charged peak.
+// Memory used by the pagemap read buffer of a range (see
+// VPageRange::populatePages) independent of the number of pages
+static const uint64_t fixed_cost = 4096 * sizeof(uint64_t);
+// Memory needed per page of a window: the page itself, its entry in the list
+// of frames to read and the node of its frame in the frame map
+static const uint64_t page_cost = sizeof(VPage) + sizeof(uint64_t)
+    + sizeof(PMemory::PF_Map_Ty::value_type) + 4 * sizeof(void*);
+// Memory needed per range of a process: the range, its entries in the range
+// index and its line of the cached maps file (without the path, assuming
+// about 80 characters for the rest of the line)
+static const uint64_t range_cost = sizeof(VPageRange) + 3 * sizeof(uint64_t) + 80;
+// The arena blocks holding the pages and frames of the windows are limited
+// to this fraction of the budget, so the memory reserved beyond the charged
+// pages and frames stays small
+static const uint64_t arena_block_fraction = 16;
+// Windows smaller than this are not worth reading. If not even such a window
+// fits into the budget only the ranges are printed.
+static const uint64_t min_window_pages = 64;
+// Indentation of the lines below a range (as used by printResults())
+static const int page_indent = 5;
+
+MemoryBudget::MemoryBudget(uint64_t limitbytes)
+ : limit(limitbytes), used(0), peak(0) {
+}
+
+uint64_t MemoryBudget::getLimit(void) const {
+  return limit;
+}
+
+uint64_t MemoryBudget::getUsed(void) const {
+  return used;
+}
+
+uint64_t MemoryBudget::getPeak(void) const {
+  return peak;
+}
+
+uint64_t MemoryBudget::getAvailable(void) const {
+  return (used < limit) ? (limit - used) : 0;
+}
+
+void MemoryBudget::charge(uint64_t bytes) {
+  used += bytes;
+  peak = std::max(peak, used);
+}
+
+void MemoryBudget::release(uint64_t bytes) {
+  used -= std::min(used, bytes);
+}
+
+/**
+ * \brief Estimates the memory needed by the ranges of a process.
+ */
+static uint64_t getRangesCost(const Process &proc) {
+  uint64_t cost = 0;
+  for (const VPageRange &cur_vpr : proc.getVPageRanges()) {
+    // The path is stored in the cached maps file. The range only holds its
+    // id in the shared path table, which stores each distinct path once.
+    cost += range_cost + cur_vpr.getMappedFilePath().size();
+  }
+  return cost;
+}
+
+/**
+ * \brief Prints the pages of a range window by window.
+ * \param range_pos The position of the range within the process' ranges.
+ * \param window_pages The maximal number of pages of a window.
+ * \param max_rss The largest resident set size sampled so far, updated after
+ * each window while its pages and frames are still held.
+ *
+ * Only the pages and frames of a single window are held in memory at any
+ * time. The frames are taken from \c window_arena like the pages. The output
+ * is the same as if all pages were read at once.
+ */
+static void printRangeInWindows(const CmdOptions &cmd_opts, std::ostream &stream,
+    Process &proc, size_t range_pos, uint64_t window_pages,
+    MemoryBudget &budget, Arena &window_arena, uint64_t &max_rss) {
+  const VPageRange &cur_vpr = proc.getVPageRanges()[range_pos];
+  uint64_t no_omitted_pages = 0;
+  for (uint64_t first_page = 0; first_page < cur_vpr.num();
+      first_page += window_pages) {
+    // The pages and frames of the previous window are gone, so their memory
+    // is reused without growing the arena
+    window_arena.reset();
+    uint64_t num_pages = 0;
+    {
+      ScanStats::PhaseTimer timer(ScanStats::Phase::PagemapReads);
+      num_pages = proc.populateRangePages(cmd_opts, range_pos, first_page,
+          window_pages);
+    }
+    if (num_pages == 0) {
+      break;
+    }
+    budget.charge(num_pages * page_cost);
+
+    std::vector<uint64_t> frames;
+    {
+      ScanStats::PhaseTimer timer(ScanStats::Phase::FrameCollection);
+      frames.reserve(num_pages);
+      for (const VPage &cur_vpage : cur_vpr.getVPages()) {
+        if ((cur_vpage.arePagePropertiesValid() == true)
+         && (cur_vpage.isPresentRAM() == true)
+         && (cur_vpage.getFrameNumber() != 0)) {
+          frames.push_back(cur_vpage.getFrameNumber());
+        }
+      }
+      std::sort(frames.begin(), frames.end());
+      frames.erase(std::unique(frames.begin(), frames.end()), frames.end());
+    }
+    PMemory pmem(&window_arena);
+    if (frames.empty() == false) {
+      ScanStats::PhaseTimer timer(ScanStats::Phase::FrameReads);
+      pmem.addPFrames(cmd_opts, frames.begin(), frames.end());
+    }
+    ScanStats::recordArenaBytes(window_arena.getReservedBytes());
+    {
+      ScanStats::PhaseTimer timer(ScanStats::Phase::Output);
+      printVPages(cmd_opts, stream, cur_vpr.getVPages(), pmem, no_omitted_pages);
+    }
+    max_rss = std::max(max_rss, ScanStats::getResidentBytes());
+    proc.releaseRangePages(range_pos);
+    budget.release(num_pages * page_cost);
+  }
+  printOmittedVPages(cmd_opts, stream, cur_vpr, no_omitted_pages);
+}
+
+/**
+ * \brief Prints the results of the given processes within a memory budget.
+ *
+ * The processes are handled one after another and their ranges are read in
+ * windows whose size is chosen by the memory still available. So the memory
+ * needed for pages and frames does not grow with the size of the examined
+ * processes. The output is the same as the one of \c printResults(). If the
+ * ranges of a process leave no room for a window of pages, only the ranges
+ * of that process are printed. The pages and frames are taken from an arena
+ * whose blocks are sized from the budget. The peak of the charged memory,
+ * which is an estimate, is recorded in the statistics next to the measured
+ * growth of the resident set. The resident set is sampled after each window,
+ * so the growth may miss short spikes in between. Returns \c false if the
+ * pages of any process had to be omitted.
+ */
+bool printResultsWithinBudget(const CmdOptions &cmd_opts, std::ostream &stream,
+    std::vector<Process> &processes, MemoryBudget &budget) {
+  // Store the format flags
+  std::ios_base::fmtflags original_fmt_flags = stream.flags();
+  bool all_pages_printed = true;
+  const uint64_t start_rss = ScanStats::getResidentBytes();
+  uint64_t max_rss = start_rss;
+  // The processes are read one after another by this thread, so all windows
+  // share one arena
+  Arena window_arena(budget.getLimit() / arena_block_fraction);
+
+  budget.charge(fixed_cost);
+  printPageRangeHeadline(cmd_opts, stream);
+  printMappingHeadline(cmd_opts, stream);
+  for (Process &cur_proc : processes) {
+    TraceSpan span("printResultsWithinBudget", "pid", cur_proc.getPID());
+    {
+      ScanStats::PhaseTimer timer(ScanStats::Phase::MapsParsing);
+      if (cmd_opts.cmd_prog_mode == CmdOptions::ProgMode::Mappings) {
+        cur_proc.populateFileRanges(cmd_opts);
+      } else if (cmd_opts.cmd_prog_mode == CmdOptions::ProgMode::Pages) {
+        cur_proc.populateMixedRange(cmd_opts);
+      }
+    }
+    if (cur_proc.isAccessible() == false) {
+      continue;
+    }
+    cur_proc.setPageArena(&window_arena);
+    const uint64_t ranges_cost = getRangesCost(cur_proc);
+    budget.charge(ranges_cost);
+    const uint64_t window_pages = budget.getAvailable() / page_cost;
+    const bool omit_pages = (cmd_opts.cmd_only_vpranges == false)
+        && (window_pages < min_window_pages);
+    if (omit_pages == true) {
+      errs() << "The memory budget is too small for the pages of process "
+             << cur_proc.getPID() << "; only its ranges are printed!" << std::endl;
+      all_pages_printed = false;
+    } else if (cmd_opts.cmd_verbose == true) {
+      logs() << "Reading process " << cur_proc.getPID() << " in windows of "
+             << std::dec << window_pages << " pages" << std::endl;
+    }
+
+    stream << "Process: " << cur_proc.getPID() << std::endl;
+    const Process::VPR_List_Ty &cur_ranges = cur_proc.getVPageRanges();
+    for (size_t i = 0, e = cur_ranges.size(); i < e; ++i) {
+      const VPageRange &cur_vpr = cur_ranges[i];
+      printVPageRange(cmd_opts, stream, cur_vpr);
+      if (cmd_opts.cmd_only_vpranges == true) {
+        if (cmd_opts.cmd_prog_mode == CmdOptions::ProgMode::Pages) {
+          stream << "Omit option \"-r\" to show mappings for each page." << std::endl;
+        }
+        continue;
+      }
+      if (cur_vpr.getMappingType() == VPageRange::MappingType::Unmapped) {
+        continue;
+      }
+      if (omit_pages == true) {
+        stream << std::setfill(' ') << std::left << std::setw(page_indent) << " "
+               << "[pages omitted to stay within the memory budget]" << std::endl;
+        continue;
+      }
+      printRangeInWindows(cmd_opts, stream, cur_proc, i, window_pages, budget,
+                          window_arena, max_rss);
+    }
+    // The ranges of the process are still held
+    max_rss = std::max(max_rss, ScanStats::getResidentBytes());
+    cur_proc.releaseFileRanges();
+    cur_proc.setPageArena(nullptr);
+    cur_proc.closePageMapFile();
+    budget.release(ranges_cost);
+  }
+  budget.release(fixed_cost);
+
+  // The lifetime peak of the resident set includes the memory used before the
+  // scan, so only the sampled resident set sizes tell the growth
+  const uint64_t rss_growth = max_rss - start_rss;
+  ScanStats::recordBudget(budget.getLimit(), budget.getPeak(), rss_growth);
+  if (cmd_opts.cmd_verbose == true) {
+    logs() << "Estimated peak memory charged against the budget: " << std::dec
+           << budget.getPeak() << " of " << budget.getLimit() << " bytes, "
+           << "measured growth of the resident set: " << rss_growth
+           << " bytes" << std::endl;
+  }
+  // Restore format flags
+  stream.flags(original_fmt_flags);
+  return all_pages_printed;
+}
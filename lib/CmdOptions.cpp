@@ -11,27 +11,180 @@
 // -a       Show all virtual pages and do NOT omit unmapped pages.
 // -r       Only show the virtual page ranges and omit listing the mapping for
 //          each single page.
+// -A       Scan all processes of the system instead of the given pids.
+//          Kernel threads and processes that exit during the scan are
+//          skipped.
+// -j n     Use n worker threads to scan the processes. Defaults to the number
+//          of available CPUs.
 // -h       Print help message.
+// --save f Capture the collected ranges, pages and frames into the snapshot
+//          file f instead of printing them.
+// --load f Read ranges, pages and frames from the snapshot file f instead of
+//          /proc. The process ids given on the command line are ignored.
+// --diff f Compare the older snapshot file f with the snapshot given by
+//          --load and print what changed.
+// --watch s
+//          Rescan the processes every s seconds and only print the ranges
+//          that appeared or disappeared and the ranges whose number of
+//          resident pages changed.
+// --soft-dirty s
+//          Clear the soft-dirty bits of the processes, wait s seconds and
+//          print the pages that were written in the meantime.
+// --comm r
+//          Only scan processes whose command name matches the regular
+//          expression r.
+// --cmdline r
+//          Only scan processes whose command line matches the regular
+//          expression r.
+// --uid n  Only scan processes whose effective user id is n.
+// --cgroup p
+//          Only scan processes of the cgroup v2 p (relative to /sys/fs/cgroup)
+//          and its descendants.
+//          If any of these selectors is given without process ids all
+//          processes of the system are considered.
+// --proc-root d
+//          Read all process and frame information from the directory d
+//          instead of /proc. The directory must mimic the layout of /proc.
+// --stats[=json]
+//          Print the time spent in each phase of the scan, the number of
+//          system calls, read bytes and processed pages and frames and the
+//          peak memory usage to stderr. With =json a JSON object is printed.
+// --trace f
+//          Record the time spent reading each process, range and frame batch
+//          and writing the output and store it in the Chrome trace-event
+//          format in the file f.
+// --sample n[,stride]
+//          Only read n randomly chosen pages of each range (or every k-th
+//          page starting at a random one) and print the estimated fractions
+//          of resident, swapped, dirty and THP pages.
+// --max-mem n
+//          Keep the memory used for pages and frames below n bytes (a suffix
+//          K, M or G multiplies by 1024, 1024^2 or 1024^3). The processes are
+//          read one after another in windows of pages that fit into the
+//          budget. The used memory is an estimate; --stats prints it next to
+//          the measured growth of the resident set.
+// --translate[=f]
+//          Read pairs of a process id and a virtual address from the file f
+//          (or from stdin) and print the physical address, the frame flags
+//          and the swap location of each address. No ranges are populated.
+// --files  Instead of the mappings print for each mapped file the resident
+//          bytes, the bytes shared by several of the scanned processes and
+//          the number of dirty and writeback pages. Frames mapped several
+//          times are counted once. Private copies of written pages are
+//          counted separately as they do not belong to the page cache.
+// --content[=rate]
+//          Read the contents of the resident pages of all anonymous ranges
+//          and print the number of pages that only contain zeros or that
+//          have the same contents as other pages. At most rate bytes per
+//          second are read (default 256M, 0 for no limit).
+// --swap   Instead of the mappings print for each range with swapped pages
+//          how scattered their swap slots are (runs and seek distance) and
+//          how many slots the swap readahead reads to fault them back in,
+//          followed by the slots used on each swap device.
+// --pfn l  Instead of the mappings print every process and virtual address
+//          mapping one of the frames in the list l and the flags of those
+//          frames. The list contains frame numbers or ranges of them
+//          (first-last) separated by commas, all given in hex. Without
+//          process ids all processes are scanned.
+// --phys l Like --pfn but the list contains physical addresses. Each
+//          address selects the frame containing it.
+// --contiguity
+//          Instead of the mappings print for each range how many runs of
+//          physically contiguous frames back its resident pages and how
+//          long those runs are (counted per power of two).
+// --fragmentation
+//          Print for each memory zone the number of free blocks of the
+//          buddy allocator per order, how many huge pages could be
+//          allocated from them and the unusable free space index of the
+//          huge page order. No processes are scanned.
 //
 // Supported Modes:
 // -M       Default mode: Show mapping from virtual pages to physical frames.
 // -P       Page mode: The user MUST  specify an virtual address interval using
 //          the -l and -u option. The mapping for all contained virtual pages
-//          will be shown no matter if they are used/mapped or not.
+//          will be shown no matter if they are used/mapped or not. Holes
+//          between the mappings are shown as single unmapped ranges.
 //   Note: The last program mode given will be used. Using multiple different
 //   modes is currently NOT detected.
 //
 // Usage:
-// lsmmap [ -l <lower> ] [ -u <upper> ] [ -n ] [ -v ] [ <pids>... ]
+// lsmmap [ -l <lower> ] [ -u <upper> ] [ -n ] [ -v ] [ --save <file> ]
+//        [ --load <file> [ --diff <file> ] ] [ --watch <secs> ]
+//        [ --soft-dirty <secs> ] [ -j <n> ] [ --comm <regex> ]
+//        [ --cmdline <regex> ] [ --uid <uid> ] [ --cgroup <path> ]
+//        [ --proc-root <dir> ] [ --stats[=json] ] [ --trace <file> ]
+//        [ --sample <n>[,stride] ] [ --max-mem <size> ] [ --files ]
+//        [ --content[=<rate>] ] [ --swap ] [ --pfn <list> ]
+//        [ --phys <list> ] [ --contiguity ] [ -A | <pids>... ]
+// lsmmap --translate[=<file>] [ --proc-root <dir> ] [ --stats[=json] ]
+// lsmmap --fragmentation [ --proc-root <dir> ] [ --stats[=json] ]
 //
 //===----------------------------------------------------------------------===//
 
 #include "CmdOptions.h"
+#include "Diagnostics.h"
 
+#include <algorithm>
+#include <cerrno>
 #include <climits>
 #include <cstdlib>
+#include <getopt.h>
 #include <iostream>
+#include <iterator>
 #include <limits>
+#include <regex>
+
+// Values returned by getopt_long for options that only have a long name
+enum LongOptionValue {
+  LongOptSave = 256,
+  LongOptLoad,
+  LongOptDiff,
+  LongOptWatch,
+  LongOptSoftDirty,
+  LongOptComm,
+  LongOptCmdline,
+  LongOptUid,
+  LongOptCgroup,
+  LongOptProcRoot,
+  LongOptStats,
+  LongOptTrace,
+  LongOptTranslate,
+  LongOptSample,
+  LongOptMaxMem,
+  LongOptFiles,
+  LongOptContent,
+  LongOptSwap,
+  LongOptPFN,
+  LongOptPhys,
+  LongOptContiguity,
+  LongOptFragmentation
+};
+
+static const struct option long_options[] = {
+  {"save", required_argument, nullptr, LongOptSave},
+  {"load", required_argument, nullptr, LongOptLoad},
+  {"diff", required_argument, nullptr, LongOptDiff},
+  {"watch", required_argument, nullptr, LongOptWatch},
+  {"soft-dirty", required_argument, nullptr, LongOptSoftDirty},
+  {"comm", required_argument, nullptr, LongOptComm},
+  {"cmdline", required_argument, nullptr, LongOptCmdline},
+  {"uid", required_argument, nullptr, LongOptUid},
+  {"cgroup", required_argument, nullptr, LongOptCgroup},
+  {"proc-root", required_argument, nullptr, LongOptProcRoot},
+  {"stats", optional_argument, nullptr, LongOptStats},
+  {"trace", required_argument, nullptr, LongOptTrace},
+  {"translate", optional_argument, nullptr, LongOptTranslate},
+  {"sample", required_argument, nullptr, LongOptSample},
+  {"max-mem", required_argument, nullptr, LongOptMaxMem},
+  {"files", no_argument, nullptr, LongOptFiles},
+  {"content", optional_argument, nullptr, LongOptContent},
+  {"swap", no_argument, nullptr, LongOptSwap},
+  {"pfn", required_argument, nullptr, LongOptPFN},
+  {"phys", required_argument, nullptr, LongOptPhys},
+  {"contiguity", no_argument, nullptr, LongOptContiguity},
+  {"fragmentation", no_argument, nullptr, LongOptFragmentation},
+  {nullptr, 0, nullptr, 0}
+};
 
 /**
  * \brief Determines if the given string is a valid process id.
@@ -109,6 +262,116 @@ bool str2ulong(const std::string &str, unsigned long int *value, int base) {
   return true;
 }
 
+/**
+ * \brief Determines if the given string is a valid regular expression.
+ */
+static bool isRegex(const std::string &str) {
+  try {
+    std::regex test_regex(str);
+  } catch(const std::regex_error &regex_exc) {
+    return false;
+  }
+  return true;
+}
+
+bool str2double(const std::string &str, double *value) {
+  // Test for empty string
+  if (str.empty() == true) {
+    return false;
+  }
+
+  errno = 0;
+  const char* const str_cstr = str.c_str();
+  char *end = nullptr;
+  double tmp = strtod(str_cstr, &end);
+  // Check for out-of-range
+  if (errno == ERANGE) {
+    return false;
+  }
+  // Check if the whole string was parsed
+  if (end != str_cstr + str.size()) {
+    return false;
+  }
+
+  if (value != nullptr) {
+    *value = tmp;
+  }
+  return true;
+}
+
+/**
+ * \brief Parses a size in bytes.
+ *
+ * The size may be followed by one of the suffixes K, M or G which multiply it
+ * by 1024, 1024^2 or 1024^3.
+ */
+bool str2size(const std::string &str, uint64_t *value) {
+  if (str.empty() == true) {
+    return false;
+  }
+  std::string number(str);
+  uint64_t multiplier = 1;
+  switch (number.back()) {
+    case 'K': case 'k':
+      multiplier = 1024;
+      break;
+    case 'M': case 'm':
+      multiplier = 1024 * 1024;
+      break;
+    case 'G': case 'g':
+      multiplier = 1024 * 1024 * 1024;
+      break;
+  }
+  if (multiplier != 1) {
+    number.pop_back();
+  }
+  unsigned long tmp = 0;
+  if ((str2ulong(number, &tmp, 10) == false)
+   || (tmp > std::numeric_limits<uint64_t>::max() / multiplier)) {
+    return false;
+  }
+  if (value != nullptr) {
+    *value = tmp * multiplier;
+  }
+  return true;
+}
+
+/**
+ * \brief Parses a comma separated list of hex numbers and ranges of them
+ * \brief (first-last, both included) and appends the ranges to \c ranges.
+ *
+ * Each number is divided by \c unit, so a unit of the page size turns
+ * physical addresses into frame numbers.
+ */
+static bool str2ranges(const std::string &str, uint64_t unit,
+    CmdOptions::FR_List_Ty &ranges) {
+  if (str.empty() == true) {
+    return false;
+  }
+  size_t cur_pos = 0;
+  while (cur_pos <= str.size()) {
+    size_t cur_end = str.find(',', cur_pos);
+    if (cur_end == std::string::npos) {
+      cur_end = str.size();
+    }
+    const std::string cur_item(str, cur_pos, cur_end - cur_pos);
+    const size_t dash_pos = cur_item.find('-');
+    unsigned long first = 0, last = 0;
+    if (str2ulong(cur_item.substr(0, dash_pos), &first, 16) == false) {
+      return false;
+    }
+    if (dash_pos == std::string::npos) {
+      last = first;
+    } else if ((str2ulong(cur_item.substr(dash_pos + 1), &last, 16) == false)
+            || (last < first)) {
+      return false;
+    }
+    ranges.push_back(std::make_pair(first / unit, last / unit));
+    cur_pos = cur_end + 1;
+  }
+  return true;
+}
+
 //===- CmdOptions functions -----------------------------------------------===//
 
 CmdOptions::CmdOptions()
@@ -116,7 +379,14 @@ CmdOptions::CmdOptions()
    cmd_lower_address(0), cmd_low_addr_userset(false),
    cmd_upper_address(std::numeric_limits<uint64_t>::max()), cmd_up_addr_userset(false),
    cmd_show_unmapped(false), cmd_verbose(false), cmd_show_all_pages(false),
-   cmd_prog_mode(ProgMode::Mappings), cmd_only_vpranges(false) {
+   cmd_prog_mode(ProgMode::Mappings), cmd_only_vpranges(false),
+   cmd_watch_interval(0.0), cmd_softdirty_interval(0.0),
+   cmd_all_processes(false), cmd_num_workers(0),
+   cmd_uid(0), cmd_uid_userset(false), cmd_proc_root("/proc"),
+   cmd_stats(false), cmd_stats_json(false), cmd_translate(false),
+   cmd_sample_size(0), cmd_sample_strided(false), cmd_max_mem(0),
+   cmd_files(false), cmd_content(false), cmd_content_rate(256 << 20),
+   cmd_swap(false), cmd_contiguity(false), cmd_fragmentation(false) {
 }
 
 /**
@@ -132,15 +402,29 @@ CmdOptions::ErrorType CmdOptions::parseFromCommandLine(int argc, char *argv[]) {
   extern char *optarg;
 
   ErrorType errty = ErrorType::NoError;
-  char c;
-  while ((c = getopt(argc, argv, "hl:u:nvarMP")) != -1) {
+  int c;
+  while ((c = getopt_long(argc, argv, "hl:u:nvarMPAj:", long_options, nullptr)) != -1) {
     switch(c) {
       case 'a':
         cmd_show_all_pages = true;
         break;
+      case 'A':
+        cmd_all_processes = true;
+        break;
       case 'h':
         return ErrorType::ShowHelp;
         break;
+      case 'j': {
+        unsigned long num_workers = 0;
+        if ((str2ulong(optarg, &num_workers, 10) == false) || (num_workers == 0)
+         || (num_workers > std::numeric_limits<unsigned>::max())) {
+          errs() << optarg << " is not a valid number of workers!" << std::endl;
+          errty = ErrorType::Option;
+        } else {
+          cmd_num_workers = static_cast<unsigned>(num_workers);
+        }
+        break;
+      }
       case 'l':
         if (str2ulong(optarg, &cmd_lower_address, 16) == true) {
           cmd_low_addr_userset = true;
@@ -170,31 +454,238 @@ CmdOptions::ErrorType CmdOptions::parseFromCommandLine(int argc, char *argv[]) {
       case 'v':
         cmd_verbose = true;
         break;
+      case LongOptSave:
+        cmd_save_path = optarg;
+        break;
+      case LongOptLoad:
+        cmd_load_path = optarg;
+        break;
+      case LongOptDiff:
+        cmd_diff_path = optarg;
+        break;
+      case LongOptWatch:
+        if ((str2double(optarg, &cmd_watch_interval) == false)
+         || (cmd_watch_interval <= 0.0)) {
+          errs() << optarg << " is not a valid watch interval!" << std::endl;
+          cmd_watch_interval = 0.0;
+          errty = ErrorType::Option;
+        }
+        break;
+      case LongOptSoftDirty:
+        if ((str2double(optarg, &cmd_softdirty_interval) == false)
+         || (cmd_softdirty_interval <= 0.0)) {
+          errs() << optarg << " is not a valid soft-dirty interval!" << std::endl;
+          cmd_softdirty_interval = 0.0;
+          errty = ErrorType::Option;
+        }
+        break;
+      case LongOptComm:
+        cmd_comm_regex = optarg;
+        if ((cmd_comm_regex.empty() == true) || (isRegex(cmd_comm_regex) == false)) {
+          errs() << optarg << " is not a valid regular expression!" << std::endl;
+          errty = ErrorType::Option;
+        }
+        break;
+      case LongOptCmdline:
+        cmd_cmdline_regex = optarg;
+        if ((cmd_cmdline_regex.empty() == true) || (isRegex(cmd_cmdline_regex) == false)) {
+          errs() << optarg << " is not a valid regular expression!" << std::endl;
+          errty = ErrorType::Option;
+        }
+        break;
+      case LongOptUid:
+        if (str2ulong(optarg, &cmd_uid, 10) == true) {
+          cmd_uid_userset = true;
+        } else {
+          errs() << optarg << " is not a valid user id!" << std::endl;
+          errty = ErrorType::Option;
+        }
+        break;
+      case LongOptCgroup:
+        cmd_cgroup_path = optarg;
+        break;
+      case LongOptProcRoot:
+        cmd_proc_root = optarg;
+        // Strip trailing slashes so that paths can simply be appended
+        while ((cmd_proc_root.size() > 1) && (cmd_proc_root.back() == '/')) {
+          cmd_proc_root.pop_back();
+        }
+        if (cmd_proc_root.empty() == true) {
+          errs() << "The proc root must not be empty!" << std::endl;
+          errty = ErrorType::Option;
+        }
+        break;
+      case LongOptStats:
+        cmd_stats = true;
+        if (optarg != nullptr) {
+          if (std::string(optarg).compare("json") == 0) {
+            cmd_stats_json = true;
+          } else {
+            errs() << optarg << " is not a valid statistics format!" << std::endl;
+            errty = ErrorType::Option;
+          }
+        }
+        break;
+      case LongOptTrace:
+        cmd_trace_path = optarg;
+        break;
+      case LongOptTranslate:
+        cmd_translate = true;
+        if ((optarg != nullptr) && (std::string(optarg).compare("-") != 0)) {
+          cmd_translate_path = optarg;
+        }
+        break;
+      case LongOptSample: {
+        std::string sample_arg(optarg);
+        const size_t separator_pos = sample_arg.find(',');
+        if (separator_pos != std::string::npos) {
+          cmd_sample_strided = (sample_arg.compare(separator_pos + 1,
+              std::string::npos, "stride") == 0);
+          if (cmd_sample_strided == false) {
+            errs() << sample_arg.substr(separator_pos + 1)
+                   << " is not a valid sampling method!" << std::endl;
+            errty = ErrorType::Option;
+          }
+          sample_arg.resize(separator_pos);
+        }
+        if ((str2ulong(sample_arg, &cmd_sample_size, 10) == false)
+         || (cmd_sample_size == 0)) {
+          errs() << sample_arg << " is not a valid sample size!" << std::endl;
+          cmd_sample_size = 0;
+          errty = ErrorType::Option;
+        }
+        break;
+      }
+      case LongOptMaxMem:
+        if ((str2size(optarg, &cmd_max_mem) == false) || (cmd_max_mem == 0)) {
+          errs() << optarg << " is not a valid memory budget!" << std::endl;
+          cmd_max_mem = 0;
+          errty = ErrorType::Option;
+        }
+        break;
+      case LongOptFiles:
+        cmd_files = true;
+        break;
+      case LongOptContent:
+        cmd_content = true;
+        if ((optarg != nullptr)
+         && (str2size(optarg, &cmd_content_rate) == false)) {
+          errs() << optarg << " is not a valid rate!" << std::endl;
+          errty = ErrorType::Option;
+        }
+        break;
+      case LongOptSwap:
+        cmd_swap = true;
+        break;
+      case LongOptPFN:
+        if (str2ranges(optarg, 1, cmd_frame_ranges) == false) {
+          errs() << optarg << " is not a valid list of frame numbers!" << std::endl;
+          errty = ErrorType::Option;
+        }
+        break;
+      case LongOptPhys:
+        if (str2ranges(optarg, sysconf(_SC_PAGESIZE), cmd_frame_ranges) == false) {
+          errs() << optarg << " is not a valid list of physical addresses!" << std::endl;
+          errty = ErrorType::Option;
+        }
+        break;
+      case LongOptContiguity:
+        cmd_contiguity = true;
+        break;
+      case LongOptFragmentation:
+        cmd_fragmentation = true;
+        break;
       case '?': case ':':
         errty = ErrorType::Option;
         break;
     }
   }
   // Now parse the remaining options. They represent the requested process ids.
-  if (optind < argc) {
+  if ((optind < argc) && (cmd_translate == true)) {
+    errs() << "--translate reads the process ids from its input!" << std::endl;
+    errty = ErrorType::PID;
+  } else if ((optind < argc) && (cmd_fragmentation == true)) {
+    errs() << "--fragmentation does not scan any processes!" << std::endl;
+    errty = ErrorType::PID;
+  } else if ((optind < argc) && (cmd_all_processes == true)) {
+    errs() << "-A cannot be used together with process ids!" << std::endl;
+    errty = ErrorType::PID;
+  } else if (optind < argc) {
     for (int i = optind; i < argc; ++i) {
       std::string cur_pid(argv[i]);
       if (isPID(cur_pid) == true) {
         cmd_req_pid.push_back(cur_pid);
       } else {
-        std::cerr << cur_pid << " is not a valid process id!" << std::endl;
+        errs() << cur_pid << " is not a valid process id!" << std::endl;
         errty = ErrorType::PID;
       }
     }
-  } else {
+  } else if ((hasProcessSelectors() == true) || (cmd_frame_ranges.empty() == false)) {
+    // Selectors without process ids choose from all processes. Frames are
+    // looked up in all processes as well.
+    cmd_all_processes = true;
+  } else if (cmd_all_processes == false) {
     // If no process ids are given add the self id.
     cmd_req_pid.push_back("self");
   }
   // Make sure that consistent options are given
-  if (cmd_prog_mode == ProgMode::Pages) {
+  if ((cmd_save_path.empty() == false) && (cmd_load_path.empty() == false)) {
+    errs() << "--save and --load cannot be used together!" << std::endl;
+    errty = ErrorType::Option;
+  }
+  // At most one of the modes can be given. A snapshot read by --load is only
+  // the input of --files, --swap and --contiguity, unless --diff compares it.
+  // So it only counts as a mode of its own otherwise, see Scanner::getMode().
+  const bool load_is_input = (cmd_load_path.empty() == false)
+      && (cmd_diff_path.empty() == true)
+      && ((cmd_files == true) || (cmd_swap == true)
+       || (cmd_contiguity == true));
+  const bool modes[] = {
+      (cmd_save_path.empty() == false)
+          || ((cmd_load_path.empty() == false) && (load_is_input == false)),
+      cmd_watch_interval > 0.0, cmd_softdirty_interval > 0.0, cmd_translate,
+      cmd_sample_size > 0, cmd_max_mem > 0, cmd_files, cmd_content, cmd_swap,
+      cmd_frame_ranges.empty() == false, cmd_contiguity, cmd_fragmentation};
+  if (std::count(std::begin(modes), std::end(modes), true) > 1) {
+    errs() << "Only one of --save, --load, --watch, --soft-dirty, --translate, "
+           << "--sample, --max-mem, --files, --content, --swap, --pfn, --phys, "
+           << "--contiguity and --fragmentation can be used! --load can be "
+           << "combined with --files, --swap and --contiguity." << std::endl;
+    errty = ErrorType::Option;
+  }
+  if ((cmd_prog_mode == ProgMode::Pages)
+   && ((cmd_softdirty_interval > 0.0) || (cmd_translate == true)
+    || (cmd_sample_size > 0) || (cmd_files == true) || (cmd_content == true)
+    || (cmd_swap == true) || (cmd_frame_ranges.empty() == false)
+    || (cmd_contiguity == true) || (cmd_fragmentation == true))) {
+    errs() << "Only --save, --load, --diff, --watch and --max-mem can be used "
+           << "in -P mode!" << std::endl;
+    errty = ErrorType::Option;
+  }
+  if (((cmd_translate == true) || (cmd_fragmentation == true))
+   && ((cmd_all_processes == true) || (hasProcessSelectors() == true))) {
+    errs() << "--translate and --fragmentation cannot be used with -A or "
+           << "process selectors!" << std::endl;
+    errty = ErrorType::Option;
+  }
+  if (((cmd_all_processes == true) || (hasProcessSelectors() == true))
+   && (cmd_load_path.empty() == false)) {
+    errs() << "-A and process selectors cannot be used with --load!" << std::endl;
+    errty = ErrorType::Option;
+  }
+  if ((cmd_content == true) && (cmd_proc_root.compare("/proc") != 0)) {
+    errs() << "--content reads the memory of live processes and cannot be "
+           << "used with --proc-root!" << std::endl;
+    errty = ErrorType::Option;
+  }
+  if ((cmd_diff_path.empty() == false) && (cmd_load_path.empty() == true)) {
+    errs() << "--diff requires the newer snapshot to be given by --load!" << std::endl;
+    errty = ErrorType::Option;
+  }
+  if ((cmd_prog_mode == ProgMode::Pages) && (cmd_load_path.empty() == true)) {
     if ((cmd_low_addr_userset == false)
      || (cmd_up_addr_userset == false)) {
-      std::cerr << "-P mode cannot be used without specifying -l and -u!" << std::endl;
+      errs() << "-P mode cannot be used without specifying -l and -u!" << std::endl;
       errty = ErrorType::Option;
     }
   }
@@ -203,3 +694,12 @@ CmdOptions::ErrorType CmdOptions::parseFromCommandLine(int argc, char *argv[]) {
 
   return errty;
 }
+
+/**
+ * \brief Indicates if any option was given that selects processes by their
+ * properties instead of their ids.
+ */
+bool CmdOptions::hasProcessSelectors(void) const {
+  return (cmd_comm_regex.empty() == false) || (cmd_cmdline_regex.empty() == false)
+      || (cmd_uid_userset == true) || (cmd_cgroup_path.empty() == false);
+}
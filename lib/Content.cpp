@@ -0,0 +1,433 @@
+//===- Content.cpp --------------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "Content.h"
+#include "PMemory.h"
+#include "ProcScan.h"
+#include "Stats.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Maximal number of pages read with a single process_vm_readv call
+static const size_t max_batch_pages = 256;
+
+/**
+ * The hash of a scanned page together with where it was found. The digests
+ * of all pages are sorted so pages with equal contents end up next to each
+ * other.
+ */
+class PageDigest {
+public:
+  PageHash hash;
+  uint64_t frame_no;
+  uint64_t address;
+  uint32_t job_no;
+  uint32_t process_no;
+  bool is_zero;
+
+  PageDigest(const PageHash &pagehash, uint64_t frameno, uint64_t pageaddress,
+      uint32_t jobno, uint32_t processno, bool iszero)
+   : hash(pagehash), frame_no(frameno), address(pageaddress), job_no(jobno),
+     process_no(processno), is_zero(iszero) {}
+
+  bool operator<(const PageDigest &other) const {
+    if (is_zero != other.is_zero) {
+      return is_zero == true;
+    }
+    if ((hash == other.hash) == false) {
+      return hash < other.hash;
+    }
+    if (frame_no != other.frame_no) {
+      return frame_no < other.frame_no;
+    }
+    if (process_no != other.process_no) {
+      return process_no < other.process_no;
+    }
+    return address < other.address;
+  }
+
+  bool hasSameContent(const PageDigest &other) const {
+    return (is_zero == other.is_zero) && (hash == other.hash);
+  }
+};
+
+//===- ContentThrottle class ----------------------------------------------===//
+
+ContentThrottle::ContentThrottle(uint64_t bytespersecond)
+ : bytes_per_second(bytespersecond),
+   next_read(std::chrono::steady_clock::now()) {
+}
+
+/**
+ * \brief Waits until \c bytes bytes may be read without exceeding the rate.
+ *
+ * The time needed to read the bytes at the permitted rate is reserved for the
+ * caller, so concurrent callers are served one after another.
+ */
+void ContentThrottle::acquire(uint64_t bytes) {
+  if (bytes_per_second == 0) {
+    return;
+  }
+  std::chrono::steady_clock::time_point read_at;
+  {
+    std::lock_guard<std::mutex> lock(throttle_mutex);
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (next_read < now) {
+      next_read = now;
+    }
+    read_at = next_read;
+    next_read += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(static_cast<double>(bytes) / bytes_per_second));
+  }
+  std::this_thread::sleep_until(read_at);
+}
+
+//===- RangeContent class -------------------------------------------------===//
+
+RangeContent::RangeContent(const VPageRange &range)
+ : vp_range(&range), scanned_pages(0), unreadable_pages(0), zero_pages(0),
+   unresolved_zero_pages(0), duplicate_pages(0), cross_duplicate_pages(0) {
+}
+
+/**
+ * \brief Returns the number of bytes that could be freed by replacing zero
+ * \brief pages with the shared zero page and merging duplicate pages.
+ */
+uint64_t RangeContent::getReclaimableBytes(void) const {
+  return (zero_pages + duplicate_pages) * vp_range->getPageSize();
+}
+
+//===- ProcessContent class -----------------------------------------------===//
+
+ProcessContent::ProcessContent(const std::string &pid)
+ : process_id(pid) {
+}
+
+/**
+ * \brief Returns the sum of the given counter over all ranges.
+ */
+uint64_t ProcessContent::getPages(uint64_t RangeContent::*counter) const {
+  uint64_t pages = 0;
+  for (const RangeContent &cur_range_content : range_contents) {
+    pages += cur_range_content.*counter;
+  }
+  return pages;
+}
+
+uint64_t ProcessContent::getReclaimableBytes(void) const {
+  uint64_t bytes = 0;
+  for (const RangeContent &cur_range_content : range_contents) {
+    bytes += cur_range_content.getReclaimableBytes();
+  }
+  return bytes;
+}
+
+//===- Content analysis ---------------------------------------------------===//
+
+/**
+ * \brief Determines if the given memory only contains zeros.
+ *
+ * Pages that are in use usually contain non-zero bytes near their start, so
+ * the memory is checked in blocks of 64 bytes and the check stops at the
+ * first block containing a non-zero byte.
+ */
+bool isZeroPage(const void *data, size_t size) {
+  const uint8_t *bytes = static_cast<const uint8_t*>(data);
+  size_t pos = 0;
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  for (; pos + 64 <= size; pos += 64) {
+    const __m128i *cur_block = reinterpret_cast<const __m128i*>(bytes + pos);
+    const __m128i combined = _mm_or_si128(
+        _mm_or_si128(_mm_loadu_si128(cur_block), _mm_loadu_si128(cur_block + 1)),
+        _mm_or_si128(_mm_loadu_si128(cur_block + 2), _mm_loadu_si128(cur_block + 3)));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(combined, zero)) != 0xFFFF) {
+      return false;
+    }
+  }
+#else
+  for (; pos + sizeof(uint64_t) <= size; pos += sizeof(uint64_t)) {
+    uint64_t cur_word = 0;
+    memcpy(&cur_word, bytes + pos, sizeof(cur_word));
+    if (cur_word != 0) {
+      return false;
+    }
+  }
+#endif
+  for (; pos < size; ++pos) {
+    if (bytes[pos] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static inline uint64_t rotateLeft(uint64_t value, unsigned bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t finalizeHash(uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+/**
+ * \brief Computes the 128 bit MurmurHash3 (x64 variant) of the given memory.
+ */
+PageHash hashPage(const void *data, size_t size, uint64_t seed) {
+  const uint8_t *bytes = static_cast<const uint8_t*>(data);
+  const uint64_t c1 = 0x87c37b91114253d5ULL;
+  const uint64_t c2 = 0x4cf5ad432745937fULL;
+  uint64_t h1 = seed;
+  uint64_t h2 = seed;
+  const size_t num_blocks = size / 16;
+  for (size_t i = 0; i < num_blocks; ++i) {
+    uint64_t k1 = 0, k2 = 0;
+    memcpy(&k1, bytes + i * 16, sizeof(k1));
+    memcpy(&k2, bytes + i * 16 + 8, sizeof(k2));
+    k1 *= c1; k1 = rotateLeft(k1, 31); k1 *= c2; h1 ^= k1;
+    h1 = rotateLeft(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+    k2 *= c2; k2 = rotateLeft(k2, 33); k2 *= c1; h2 ^= k2;
+    h2 = rotateLeft(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+  }
+  // The remaining bytes (none for whole pages)
+  const uint8_t *tail = bytes + num_blocks * 16;
+  const size_t tail_size = size & 15;
+  uint64_t k1 = 0, k2 = 0;
+  for (size_t i = tail_size; i > 8; --i) {
+    k2 ^= static_cast<uint64_t>(tail[i - 1]) << ((i - 9) * 8);
+  }
+  if (tail_size > 8) {
+    k2 *= c2; k2 = rotateLeft(k2, 33); k2 *= c1; h2 ^= k2;
+  }
+  for (size_t i = std::min<size_t>(tail_size, 8); i > 0; --i) {
+    k1 ^= static_cast<uint64_t>(tail[i - 1]) << ((i - 1) * 8);
+  }
+  if (tail_size > 0) {
+    k1 *= c1; k1 = rotateLeft(k1, 31); k1 *= c2; h1 ^= k1;
+  }
+  h1 ^= size;
+  h2 ^= size;
+  h1 += h2;
+  h2 += h1;
+  h1 = finalizeHash(h1);
+  h2 = finalizeHash(h2);
+  h1 += h2;
+  h2 += h1;
+  return PageHash(h1, h2);
+}
+
+/**
+ * \brief Reads the resident pages of a range from the process \c pid and
+ * \brief records a digest of each page.
+ *
+ * The pages are read in batches with a single system call each. Adjacent
+ * pages are requested with a single io vector. If a batch cannot be read
+ * completely the pages are read one by one until the failing page is found,
+ * which is then counted as unreadable.
+ */
+static void scanRangeContent(pid_t pid, uint32_t job_no, uint32_t process_no,
+    ContentThrottle &throttle, RangeContent &range_content,
+    std::vector<PageDigest> &digests) {
+  const VPageRange &vp_range = *range_content.vp_range;
+  TraceSpan span("scanRangeContent", "first_address", vp_range.getFirstAddress());
+  std::vector<const VPage*> pages;
+  for (const VPage &cur_vpage : vp_range.getVPages()) {
+    if ((cur_vpage.arePagePropertiesValid() == true)
+     && (cur_vpage.isPresentRAM() == true)) {
+      pages.push_back(&cur_vpage);
+    }
+  }
+  const size_t page_size = vp_range.getPageSize();
+  std::vector<uint8_t> buffer(std::min(pages.size(), max_batch_pages) * page_size);
+  std::vector<struct iovec> remote_iovs;
+  size_t batch_limit = max_batch_pages;
+  size_t pos = 0;
+  while (pos < pages.size()) {
+    const size_t batch_pages = std::min(batch_limit, pages.size() - pos);
+    remote_iovs.clear();
+    for (size_t i = pos; i < pos + batch_pages; ++i) {
+      const uint64_t cur_address = pages[i]->getStartAddress();
+      if ((remote_iovs.empty() == false)
+       && (reinterpret_cast<uint64_t>(remote_iovs.back().iov_base)
+           + remote_iovs.back().iov_len == cur_address)) {
+        remote_iovs.back().iov_len += page_size;
+      } else {
+        struct iovec cur_iov;
+        cur_iov.iov_base = reinterpret_cast<void*>(cur_address);
+        cur_iov.iov_len = page_size;
+        remote_iovs.push_back(cur_iov);
+      }
+    }
+    struct iovec local_iov;
+    local_iov.iov_base = buffer.data();
+    local_iov.iov_len = batch_pages * page_size;
+    throttle.acquire(local_iov.iov_len);
+    const ssize_t read_bytes = process_vm_readv(pid, &local_iov, 1,
+        remote_iovs.data(), remote_iovs.size(), 0);
+    ScanStats::count(ScanStats::Counter::Syscalls);
+    if ((read_bytes == -1) && (errno != EFAULT)) {
+      // The process exited or must not be read at all
+      range_content.unreadable_pages += pages.size() - pos;
+      break;
+    }
+    const size_t read_pages = (read_bytes > 0) ? (read_bytes / page_size) : 0;
+    ScanStats::count(ScanStats::Counter::BytesRead, read_pages * page_size);
+    for (size_t i = 0; i < read_pages; ++i) {
+      const VPage &cur_vpage = *pages[pos + i];
+      const uint8_t *cur_data = buffer.data() + i * page_size;
+      ++range_content.scanned_pages;
+      if (isZeroPage(cur_data, page_size) == true) {
+        digests.push_back(PageDigest(PageHash(), cur_vpage.getFrameNumber(),
+            cur_vpage.getStartAddress(), job_no, process_no, true));
+      } else {
+        digests.push_back(PageDigest(hashPage(cur_data, page_size),
+            cur_vpage.getFrameNumber(), cur_vpage.getStartAddress(), job_no,
+            process_no, false));
+      }
+    }
+    pos += read_pages;
+    if (read_pages == batch_pages) {
+      batch_limit = max_batch_pages;
+    } else if (batch_pages == 1) {
+      ++range_content.unreadable_pages;
+      ++pos;
+      batch_limit = max_batch_pages;
+    } else {
+      batch_limit = 1;
+    }
+  }
+}
+
+/**
+ * \brief Analyzes the contents of the resident pages of the anonymous ranges
+ * \brief of the given processes.
+ *
+ * The pages must already be populated. Their contents are read with
+ * process_vm_readv by several worker threads at a rate limited by
+ * \c cmd_content_rate. Afterwards the pages of all processes are grouped by
+ * their contents. Pages mapping the same frame are counted once, so pages
+ * that are already shared are neither zero pages nor duplicates. Pages
+ * mapping the shared zero page are not counted at all. If the frame number
+ * of a zero page is hidden it is unknown whether it maps the shared zero
+ * page, so it is counted as unresolved instead.
+ */
+std::vector<ProcessContent> analyzeContent(const CmdOptions &cmd_opts,
+    const std::vector<Process> &processes) {
+  std::vector<ProcessContent> contents;
+  // Each job scans a single range. The jobs of each process are consecutive.
+  std::vector<std::pair<uint32_t, uint32_t> > jobs;
+  std::vector<pid_t> pids;
+  for (uint32_t i = 0; i < processes.size(); ++i) {
+    const Process &cur_proc = processes[i];
+    unsigned long cur_pid = 0;
+    if (cur_proc.getPID().compare("self") == 0) {
+      cur_pid = getpid();
+    } else if (str2ulong(cur_proc.getPID(), &cur_pid, 10) == false) {
+      continue;
+    }
+    pids.push_back(static_cast<pid_t>(cur_pid));
+    contents.push_back(ProcessContent(cur_proc.getPID()));
+    for (const VPageRange &cur_vpr : cur_proc.getVPageRanges()) {
+      if ((cur_vpr.getMappingType() == VPageRange::MappingType::Anonymous)
+       && (cur_vpr.canRead() == VPageRange::TriState::True)) {
+        contents.back().range_contents.push_back(RangeContent(cur_vpr));
+        jobs.push_back(std::make_pair(static_cast<uint32_t>(contents.size() - 1),
+            static_cast<uint32_t>(contents.back().range_contents.size() - 1)));
+      }
+    }
+  }
+
+  ContentThrottle throttle(cmd_opts.cmd_content_rate);
+  std::vector<std::vector<PageDigest> > job_digests(jobs.size());
+  runParallel(cmd_opts, jobs.size(),
+      [&jobs, &pids, &contents, &throttle, &job_digests](size_t job_no) {
+        const uint32_t process_no = jobs[job_no].first;
+        scanRangeContent(pids[process_no], job_no, process_no, throttle,
+            contents[process_no].range_contents[jobs[job_no].second],
+            job_digests[job_no]);
+      });
+
+  std::vector<PageDigest> digests;
+  size_t num_digests = 0;
+  for (const std::vector<PageDigest> &cur_digests : job_digests) {
+    num_digests += cur_digests.size();
+  }
+  digests.reserve(num_digests);
+  for (std::vector<PageDigest> &cur_digests : job_digests) {
+    digests.insert(digests.end(), cur_digests.begin(), cur_digests.end());
+    std::vector<PageDigest>().swap(cur_digests);
+  }
+
+  // The flags of the frames of the zero pages tell which of them already
+  // map the shared zero page. Zero pages are sorted before all others.
+  std::sort(digests.begin(), digests.end());
+  std::vector<uint64_t> zero_frames;
+  for (const PageDigest &cur_digest : digests) {
+    if (cur_digest.is_zero == false) {
+      break;
+    }
+    if (cur_digest.frame_no != 0) {
+      zero_frames.push_back(cur_digest.frame_no);
+    }
+  }
+  std::sort(zero_frames.begin(), zero_frames.end());
+  zero_frames.erase(std::unique(zero_frames.begin(), zero_frames.end()),
+      zero_frames.end());
+  PMemory zero_pmem;
+  zero_pmem.addPFrames(cmd_opts, zero_frames.begin(), zero_frames.end());
+  const PMemory::PF_Map_Ty &zero_frame_map = zero_pmem.getPFrameMap();
+
+  // Count the distinct frames of each group of pages with equal contents.
+  // Unknown frame numbers (0) are all considered distinct.
+  for (size_t i = 0, e = digests.size(); i < e; ) {
+    size_t j = i + 1;
+    bool several_processes = false;
+    for (; (j < e) && (digests[j].hasSameContent(digests[i]) == true); ++j) {
+      if (digests[j].process_no != digests[i].process_no) {
+        several_processes = true;
+      }
+    }
+    for (size_t k = i; k < j; ++k) {
+      const bool is_new_frame = (k == i) || (digests[k].frame_no == 0)
+          || (digests[k].frame_no != digests[k - 1].frame_no);
+      if (is_new_frame == false) {
+        continue;
+      }
+      RangeContent &cur_range_content = contents[jobs[digests[k].job_no].first]
+          .range_contents[jobs[digests[k].job_no].second];
+      if (digests[k].is_zero == true) {
+        const PMemory::PF_Map_Ty::const_iterator frame_it =
+            zero_frame_map.find(digests[k].frame_no);
+        if ((digests[k].frame_no == 0) || (frame_it == zero_frame_map.end())
+         || (frame_it->second.areFramePropertiesValid() == false)) {
+          // Without the frame or its flags the page cannot be told apart
+          // from one that maps the shared zero page
+          ++cur_range_content.unresolved_zero_pages;
+        } else if (frame_it->second.isZeroFrame() == false) {
+          ++cur_range_content.zero_pages;
+        }
+      } else if (k != i) {
+        ++cur_range_content.duplicate_pages;
+        if (several_processes == true) {
+          ++cur_range_content.cross_duplicate_pages;
+        }
+      }
+    }
+    i = j;
+  }
+  return contents;
+}
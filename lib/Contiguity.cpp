@@ -0,0 +1,317 @@
+//===- Contiguity.cpp -----------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "Contiguity.h"
+#include "Diagnostics.h"
+#include "PFrame.h"
+#include "PMemory.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <unistd.h>
+
+// Number of kpageflags and kpagecount entries read with a single call
+static const uint64_t max_chunk_frames = 16384;
+// Size of a transparent huge page
+static const uint64_t huge_page_bytes = 2 << 20;
+
+/**
+ * \brief Returns floor(log2(value)) for a value greater than 0.
+ */
+static unsigned getOrder(uint64_t value) {
+  return 63 - __builtin_clzll(value);
+}
+
+RangeContiguity::RangeContiguity(const VPageRange &range)
+ : vp_range(&range), resident_pages(0), unresolved_pages(0), num_runs(0),
+   largest_run(0) {
+  std::fill(run_orders, run_orders + num_orders, 0);
+}
+
+double RangeContiguity::getMeanRunLength(void) const {
+  return (num_runs == 0) ? 0.0
+      : static_cast<double>(resident_pages - unresolved_pages) / num_runs;
+}
+
+ProcessContiguity::ProcessContiguity(const std::string &pid) : process_id(pid) {
+}
+
+/**
+ * \brief Returns the sum of the given counter over all ranges.
+ */
+uint64_t ProcessContiguity::getCount(uint64_t RangeContiguity::*counter) const {
+  uint64_t count = 0;
+  for (const RangeContiguity &cur_range_contiguity : range_contiguities) {
+    count += cur_range_contiguity.*counter;
+  }
+  return count;
+}
+
+uint64_t ProcessContiguity::getLargestRun(void) const {
+  uint64_t largest_run = 0;
+  for (const RangeContiguity &cur_range_contiguity : range_contiguities) {
+    largest_run = std::max(largest_run, cur_range_contiguity.largest_run);
+  }
+  return largest_run;
+}
+
+ZoneFragmentation::ZoneFragmentation(int nodeno, const std::string &zonename,
+    uint64_t firstframe, uint64_t numframes)
+ : node_no(nodeno), zone_name(zonename), first_frame(firstframe),
+   num_frames(numframes), free_pages(0) {
+  std::fill(free_blocks, free_blocks + num_orders, 0);
+}
+
+/**
+ * \brief Returns the number of free pages in blocks of at least the given
+ * \brief order.
+ */
+uint64_t ZoneFragmentation::getFreePages(unsigned min_order) const {
+  uint64_t num_pages = 0;
+  for (unsigned i = min_order; i < num_orders; ++i) {
+    num_pages += free_blocks[i] << i;
+  }
+  return num_pages;
+}
+
+/**
+ * \brief Returns the unusable free space index of the given order.
+ *
+ * The index is the fraction of the free pages that lie in blocks too small
+ * for an allocation of that order (see the extfrag directory in debugfs). A
+ * high index means that allocations of the order fail although enough
+ * memory is free, so compaction would help.
+ */
+double ZoneFragmentation::getUnusableIndex(unsigned order) const {
+  if (free_pages == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(free_pages - getFreePages(order)) / free_pages;
+}
+
+/**
+ * \brief Returns the order of a transparent huge page.
+ */
+unsigned getHugePageOrder(void) {
+  return getOrder(huge_page_bytes / sysconf(_SC_PAGESIZE));
+}
+
+/**
+ * \brief Computes the contiguity of a single range.
+ */
+static void computeRangeContiguity(RangeContiguity &range_contiguity) {
+  const uint64_t page_size = range_contiguity.vp_range->getPageSize();
+  uint64_t run_length = 0;
+  uint64_t prev_address = 0;
+  uint64_t prev_frame = 0;
+  auto finishRun = [&range_contiguity, &run_length]() {
+    if (run_length == 0) {
+      return;
+    }
+    ++range_contiguity.num_runs;
+    range_contiguity.largest_run = std::max(range_contiguity.largest_run, run_length);
+    ++range_contiguity.run_orders[std::min(getOrder(run_length),
+                                           RangeContiguity::num_orders - 1)];
+    run_length = 0;
+  };
+  for (const VPage &cur_vpage : range_contiguity.vp_range->getVPages()) {
+    if ((cur_vpage.arePagePropertiesValid() == false)
+     || (cur_vpage.isPresentRAM() == false)) {
+      finishRun();
+      continue;
+    }
+    ++range_contiguity.resident_pages;
+    if (cur_vpage.getFrameNumber() == 0) {
+      ++range_contiguity.unresolved_pages;
+      finishRun();
+      continue;
+    }
+    if ((run_length > 0)
+     && ((cur_vpage.getStartAddress() != prev_address + page_size)
+      || (cur_vpage.getFrameNumber() != prev_frame + 1))) {
+      finishRun();
+    }
+    ++run_length;
+    prev_address = cur_vpage.getStartAddress();
+    prev_frame = cur_vpage.getFrameNumber();
+  }
+  finishRun();
+}
+
+/**
+ * \brief Computes how physically contiguous the resident pages of the ranges
+ * \brief of the given processes are.
+ *
+ * The pages must already be populated. Only ranges with resident pages are
+ * part of the result.
+ */
+std::vector<ProcessContiguity> computeContiguity(
+    const std::vector<Process> &processes) {
+  std::vector<ProcessContiguity> contiguities;
+  for (const Process &cur_proc : processes) {
+    ProcessContiguity cur_proc_contiguity(cur_proc.getPID());
+    for (const VPageRange &cur_vpr : cur_proc.getVPageRanges()) {
+      RangeContiguity cur_range_contiguity(cur_vpr);
+      computeRangeContiguity(cur_range_contiguity);
+      if (cur_range_contiguity.resident_pages > 0) {
+        cur_proc_contiguity.range_contiguities.push_back(cur_range_contiguity);
+      }
+    }
+    contiguities.push_back(std::move(cur_proc_contiguity));
+  }
+  return contiguities;
+}
+
+/**
+ * \brief Returns the memory zones with frames listed by the zoneinfo file of
+ * \brief the proc root.
+ *
+ * The frames of a zone start at its start_pfn and span the number of
+ * spanned pages. If the file cannot be read or lacks the first frames of the
+ * zones a single zone covering all frames is returned.
+ */
+std::vector<ZoneFragmentation> readZones(const CmdOptions &cmd_opts) {
+  std::vector<ZoneFragmentation> zones;
+  std::ifstream zoneinfo_file(cmd_opts.cmd_proc_root + "/zoneinfo");
+  std::string cur_line;
+  int cur_node_no = -1;
+  std::string cur_zone_name;
+  uint64_t cur_spanned = 0;
+  bool has_spanned = false;
+  while (std::getline(zoneinfo_file, cur_line).good() == true) {
+    std::istringstream line_stream(cur_line);
+    std::string cur_key;
+    line_stream >> cur_key;
+    if (cur_key.compare("Node") == 0) {
+      // Node <no>, zone <name>
+      std::string zone_key;
+      line_stream >> cur_node_no;
+      line_stream.ignore(1);
+      line_stream >> zone_key >> cur_zone_name;
+      has_spanned = false;
+    } else if (cur_key.compare("spanned") == 0) {
+      has_spanned = (line_stream >> cur_spanned).fail() == false;
+    } else if (cur_key.compare("start_pfn:") == 0) {
+      uint64_t cur_start_pfn = 0;
+      if (((line_stream >> cur_start_pfn).fail() == false)
+       && (has_spanned == true) && (cur_spanned > 0)) {
+        zones.push_back(ZoneFragmentation(cur_node_no, cur_zone_name,
+            cur_start_pfn, cur_spanned));
+      }
+    }
+  }
+  if (zones.empty() == true) {
+    zones.push_back(ZoneFragmentation(-1, "all", 0,
+        std::numeric_limits<uint64_t>::max()));
+  }
+  return zones;
+}
+
+/**
+ * \brief Reads up to \c num_entries 64bit entries of a frame file starting at
+ * \brief the entry of \c first_frame. Returns the number of entries read.
+ */
+static uint64_t readFrameEntries(int fd, uint64_t first_frame,
+    uint64_t num_entries, uint64_t *entries) {
+  const ssize_t read_bytes = pread(fd, entries, num_entries * sizeof(uint64_t),
+                                   first_frame * sizeof(uint64_t));
+  ScanStats::count(ScanStats::Counter::Syscalls);
+  if (read_bytes <= 0) {
+    if (read_bytes == -1) {
+      errs() << "Could not properly read from frame file!" << std::endl;
+      printSystemError("pread:");
+    }
+    return 0;
+  }
+  ScanStats::count(ScanStats::Counter::BytesRead, read_bytes);
+  return read_bytes / sizeof(uint64_t);
+}
+
+/**
+ * \brief Counts the free blocks of the buddy allocator per order in each of
+ * \brief the given zones.
+ *
+ * The kpageflags and kpagecount files are streamed in chunks, so no frame
+ * objects are kept. The order of a free block is not exported and depending
+ * on the kernel the buddy flag is set for the first or for all frames of a
+ * free block. So runs of free frames are collected instead: a run starts at
+ * a frame with the buddy flag and extends over the following frames with the
+ * flag. Frames without flags and references only extend it within the
+ * largest aligned block the last flagged frame could start, as holes of the
+ * memory map look the same. Each run is split into the largest blocks its
+ * alignment allows, just like the buddy allocator merges free blocks.
+ * Returns \c false if the frame files cannot be read.
+ */
+bool scanFreeBlocks(const CmdOptions &cmd_opts,
+    std::vector<ZoneFragmentation> &zones) {
+  int flags_fd = -1, refcount_fd = -1;
+  if (PMemory::openFrameFiles(cmd_opts, flags_fd, refcount_fd) == false) {
+    return false;
+  }
+  std::vector<uint64_t> frame_flags(max_chunk_frames);
+  std::vector<uint64_t> frame_refcounts(max_chunk_frames);
+  PFrame cur_pframe(0);
+  uint64_t num_frames = 0;
+  for (ZoneFragmentation &cur_zone : zones) {
+    uint64_t run_first = 0;
+    uint64_t run_frames = 0;
+    uint64_t block_end = 0;
+    auto finishRun = [&cur_zone, &run_first, &run_frames]() {
+      while (run_frames > 0) {
+        unsigned order = std::min(getOrder(run_frames),
+                                  ZoneFragmentation::num_orders - 1);
+        if (run_first != 0) {
+          order = std::min(order, static_cast<unsigned>(__builtin_ctzll(run_first)));
+        }
+        ++cur_zone.free_blocks[order];
+        cur_zone.free_pages += 1ULL << order;
+        run_first += 1ULL << order;
+        run_frames -= 1ULL << order;
+      }
+    };
+    const uint64_t zone_end = (cur_zone.num_frames >
+        std::numeric_limits<uint64_t>::max() - cur_zone.first_frame)
+        ? std::numeric_limits<uint64_t>::max()
+        : (cur_zone.first_frame + cur_zone.num_frames);
+    for (uint64_t cur_frame = cur_zone.first_frame; cur_frame < zone_end; ) {
+      const uint64_t cur_chunk_frames = std::min(zone_end - cur_frame, max_chunk_frames);
+      const uint64_t valid_frames = std::min(
+          readFrameEntries(flags_fd, cur_frame, cur_chunk_frames, frame_flags.data()),
+          readFrameEntries(refcount_fd, cur_frame, cur_chunk_frames,
+                           frame_refcounts.data()));
+      for (uint64_t i = 0; i < valid_frames; ++i) {
+        const uint64_t frame_no = cur_frame + i;
+        cur_pframe.setRawFrameProperties(frame_flags[i], frame_refcounts[i], true);
+        if (cur_pframe.byBuddy() == true) {
+          const unsigned max_order = ZoneFragmentation::num_orders - 1;
+          block_end = frame_no + (1ULL << ((frame_no == 0) ? max_order
+              : std::min(max_order, static_cast<unsigned>(__builtin_ctzll(frame_no)))));
+          if (run_frames == 0) {
+            run_first = frame_no;
+          }
+          ++run_frames;
+        } else if ((run_frames > 0) && (frame_no < block_end)
+                && (frame_flags[i] == 0) && (frame_refcounts[i] == 0)) {
+          ++run_frames;
+        } else {
+          finishRun();
+        }
+      }
+      num_frames += valid_frames;
+      if (valid_frames < cur_chunk_frames) {
+        break;
+      }
+      cur_frame += cur_chunk_frames;
+    }
+    finishRun();
+    if (cur_zone.num_frames == std::numeric_limits<uint64_t>::max()) {
+      cur_zone.num_frames = num_frames;
+    }
+  }
+  ScanStats::count(ScanStats::Counter::Frames, num_frames);
+  return true;
+}
@@ -0,0 +1,70 @@
+//===- Diagnostics.cpp ----------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "Diagnostics.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <streambuf>
+
+/**
+ * A stream buffer that discards everything. It backs the streams that were
+ * silenced by passing \c nullptr.
+ */
+class DiscardBuffer : public std::streambuf {
+protected:
+  int overflow(int c) override {
+    return c;
+  }
+  std::streamsize xsputn(const char*, std::streamsize n) override {
+    return n;
+  }
+};
+
+static DiscardBuffer discard_buffer;
+static std::ostream discard_stream(&discard_buffer);
+static std::atomic<std::ostream*> error_stream(&std::cerr);
+static std::atomic<std::ostream*> log_stream(&std::clog);
+
+/**
+ * \brief Returns the stream error messages are written to.
+ */
+std::ostream& errs(void) {
+  return *error_stream.load();
+}
+
+/**
+ * \brief Returns the stream verbose messages are written to.
+ */
+std::ostream& logs(void) {
+  return *log_stream.load();
+}
+
+/**
+ * \brief Redirects the error messages to the given stream. If \c stream is
+ * \brief \c nullptr all error messages are discarded.
+ */
+void setErrorStream(std::ostream *stream) {
+  error_stream = (stream != nullptr) ? stream : &discard_stream;
+}
+
+/**
+ * \brief Redirects the verbose messages to the given stream. If \c stream is
+ * \brief \c nullptr all verbose messages are discarded.
+ */
+void setLogStream(std::ostream *stream) {
+  log_stream = (stream != nullptr) ? stream : &discard_stream;
+}
+
+/**
+ * \brief Writes the description of the current \c errno to the error stream.
+ *
+ * Works like \c perror but uses the error stream of the library.
+ */
+void printSystemError(const char *prefix) {
+  const int saved_errno = errno;
+  errs() << prefix << ": " << strerror(saved_errno) << std::endl;
+  errno = saved_errno;
+}
@@ -0,0 +1,140 @@
+//===- FileUsage.cpp ------------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "FileUsage.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+/**
+ * A present page of a mapped file. The pages of all processes are collected
+ * and sorted so the mappings of each frame end up next to each other.
+ */
+class MappedFrame {
+public:
+  uint64_t frame_no;
+  uint32_t usage_no;
+  uint32_t process_no;
+
+  MappedFrame(uint64_t frameno, uint32_t usageno, uint32_t processno)
+   : frame_no(frameno), usage_no(usageno), process_no(processno) {}
+
+  bool operator<(const MappedFrame &other) const {
+    if (usage_no != other.usage_no) {
+      return usage_no < other.usage_no;
+    }
+    if (frame_no != other.frame_no) {
+      return frame_no < other.frame_no;
+    }
+    return process_no < other.process_no;
+  }
+};
+
+FileUsage::FileUsage(PathTable::PathID id, uint64_t pagesize)
+ : path_id(id), num_processes(0), num_ranges(0), mapped_pages(0),
+   resident_frames(0), shared_frames(0), dirty_frames(0), writeback_frames(0),
+   copied_frames(0), unresolved_pages(0), page_size(pagesize) {
+}
+
+/**
+ * \brief Aggregates the memory used by each file mapped by the processes.
+ *
+ * The ranges are grouped by the id of their mapped file, so all mappings of
+ * a file count towards the same entry no matter which process maps it. The
+ * returned list is sorted by the number of resident bytes, the largest first.
+ * The flags of the frames are taken from \c pmem; frames missing there are
+ * counted as page cache.
+ */
+std::vector<FileUsage> computeFileUsage(const std::vector<Process> &processes,
+    const PMemory &pmem) {
+  std::vector<FileUsage> usages;
+  std::unordered_map<PathTable::PathID, uint32_t> usage_nos;
+  // The number of the last process that mapped each file (plus one)
+  std::vector<uint32_t> last_process_nos;
+  std::vector<MappedFrame> mapped_frames;
+  for (uint32_t i = 0; i < processes.size(); ++i) {
+    for (const VPageRange &cur_vpr : processes[i].getVPageRanges()) {
+      if ((cur_vpr.getMappingType() != VPageRange::MappingType::Filemapping)
+       || (cur_vpr.getMappedFileID() == PathTable::empty_path)) {
+        continue;
+      }
+      std::unordered_map<PathTable::PathID, uint32_t>::const_iterator usage_it =
+          usage_nos.find(cur_vpr.getMappedFileID());
+      if (usage_it == usage_nos.end()) {
+        usage_it = usage_nos.insert(std::make_pair(cur_vpr.getMappedFileID(),
+            static_cast<uint32_t>(usages.size()))).first;
+        usages.push_back(FileUsage(cur_vpr.getMappedFileID(), cur_vpr.getPageSize()));
+        last_process_nos.push_back(0);
+      }
+      const uint32_t cur_usage_no = usage_it->second;
+      FileUsage &cur_usage = usages[cur_usage_no];
+      if (last_process_nos[cur_usage_no] != i + 1) {
+        last_process_nos[cur_usage_no] = i + 1;
+        ++cur_usage.num_processes;
+      }
+      ++cur_usage.num_ranges;
+      cur_usage.mapped_pages += cur_vpr.num();
+      for (const VPage &cur_vpage : cur_vpr.getVPages()) {
+        if ((cur_vpage.arePagePropertiesValid() == false)
+         || (cur_vpage.isPresentRAM() == false)) {
+          continue;
+        }
+        if (cur_vpage.getFrameNumber() == 0) {
+          ++cur_usage.unresolved_pages;
+        } else {
+          mapped_frames.push_back(MappedFrame(cur_vpage.getFrameNumber(),
+                                              cur_usage_no, i));
+        }
+      }
+    }
+  }
+
+  // Count each frame of a file once and check if several processes map it
+  std::sort(mapped_frames.begin(), mapped_frames.end());
+  const PMemory::PF_Map_Ty &frame_map = pmem.getPFrameMap();
+  for (size_t i = 0, e = mapped_frames.size(); i < e; ) {
+    const MappedFrame &cur_mapped_frame = mapped_frames[i];
+    FileUsage &cur_usage = usages[cur_mapped_frame.usage_no];
+    bool is_shared = false;
+    size_t j = i + 1;
+    for (; (j < e) && (mapped_frames[j].usage_no == cur_mapped_frame.usage_no)
+        && (mapped_frames[j].frame_no == cur_mapped_frame.frame_no); ++j) {
+      if (mapped_frames[j].process_no != cur_mapped_frame.process_no) {
+        is_shared = true;
+      }
+    }
+    i = j;
+    const PMemory::PF_Map_Ty::const_iterator frame_it =
+        frame_map.find(cur_mapped_frame.frame_no);
+    if ((frame_it == frame_map.end())
+     || (frame_it->second.areFramePropertiesValid() == false)) {
+      ++cur_usage.resident_frames;
+      if (is_shared == true) {
+        ++cur_usage.shared_frames;
+      }
+      continue;
+    }
+    // Private copies of written pages are anonymous memory, not page cache
+    if (frame_it->second.isAnonMapped() == true) {
+      ++cur_usage.copied_frames;
+      continue;
+    }
+    ++cur_usage.resident_frames;
+    if (is_shared == true) {
+      ++cur_usage.shared_frames;
+    }
+    if (frame_it->second.isDirty() == true) {
+      ++cur_usage.dirty_frames;
+    }
+    if (frame_it->second.isWriteback() == true) {
+      ++cur_usage.writeback_frames;
+    }
+  }
+
+  std::stable_sort(usages.begin(), usages.end(),
+      [](const FileUsage &lhs, const FileUsage &rhs) {
+        return (lhs.resident_frames + lhs.unresolved_pages)
+             > (rhs.resident_frames + rhs.unresolved_pages);
+      });
+  return usages;
+}
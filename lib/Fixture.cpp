@@ -0,0 +1,271 @@
+//===- Fixture.cpp --------------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "Fixture.h"
+#include "Diagnostics.h"
+#include "VPage.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+// Bits of the kpageflags entries (see include/uapi/linux/kernel-page-flags.h)
+static const uint64_t kpf_referenced    = 1ULL << 2;
+static const uint64_t kpf_uptodate      = 1ULL << 3;
+static const uint64_t kpf_lru           = 1ULL << 5;
+static const uint64_t kpf_active        = 1ULL << 6;
+static const uint64_t kpf_mmap          = 1ULL << 11;
+static const uint64_t kpf_anon          = 1ULL << 12;
+static const uint64_t kpf_swapbacked    = 1ULL << 14;
+static const uint64_t kpf_compound_head = 1ULL << 15;
+static const uint64_t kpf_compound_tail = 1ULL << 16;
+static const uint64_t kpf_thp           = 1ULL << 22;
+
+// Frames are handed out starting at this frame number so that the fixture
+// does not look like it starts at physical address zero
+static const uint64_t fixture_first_frame = 0x100000;
+// Ranges are placed starting at this address with a gap between them
+static const uint64_t fixture_first_address = 0x10000000;
+// Number of base pages of a transparent huge page (2 MiB)
+static const uint64_t fixture_thp_pages = 512;
+
+FixtureConfig::FixtureConfig(void)
+ : num_processes(1), vmas_per_process(16), pages_per_vma(4096),
+   resident_ratio(0.5), thp_ratio(0.0), shared_ratio(0.0), seed(1),
+   first_pid(1000) {
+}
+
+FixtureSummary::FixtureSummary(void)
+ : num_processes(0), num_ranges(0), num_pages(0), num_resident_pages(0),
+   num_frames(0) {
+}
+
+/**
+ * \brief Writes the given content into a new file.
+ */
+static bool writeFile(const std::string &path, const std::string &content) {
+  const int file_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (file_fd == -1) {
+    errs() << "Could not create fixture file " << path << std::endl;
+    printSystemError("open:");
+    return false;
+  }
+  const ssize_t written_bytes = write(file_fd, content.data(), content.size());
+  close(file_fd);
+  if (written_bytes != static_cast<ssize_t>(content.size())) {
+    errs() << "Could not write fixture file " << path << std::endl;
+    printSystemError("write:");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * \brief Writes the given 64bit words at the position of the first word's
+ * \brief index into the file. The skipped parts of the file remain holes.
+ */
+static bool writeWords(int file_fd, const std::string &path, uint64_t first_index,
+    const std::vector<uint64_t> &words) {
+  const size_t num_bytes = words.size() * sizeof(uint64_t);
+  const ssize_t written_bytes = pwrite(file_fd, words.data(), num_bytes,
+      first_index * sizeof(uint64_t));
+  if (written_bytes != static_cast<ssize_t>(num_bytes)) {
+    errs() << "Could not write fixture file " << path << std::endl;
+    printSystemError("pwrite:");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * \brief Creates a directory if it does not exist yet.
+ */
+static bool makeDirectory(const std::string &path) {
+  if ((mkdir(path.c_str(), 0755) != 0) && (errno != EEXIST)) {
+    errs() << "Could not create fixture directory " << path << std::endl;
+    printSystemError("mkdir:");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * \brief Generates a synthetic proc tree in the directory \c root_path.
+ * \param summary If not \c nullptr it receives the size of the fixture.
+ *
+ * The content only depends on the given configuration so generating a fixture
+ * twice with the same configuration yields the same files. Returns \c false
+ * if any of the files could not be written.
+ */
+bool generateFixture(const FixtureConfig &config, const std::string &root_path,
+    FixtureSummary *summary) {
+  FixtureSummary tmp_summary;
+  if (makeDirectory(root_path) == false) {
+    return false;
+  }
+  const uint64_t page_size = sysconf(_SC_PAGESIZE);
+  const std::string uid(std::to_string(getuid()));
+  std::mt19937_64 rand_gen(config.seed);
+  std::bernoulli_distribution resident_dist(config.resident_ratio);
+  std::bernoulli_distribution thp_dist(config.thp_ratio);
+  std::bernoulli_distribution shared_dist(config.shared_ratio);
+
+  // Frame flags and reference counts indexed by frame number minus the first
+  // frame number
+  std::vector<uint64_t> frame_flags;
+  std::vector<uint64_t> frame_refcnts;
+  // The pagemap entries of the shared ranges by range index. They are created
+  // by the first process mapping the range and reused by all others.
+  std::vector<std::vector<uint64_t>> shared_entries(config.vmas_per_process);
+
+  // Ranges are spaced by at least one huge page so that huge pages are aligned
+  const uint64_t range_pages = ((config.pages_per_vma + fixture_thp_pages - 1)
+                                / fixture_thp_pages) * fixture_thp_pages;
+  const uint64_t range_stride = (range_pages + fixture_thp_pages) * page_size;
+
+  for (unsigned cur_proc = 0; cur_proc < config.num_processes; ++cur_proc) {
+    const std::string pid(std::to_string(config.first_pid + cur_proc));
+    const std::string proc_path(root_path + "/" + pid);
+    if (makeDirectory(proc_path) == false) {
+      return false;
+    }
+    const std::string pagemap_path(proc_path + "/pagemap");
+    const int pagemap_fd = open(pagemap_path.c_str(),
+                                O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (pagemap_fd == -1) {
+      errs() << "Could not create fixture file " << pagemap_path << std::endl;
+      printSystemError("open:");
+      return false;
+    }
+
+    std::ostringstream maps_content;
+    std::vector<uint64_t> entries;
+    for (unsigned cur_vma = 0; cur_vma < config.vmas_per_process; ++cur_vma) {
+      const uint64_t start_address = fixture_first_address + cur_vma * range_stride;
+      const uint64_t end_address = start_address + config.pages_per_vma * page_size;
+      const bool shared = shared_dist(rand_gen);
+      maps_content << std::hex << std::setfill('0') << std::setw(8) << start_address
+                   << "-" << std::setw(8) << end_address;
+      if (shared == true) {
+        maps_content << " r--s 00000000 00:00 " << std::dec << (cur_vma + 1)
+                     << " /fixture/shared-" << cur_vma << "\n";
+      } else {
+        maps_content << " rw-p 00000000 00:00 0\n";
+      }
+
+      if ((shared == true) && (shared_entries[cur_vma].empty() == false)) {
+        // Map the frames of the range created by an earlier process
+        entries = shared_entries[cur_vma];
+        for (uint64_t cur_entry : entries) {
+          if (PagemapEntry::isPresentRAM(cur_entry) == true) {
+            ++frame_refcnts[PagemapEntry::getFrameNumber(cur_entry) - fixture_first_frame];
+            ++tmp_summary.num_resident_pages;
+          }
+        }
+      } else {
+        entries.assign(config.pages_per_vma, 0);
+        const uint64_t entry_bits = (shared == true)
+            ? (PagemapEntry::present_ram_bit | PagemapEntry::file_mapped_bit)
+            : (PagemapEntry::present_ram_bit | PagemapEntry::exclusive_bit);
+        const uint64_t base_flags = (shared == true)
+            ? (kpf_mmap | kpf_lru | kpf_uptodate | kpf_referenced)
+            : (kpf_mmap | kpf_anon | kpf_swapbacked | kpf_lru | kpf_uptodate);
+        for (uint64_t cur_page = 0; cur_page < config.pages_per_vma; ) {
+          // A huge page covers a whole aligned block of base pages
+          if (((cur_page % fixture_thp_pages) == 0)
+           && (cur_page + fixture_thp_pages <= config.pages_per_vma)
+           && (thp_dist(rand_gen) == true)) {
+            // Huge pages need physically aligned frames
+            while (((fixture_first_frame + frame_flags.size()) % fixture_thp_pages) != 0) {
+              frame_flags.push_back(0);
+              frame_refcnts.push_back(0);
+            }
+            for (uint64_t i = 0; i < fixture_thp_pages; ++i) {
+              const uint64_t frame_no = fixture_first_frame + frame_flags.size();
+              entries[cur_page + i] = entry_bits | frame_no;
+              frame_flags.push_back(base_flags | kpf_thp | kpf_active
+                  | ((i == 0) ? kpf_compound_head : kpf_compound_tail));
+              frame_refcnts.push_back(1);
+            }
+            tmp_summary.num_resident_pages += fixture_thp_pages;
+            cur_page += fixture_thp_pages;
+            continue;
+          }
+          if (resident_dist(rand_gen) == true) {
+            const uint64_t frame_no = fixture_first_frame + frame_flags.size();
+            entries[cur_page] = entry_bits | frame_no;
+            frame_flags.push_back(base_flags | (((cur_page & 1) == 0) ? kpf_active : 0));
+            frame_refcnts.push_back(1);
+            ++tmp_summary.num_resident_pages;
+          }
+          ++cur_page;
+        }
+        if (shared == true) {
+          shared_entries[cur_vma] = entries;
+        }
+      }
+      if (writeWords(pagemap_fd, pagemap_path, start_address / page_size,
+                     entries) == false) {
+        close(pagemap_fd);
+        return false;
+      }
+      ++tmp_summary.num_ranges;
+      tmp_summary.num_pages += config.pages_per_vma;
+    }
+    close(pagemap_fd);
+
+    if ((writeFile(proc_path + "/maps", maps_content.str()) == false)
+     || (writeFile(proc_path + "/stat", pid + " (fixture) S 1 " + pid + " " + pid
+                   + " 0 -1 4194560 0 0 0 0 0 0 0 0 20 0 1 0 0 0 0\n") == false)
+     || (writeFile(proc_path + "/status", "Name:\tfixture\nUid:\t" + uid + "\t"
+                   + uid + "\t" + uid + "\t" + uid + "\n") == false)
+     || (writeFile(proc_path + "/cmdline", std::string("fixture\0--id\0", 13)
+                   + pid + std::string(1, '\0')) == false)) {
+      return false;
+    }
+    ++tmp_summary.num_processes;
+  }
+
+  // Now write the frame files. Frames below the first frame remain holes.
+  const std::string flags_path(root_path + "/kpageflags");
+  const std::string refcnt_path(root_path + "/kpagecount");
+  const int flags_fd = open(flags_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  const int refcnt_fd = open(refcnt_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if ((flags_fd == -1) || (refcnt_fd == -1)) {
+    errs() << "Could not create the fixture frame files in " << root_path << std::endl;
+    printSystemError("open:");
+    if (flags_fd != -1) {
+      close(flags_fd);
+    }
+    if (refcnt_fd != -1) {
+      close(refcnt_fd);
+    }
+    return false;
+  }
+  const bool written =
+      (writeWords(flags_fd, flags_path, fixture_first_frame, frame_flags) == true)
+   && (writeWords(refcnt_fd, refcnt_path, fixture_first_frame, frame_refcnts) == true);
+  close(flags_fd);
+  close(refcnt_fd);
+  if (written == false) {
+    return false;
+  }
+  // Frames skipped to align huge pages are not used by any page
+  for (uint64_t cur_refcnt : frame_refcnts) {
+    if (cur_refcnt > 0) {
+      ++tmp_summary.num_frames;
+    }
+  }
+
+  if (summary != nullptr) {
+    *summary = tmp_summary;
+  }
+  return true;
+}
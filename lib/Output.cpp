@@ -2,9 +2,11 @@
 //===----------------------------------------------------------------------===//
 
 #include "Output.h"
+#include "Trace.h"
 #include "VPage.h"
 
 #include <iomanip>
+#include <string>
 
 // Some length for producing output (addresses are counted without the 0x)
 static const int out_width_range_no = 4;
@@ -55,7 +57,14 @@ void printHelpMessage(std::ostream &stream) {
   stream << "OPTIONS:" << std::endl;
   stream << "  -a     Show mapping for all virtual pages and do not " << std::endl
          << "         omit unmapped pages." << std::endl;
+  stream << "  -A     Scan all processes of the system instead of " << std::endl
+         << "         the given process ids. Kernel threads and " << std::endl
+         << "         processes that exit during the scan are " << std::endl
+         << "         skipped." << std::endl;
   stream << "  -h     Print this help message." << std::endl;
+  stream << "  -j n   Scan the processes with n worker threads. By " << std::endl
+         << "         default one thread per CPU is used. In verbose " << std::endl
+         << "         mode only a single thread is used." << std::endl;
   stream << "  -l x   Use x as lower address and limit the list of " << std::endl
          << "         mappings to all pages and ranges that have a " << std::endl
          << "         higher addresses." << std::endl;
@@ -71,12 +80,128 @@ void printHelpMessage(std::ostream &stream) {
          << "         options MUST be specified by the user! Then all " << std::endl
          << "         the mapping for all virtual pages within that " << std::endl
          << "         interval will be shown (no matter if the pages " << std::endl
-         << "         are actually mapped or not)." << std::endl;
+         << "         are actually mapped or not). Unmapped holes are " << std::endl
+         << "         shown as a single range without reading their " << std::endl
+         << "         pages." << std::endl;
   stream << "  -r     Do only list the page ranges and omit the " << std::endl
          << "         mapping for each single page." << std::endl;
   stream << "  -u x   Use x as upper address and limit the list of " << std::endl
          << "         mappings to all pages and ranges that have a " << std::endl
          << "         lower address." << std::endl;
+  stream << "  --save f" << std::endl
+         << "         Capture the ranges, pages and frames into the " << std::endl
+         << "         snapshot file f instead of printing them." << std::endl;
+  stream << "  --load f" << std::endl
+         << "         Print the ranges, pages and frames stored in the " << std::endl
+         << "         snapshot file f. /proc is not accessed and the " << std::endl
+         << "         given process ids are ignored." << std::endl;
+  stream << "  --diff f" << std::endl
+         << "         Compare the snapshot file f with the snapshot " << std::endl
+         << "         given by --load and print the added and removed " << std::endl
+         << "         ranges and the changed pages of each range." << std::endl;
+  stream << "  --watch s" << std::endl
+         << "         Rescan the processes every s seconds and only " << std::endl
+         << "         print the ranges that appeared or disappeared " << std::endl
+         << "         and the ranges whose number of resident pages " << std::endl
+         << "         changed." << std::endl;
+  stream << "  --soft-dirty s" << std::endl
+         << "         Clear the soft-dirty bits of the processes, wait " << std::endl
+         << "         s seconds and print the number of pages each " << std::endl
+         << "         range wrote to in the meantime and its write " << std::endl
+         << "         rate. Unless -r is given the written pages are " << std::endl
+         << "         listed." << std::endl;
+  stream << "  --comm r" << std::endl
+         << "         Only examine processes whose command name " << std::endl
+         << "         matches the regular expression r." << std::endl;
+  stream << "  --cmdline r" << std::endl
+         << "         Only examine processes whose command line " << std::endl
+         << "         matches the regular expression r." << std::endl;
+  stream << "  --uid n" << std::endl
+         << "         Only examine processes whose effective user " << std::endl
+         << "         id is n." << std::endl;
+  stream << "  --cgroup p" << std::endl
+         << "         Only examine processes of the cgroup p (relative " << std::endl
+         << "         to /sys/fs/cgroup) and of its child cgroups." << std::endl
+         << "         If selectors are given without process ids, " << std::endl
+         << "         all processes of the system are considered." << std::endl;
+  stream << "  --proc-root d" << std::endl
+         << "         Read the process and frame files from the " << std::endl
+         << "         directory d instead of /proc. The directory must " << std::endl
+         << "         have the same layout as /proc." << std::endl;
+  stream << "  --stats[=json]" << std::endl
+         << "         Print the wall and CPU time of each phase of the " << std::endl
+         << "         scan, the number of system calls, read bytes, " << std::endl
+         << "         pages and frames and the peak memory usage to " << std::endl
+         << "         stderr. With =json a JSON object is printed." << std::endl;
+  stream << "  --trace f" << std::endl
+         << "         Record the reading of each process, range and " << std::endl
+         << "         frame batch and the output per process and " << std::endl
+         << "         write them in the Chrome trace-event format to " << std::endl
+         << "         the file f (viewable with Perfetto)." << std::endl;
+  stream << "  --sample n[,stride]" << std::endl
+         << "         Read only n randomly chosen pages of each range " << std::endl
+         << "         (or every k-th page with ,stride) and print the " << std::endl
+         << "         estimated fractions of resident, swapped, dirty " << std::endl
+         << "         and THP pages with their 95% confidence " << std::endl
+         << "         intervals." << std::endl;
+  stream << "  --max-mem n" << std::endl
+         << "         Keep the memory used for pages and frames below " << std::endl
+         << "         n bytes (suffixes K, M and G are accepted). The " << std::endl
+         << "         processes are read one by one in windows of pages " << std::endl
+         << "         that fit into the budget. If not even the ranges " << std::endl
+         << "         of a process fit, its pages are omitted. The used " << std::endl
+         << "         memory is estimated; --stats prints the estimate " << std::endl
+         << "         next to the measured growth of the resident set." << std::endl;
+  stream << "  --translate[=f]" << std::endl
+         << "         Read lines of the form \"<pid> <vaddr>\" from the " << std::endl
+         << "         file f (or from stdin) and print for each address " << std::endl
+         << "         the page flags and the physical address, frame " << std::endl
+         << "         flags and reference count or the swap location. " << std::endl
+         << "         Only the pagemap entries of the requested pages " << std::endl
+         << "         are read." << std::endl;
+  stream << "  --files" << std::endl
+         << "         Print for each mapped file the resident bytes, " << std::endl
+         << "         the bytes shared by several of the examined " << std::endl
+         << "         processes and the number of dirty and writeback " << std::endl
+         << "         pages instead of the mappings. Frames mapped " << std::endl
+         << "         several times are counted once. Private copies " << std::endl
+         << "         of written pages are listed as copied pages." << std::endl;
+  stream << "  --content[=rate]" << std::endl
+         << "         Read the contents of the resident pages of the " << std::endl
+         << "         anonymous ranges and print per range how many " << std::endl
+         << "         pages only contain zeros or duplicate other pages " << std::endl
+         << "         (of the same or other processes) and could be " << std::endl
+         << "         reclaimed. At most rate bytes per second are " << std::endl
+         << "         read (default 256M, 0 for no limit)." << std::endl;
+  stream << "  --swap" << std::endl
+         << "         Print for each range with swapped pages the runs " << std::endl
+         << "         of adjacent swap slots, the mean seek distance " << std::endl
+         << "         between the runs and the slots read by the swap " << std::endl
+         << "         readahead (vm.page-cluster) to fault the pages " << std::endl
+         << "         back in. Then the slots used on each swap device " << std::endl
+         << "         are listed." << std::endl;
+  stream << "  --pfn l" << std::endl
+         << "         Print every process and virtual address that maps " << std::endl
+         << "         one of the frames in the list l together with the " << std::endl
+         << "         flags of the frame. The list contains hex frame " << std::endl
+         << "         numbers or ranges of them (first-last) separated " << std::endl
+         << "         by commas. Without process ids all processes are " << std::endl
+         << "         scanned." << std::endl;
+  stream << "  --phys l" << std::endl
+         << "         Like --pfn but the list contains physical " << std::endl
+         << "         addresses instead of frame numbers." << std::endl;
+  stream << "  --contiguity" << std::endl
+         << "         Print for each range with resident pages the runs " << std::endl
+         << "         of physically contiguous frames backing them, " << std::endl
+         << "         their mean and largest length and the number of " << std::endl
+         << "         runs per order (a run of n pages has the order " << std::endl
+         << "         floor(log2(n)))." << std::endl;
+  stream << "  --fragmentation" << std::endl
+         << "         Print for each memory zone the free blocks of the " << std::endl
+         << "         buddy allocator per order, the huge pages that " << std::endl
+         << "         could be allocated from them and the fraction of " << std::endl
+         << "         free memory unusable for huge pages. The flags of " << std::endl
+         << "         all frames are read. No processes are scanned." << std::endl;
   stream << std::endl;
   stream << "PROCESSIDs:" << std::endl;
   stream << "  The ids of the processes whose address spaces should " << std::endl
@@ -148,6 +273,282 @@ void printMappingHeadline(const CmdOptions &cmd_opts, std::ostream &stream) {
   stream.flags(original_fmt_flags);
 }
 
+/**
+ * \brief Prints the flags of a virtual page as a sequence of characters.
+ */
+static void printVPageProperties(std::ostream &stream, const VPage &vpage) {
+  if (vpage.arePagePropertiesValid() == false) {
+    stream << std::string(out_width_page_props, '?');
+    return;
+  }
+  stream << getBoolChar(vpage.isPresentRAM(), 'p');
+  stream << getBoolChar(vpage.isPresentSwap(), 's');
+  stream << getBoolChar(vpage.isFileMapped(), 'f');
+  stream << getBoolChar(vpage.isExclusive(), 'e');
+  stream << getBoolChar(vpage.isSoftDirty(), 'd');
+}
+
+/**
+ * \brief Prints the flags of a physical frame as a sequence of characters.
+ */
+static void printPFrameProperties(std::ostream &stream, const PFrame &pframe) {
+  stream << getBoolChar(pframe.isLocked(), 'l');
+  stream << getBoolChar(pframe.hasError(), 'e');
+  stream << getBoolChar(pframe.isReferenced(), 'r');
+  stream << getBoolChar(pframe.isUpToDate(), 'u');
+  stream << getBoolChar(pframe.isDirty(), 'd');
+  stream << getBoolChar(pframe.isInLRU(), 'l');
+  stream << getBoolChar(pframe.isInActiveLRU(), 'a');
+  stream << getBoolChar(pframe.bySLAB(), 's');
+
+  stream << getBoolChar(pframe.isWriteback(), 'w');
+  stream << getBoolChar(pframe.isReclaim(), 'r');
+  stream << getBoolChar(pframe.byBuddy(), 'b');
+  stream << getBoolChar(pframe.isMemMapped(), 'm');
+  stream << getBoolChar(pframe.isAnonMapped(), 'a');
+  stream << getBoolChar(pframe.hasSwapCache(), 's');
+  stream << getBoolChar(pframe.isSwapBacked(), 's');
+  stream << getBoolChar(pframe.isCompdHead(), 'c');
+
+  stream << getBoolChar(pframe.isCompdTail(), 'c');
+  stream << getBoolChar(pframe.isHuge(), 'h');
+  stream << getBoolChar(pframe.isUnevictable(), 'u');
+  stream << getBoolChar(pframe.isHWPoison(), 'p');
+  stream << getBoolChar(pframe.isNoFrame(), 'n');
+  stream << getBoolChar(pframe.isKSM(), 'k');
+  stream << getBoolChar(pframe.isTHP(), 't');
+  stream << getBoolChar(pframe.isBalloon(), 'b');
+
+  stream << getBoolChar(pframe.isZeroFrame(), 'z');
+  stream << getBoolChar(pframe.isIdle(), 'i');
+}
+
+/**
+ * \brief Prints a single line that describes the given page range.
+ *
+ * The line contains the range number, the address interval, the permissions,
+ * the mapping type, the number of pages and the offset and the mapped file.
+ */
+void printVPageRange(const CmdOptions &cmd_opts, std::ostream &stream,
+    const VPageRange &vp_range) {
+  // Store the format flags
+  std::ios_base::fmtflags original_fmt_flags = stream.flags();
+
+  // First the range number in dec
+  if ((vp_range.getMappingType() == VPageRange::MappingType::Unmapped)
+   || (vp_range.getMappingType() == VPageRange::MappingType::Mixed)) {
+    stream << std::setfill('*') << std::left;
+    stream << std::setw(out_width_range_no) << "*";
+  } else {
+    stream << std::dec << std::setfill('0') << std::right;
+    stream << std::setw(out_width_range_no) << vp_range.getVPRangeNumber();
+  }
+
+  // Then the address range
+  stream << " ";
+  stream << std::hex << std::uppercase << std::right << std::setfill('0');
+  stream << "0x";
+  stream << std::setw(out_width_range_addresses) << vp_range.getFirstAddress();
+  stream << "-0x";
+  stream << std::setw(out_width_range_addresses) << vp_range.getNextAddress();
+
+  // Now the permissions
+  stream << " ";
+  if (vp_range.getMappingType() == VPageRange::MappingType::Unmapped) {
+    stream << std::setfill('*') << std::left;
+    stream << std::setw(out_width_range_perms) << "*";
+  } else if (vp_range.getMappingType() == VPageRange::MappingType::Mixed) {
+    stream << std::setfill('?') << std::left;
+    stream << std::setw(out_width_range_perms) << "?";
+  } else {
+    stream << getTristateChar(vp_range.canRead(), 'r');
+    stream << getTristateChar(vp_range.canWrite(), 'w');
+    stream << getTristateChar(vp_range.canExec(), 'x');
+    stream << getTristateChar(vp_range.isPrivate(), 'p', 's');
+  }
+
+  // Print the mapping type
+  stream << " ";
+  if (vp_range.getMappingType() == VPageRange::MappingType::Unmapped) {
+    stream << "n-";
+  } else if (vp_range.getMappingType() == VPageRange::MappingType::Anonymous) {
+    stream << "-a";
+  } else if (vp_range.getMappingType() == VPageRange::MappingType::Filemapping) {
+    stream << "-f";
+  } else if (vp_range.getMappingType() == VPageRange::MappingType::Mixed) {
+    stream << "mu";
+  } else {
+    stream << "??";
+  }
+
+  // Now the number of pages and offset
+  if ((vp_range.getMappingType() == VPageRange::MappingType::Anonymous)
+   || (vp_range.getMappingType() == VPageRange::MappingType::Filemapping)) {
+    // First print the number of contained pages...
+    stream << " ";
+    stream << std::dec << std::setfill('0') << std::right;
+    stream << std::setw(out_width_range_nopages) << vp_range.num();
+    // ... and then the offset
+    stream << " ";
+    stream << std::hex << std::setfill('0') << std::right;
+    stream << "0x" << std::setw(out_width_range_offset) << vp_range.getMappingOffset();
+  } else {
+    // As we do not know any offset we can use more space for the number
+    // of contained pages
+    const int cur_out_width_nopages =
+        out_width_range_nopages + 1 + 2 + out_width_range_offset;
+    stream << " ";
+    stream << std::dec << std::setfill(' ') << std::left;
+    stream << std::setw(cur_out_width_nopages) << vp_range.num();
+  }
+
+  // Now print the mapped file or the "[null]" indicator
+  if (vp_range.getMappingType() == VPageRange::MappingType::Unmapped) {
+    stream << std::setfill(' ') << std::left << std::setw(out_width_range_filesep) << " ";
+    stream << "[null]";
+  } else {
+    if (vp_range.getMappedFilePath().empty() == false) {
+      stream << std::setfill(' ') << std::left << std::setw(out_width_range_filesep) << " ";
+      stream << vp_range.getMappedFilePath();
+    }
+  }
+  stream << std::endl;
+
+  // Restore format flags
+  stream.flags(original_fmt_flags);
+}
+
+/**
+ * \brief Prints a single line that describes the given page.
+ *
+ * The line contains the address and flags of the page and the location it is
+ * mapped to. For pages present in RAM the properties of the frame are looked
+ * up in \c pmem.
+ */
+void printVPage(const CmdOptions &cmd_opts, std::ostream &stream,
+    const VPage &vpage, const PMemory &pmem) {
+  // Now print the page details
+  // First some indention
+  stream << std::setfill(' ') << std::left
+         << std::setw(out_width_page_indent) << " ";
+  // First entry is the start address
+  stream << std::hex << std::uppercase << std::setfill('0') << std::right;
+  stream << "0x" << std::setw(out_width_page_startaddr) << vpage.getStartAddress();
+  // Now some page propertiers
+  stream << " ";
+  printVPageProperties(stream, vpage);
+  // Now the location the page is mapped to
+  stream << " -> ";
+  if (vpage.isPresentRAM() == true) {
+    // The current page is present in RAM
+    const PMemory::PF_Map_Ty::const_iterator cur_pframe_iter =
+        pmem.getPFrameMap().find(vpage.getFrameNumber());
+    if (cur_pframe_iter == pmem.getPFrameMap().end()) {
+      stream << "[null]" << std::endl;
+      return;
+    }
+    // Next fetch the corresponding frame
+    const PFrame &cur_pframe = cur_pframe_iter->second;
+    if (cur_pframe.areFramePropertiesValid() == false) {
+      stream << "frameno:0x";
+      stream << std::hex << std::uppercase << std::setfill('0') << std::left;
+      stream << vpage.getFrameNumber() << std::endl;
+      return;
+    }
+    // Now print the start address of the frame
+    stream << std::hex << std::uppercase << std::setfill('0') << std::right;
+    stream << "0x" << std::setw(out_width_frame_startaddr) << cur_pframe.getStartAddress();
+    // Now print the frame properties
+    stream << " ";
+    printPFrameProperties(stream, cur_pframe);
+
+    // Now print the refcounter
+    stream << " ";
+    stream << std::dec << std::setfill('0') << std::right;
+    stream << std::setw(out_width_frame_refcnt) << cur_pframe.getFrameRefCount();
+  } else if (vpage.isPresentSwap() == true) {
+    // The current page is swapped
+    stream << "swap:";
+    stream << std::dec << std::setfill('0') << std::left;
+    stream << vpage.getSwapType();
+    stream << std::hex << std::uppercase << std::setfill('0') << std::left;
+    stream << "@0x" << vpage.getSwapOffset();
+  } else if (vpage.getFrameNumber() != 0) {
+    // Page has frame number not 0
+    stream << "frameno:0x";
+    stream << std::hex << std::uppercase << std::setfill('0') << std::left;
+    stream << vpage.getFrameNumber();
+  } else {
+    // Page seems not to be mapped
+    stream << "[null]";
+  }
+  stream << std::endl;
+}
+
+/**
+ * \brief Prints the given pages of a range.
+ * \param no_omitted_pages The number of unused pages directly preceding the
+ * given pages that were not printed yet. It is updated to the number of
+ * unused pages at the end of the given pages.
+ *
+ * Unless all pages should be shown consecutive unused pages are summarized
+ * by a single line. The pages of a range can be printed in several calls.
+ */
+void printVPages(const CmdOptions &cmd_opts, std::ostream &stream,
+    const VPageRange::VP_List_Ty &vpages, const PMemory &pmem,
+    uint64_t &no_omitted_pages) {
+  for (const VPage &cur_vpage : vpages) {
+    if (cur_vpage.arePagePropertiesValid() == false) {
+      ++no_omitted_pages;
+      continue;
+    }
+    const bool isPageUsed = cur_vpage.arePagePropertiesValid()
+                          && (cur_vpage.isPresentRAM()
+                           || cur_vpage.isPresentSwap()
+                           || (cur_vpage.getFrameNumber() != 0));
+    if (cmd_opts.cmd_show_all_pages == false) {
+      if (isPageUsed == false) {
+        // Skip the current page as it is not used
+        ++no_omitted_pages;
+        continue;
+      }
+      // Test if any pages were skipped
+      if (no_omitted_pages > 0) {
+        // Print the indention for each page
+        stream << std::setfill(' ') << std::left
+               << std::setw(out_width_page_indent) << " ";
+        // Now the note that pages were skipped
+        stream << "[" << std::dec << no_omitted_pages
+               << " page" << ((no_omitted_pages != 1)?"s":"")
+               << " omitted]" << std::endl;
+        no_omitted_pages = 0;
+      }
+    }
+    printVPage(cmd_opts, stream, cur_vpage, pmem);
+  } // End of page loop
+}
+
+/**
+ * \brief Prints the note about the unused pages at the end of a range.
+ */
+void printOmittedVPages(const CmdOptions &cmd_opts, std::ostream &stream,
+    const VPageRange &vp_range, uint64_t no_omitted_pages) {
+  // Test if any pages were skipped at the end of the range
+  if (no_omitted_pages > 0) {
+    if ((vp_range.num() > 0) && (no_omitted_pages == vp_range.num())) {
+      stream << std::setfill(' ') << std::left
+             << std::setw(out_width_page_indent) << " ";
+      stream << "[all pages omitted]" << std::endl;
+    } else {
+      stream << std::setfill(' ') << std::left
+             << std::setw(out_width_page_indent) << " ";
+      stream << "[" << std::dec << no_omitted_pages
+             << " page" << ((no_omitted_pages != 1)?"s":"")
+             << " omitted]" << std::endl;
+    }
+  }
+}
+
 void printResults(const CmdOptions &cmd_opts, std::ostream &stream,
     const std::vector<Process> &processes, const PMemory &pmem) {
   // Store the format flags
@@ -159,236 +560,790 @@ void printResults(const CmdOptions &cmd_opts, std::ostream &stream,
 
   // Now print one line for each process
   for (const Process &cur_proc : processes) {
+    TraceSpan span("printResults", "pid", cur_proc.getPID());
     stream << "Process: " << cur_proc.getPID() << std::endl;
 
     // Now print the page ranges
     for (const VPageRange &cur_vpr : cur_proc.getVPageRanges()) {
-      // First the range number in dec
-      if ((cur_vpr.getMappingType() == VPageRange::MappingType::Unmapped)
-       || (cur_vpr.getMappingType() == VPageRange::MappingType::Mixed)) {
-        stream << std::setfill('*') << std::left;
-        stream << std::setw(out_width_range_no) << "*";
+      printVPageRange(cmd_opts, stream, cur_vpr);
+
+      // Now print the mapping for each page
+      if (cmd_opts.cmd_only_vpranges == false) {
+        if ((cur_vpr.getMappingType() == VPageRange::MappingType::Anonymous)
+         || (cur_vpr.getMappingType() == VPageRange::MappingType::Filemapping)
+         || (cur_vpr.getMappingType() == VPageRange::MappingType::Mixed)) {
+          uint64_t no_omitted_pages = 0;
+          printVPages(cmd_opts, stream, cur_vpr.getVPages(), pmem, no_omitted_pages);
+          printOmittedVPages(cmd_opts, stream, cur_vpr, no_omitted_pages);
+        }
       } else {
-        stream << std::dec << std::setfill('0') << std::right;
-        stream << std::setw(out_width_range_no) << cur_vpr.getVPRangeNumber();
+        if (cmd_opts.cmd_prog_mode == CmdOptions::ProgMode::Pages) {
+          stream << "Omit option \"-r\" to show mappings for each page." << std::endl;
+        }
       }
+    } // End of pagerange loop
+  } // End of process loop
 
-      // Then the address range
-      stream << " ";
-      stream << std::hex << std::uppercase << std::right << std::setfill('0');
-      stream << "0x";
-      stream << std::setw(out_width_range_addresses) << cur_vpr.getFirstAddress();
-      stream << "-0x";
-      stream << std::setw(out_width_range_addresses) << cur_vpr.getNextAddress();
+  // Restore format flags
+  stream.flags(original_fmt_flags);
+}
 
-      // Now the permissions
-      stream << " ";
-      if (cur_vpr.getMappingType() == VPageRange::MappingType::Unmapped) {
-        stream << std::setfill('*') << std::left;
-        stream << std::setw(out_width_range_perms) << "*";
-      } else if (cur_vpr.getMappingType() == VPageRange::MappingType::Mixed) {
-        stream << std::setfill('?') << std::left;
-        stream << std::setw(out_width_range_perms) << "?";
-      } else {
-        stream << getTristateChar(cur_vpr.canRead(), 'r');
-        stream << getTristateChar(cur_vpr.canWrite(), 'w');
-        stream << getTristateChar(cur_vpr.canExec(), 'x');
-        stream << getTristateChar(cur_vpr.isPrivate(), 'p', 's');
-      }
+/**
+ * \brief Returns a short description of a single page change kind.
+ */
+static const char* getPageChangeName(unsigned change_kind) {
+  switch (change_kind) {
+    case PageChange::PageAdded: return "added";
+    case PageChange::PageRemoved: return "removed";
+    case PageChange::NewlyResident: return "newly-resident";
+    case PageChange::SwappedOut: return "swapped-out";
+    case PageChange::Dropped: return "dropped";
+    case PageChange::FrameChanged: return "frame-changed";
+    case PageChange::BecameDirty: return "clean->dirty";
+    case PageChange::BecameClean: return "dirty->clean";
+    case PageChange::BecameActive: return "inactive->active";
+    case PageChange::BecameInactive: return "active->inactive";
+    default: return "unknown";
+  }
+}
 
-      // Print the mapping type
-      stream << " ";
-      if (cur_vpr.getMappingType() == VPageRange::MappingType::Unmapped) {
-        stream << "n-";
-      } else if (cur_vpr.getMappingType() == VPageRange::MappingType::Anonymous) {
-        stream << "-a";
-      } else if (cur_vpr.getMappingType() == VPageRange::MappingType::Filemapping) {
-        stream << "-f";
-      } else if (cur_vpr.getMappingType() == VPageRange::MappingType::Mixed) {
-        stream << "mu";
+/**
+ * \brief Prints the differences between two snapshots.
+ *
+ * For each process all ranges that were added or removed or that contain
+ * changed pages are printed followed by the number of pages per kind of
+ * change. Unless only ranges are requested each changed page is listed with
+ * its old and new flags.
+ */
+void printSnapshotDiff(const CmdOptions &cmd_opts, std::ostream &stream,
+    const PD_List_Ty &proc_diffs) {
+  // Store the format flags
+  std::ios_base::fmtflags original_fmt_flags = stream.flags();
+
+  printPageRangeHeadline(cmd_opts, stream);
+  for (const ProcessDiff &cur_proc_diff : proc_diffs) {
+    stream << "Process: " << cur_proc_diff.process_id;
+    if (cur_proc_diff.status == ProcessDiff::Status::Added) {
+      stream << " [added]";
+    } else if (cur_proc_diff.status == ProcessDiff::Status::Removed) {
+      stream << " [removed]";
+    }
+    stream << std::endl;
+
+    for (const RangeDiff &cur_range_diff : cur_proc_diff.range_diffs) {
+      if (cur_range_diff.hasChanges() == false) {
+        continue;
+      }
+      printVPageRange(cmd_opts, stream, cur_range_diff.vp_range);
+      // Now the summary of the range
+      stream << std::setfill(' ') << std::left
+             << std::setw(out_width_page_indent) << " ";
+      if (cur_range_diff.status == RangeDiff::Status::Added) {
+        stream << "[range added]";
+      } else if (cur_range_diff.status == RangeDiff::Status::Removed) {
+        stream << "[range removed]";
       } else {
-        stream << "??";
+        stream << "[range changed]";
+      }
+      for (unsigned i = 0; i < PageChange::num_change_kinds; ++i) {
+        if (cur_range_diff.change_counts[i] != 0) {
+          stream << " " << getPageChangeName(1u << i) << ":"
+                 << std::dec << cur_range_diff.change_counts[i];
+        }
       }
+      stream << std::endl;
 
-      // Now the number of pages and offset
-      if ((cur_vpr.getMappingType() == VPageRange::MappingType::Anonymous)
-       || (cur_vpr.getMappingType() == VPageRange::MappingType::Filemapping)) {
-        // First print the number of contained pages...
-        stream << " ";
-        stream << std::dec << std::setfill('0') << std::right;
-        stream << std::setw(out_width_range_nopages) << cur_vpr.num();
-        // ... and then the offset
-        stream << " ";
-        stream << std::hex << std::setfill('0') << std::right;
-        stream << "0x" << std::setw(out_width_range_offset) << cur_vpr.getMappingOffset();
-      } else {
-        // As we do not know any offset we can use more space for the number
-        // of contained pages
-        const int cur_out_width_nopages =
-            out_width_range_nopages + 1 + 2 + out_width_range_offset;
+      if (cmd_opts.cmd_only_vpranges == true) {
+        continue;
+      }
+      for (const PageChange &cur_change : cur_range_diff.page_changes) {
+        VPage old_page(cur_change.address), new_page(cur_change.address);
+        old_page.setRawPageProperties(cur_change.old_page_word,
+                                      cur_change.old_page_valid);
+        new_page.setRawPageProperties(cur_change.new_page_word,
+                                      cur_change.new_page_valid);
+        stream << std::setfill(' ') << std::left
+               << std::setw(out_width_page_indent) << " ";
+        stream << std::hex << std::uppercase << std::setfill('0') << std::right;
+        stream << "0x" << std::setw(out_width_page_startaddr) << cur_change.address;
         stream << " ";
-        stream << std::dec << std::setfill(' ') << std::left;
-        stream << std::setw(cur_out_width_nopages) << cur_vpr.num();
+        if ((cur_change.changes & PageChange::PageAdded) != 0) {
+          stream << std::string(out_width_page_props, '*');
+        } else {
+          printVPageProperties(stream, old_page);
+        }
+        stream << " => ";
+        if ((cur_change.changes & PageChange::PageRemoved) != 0) {
+          stream << std::string(out_width_page_props, '*');
+        } else {
+          printVPageProperties(stream, new_page);
+        }
+        const char *separator = " ";
+        for (unsigned i = 0; i < PageChange::num_change_kinds; ++i) {
+          if ((cur_change.changes & (1u << i)) != 0) {
+            stream << separator << getPageChangeName(1u << i);
+            separator = ",";
+          }
+        }
+        stream << std::endl;
       }
+    }
+  }
+
+  // Restore format flags
+  stream.flags(original_fmt_flags);
+}
+
+/**
+ * \brief Prints the deltas found by one rescan in watch mode.
+ * \param timestamp The time of the rescan in seconds since the epoch.
+ *
+ * Nothing is printed if no process changed.
+ */
+void printWatchDeltas(const CmdOptions &cmd_opts, std::ostream &stream,
+    double timestamp, const PDelta_List_Ty &deltas) {
+  if (deltas.empty() == true) {
+    return;
+  }
+  // Store the format flags
+  std::ios_base::fmtflags original_fmt_flags = stream.flags();
 
-      // Now print the mapped file or the "[null]" indicator
-      if (cur_vpr.getMappingType() == VPageRange::MappingType::Unmapped) {
-        stream << std::setfill(' ') << std::left << std::setw(out_width_range_filesep) << " ";
-        stream << "[null]";
+  stream << "Scan at " << std::fixed << std::setprecision(3) << timestamp
+         << std::endl;
+  for (const ProcessDelta &cur_delta : deltas) {
+    stream << "Process: " << cur_delta.process_id;
+    if (cur_delta.exited == true) {
+      stream << " [exited]";
+    }
+    stream << std::endl;
+    for (const RangeDelta &cur_range_delta : cur_delta.range_deltas) {
+      printVPageRange(cmd_opts, stream, cur_range_delta.vp_range);
+      stream << std::setfill(' ') << std::left
+             << std::setw(out_width_page_indent) << " ";
+      stream << std::dec;
+      if (cur_range_delta.status == RangeDelta::Status::Added) {
+        stream << "[range added] resident:" << cur_range_delta.new_resident;
+      } else if (cur_range_delta.status == RangeDelta::Status::Removed) {
+        stream << "[range removed] resident:" << cur_range_delta.old_resident;
       } else {
-        if (cur_vpr.getMappedFilePath().empty() == false) {
-          stream << std::setfill(' ') << std::left << std::setw(out_width_range_filesep) << " ";
-          stream << cur_vpr.getMappedFilePath();
+        stream << "[resident changed] " << cur_range_delta.old_resident
+               << " -> " << cur_range_delta.new_resident;
+      }
+      stream << std::endl;
+    }
+  }
+  stream.flush();
+
+  // Restore format flags
+  stream.flags(original_fmt_flags);
+}
+
+/**
+ * \brief Prints the write sets determined by the soft-dirty bits.
+ * \param interval The number of seconds between clearing the soft-dirty
+ * bits and rescanning the processes.
+ *
+ * For each process the size of its write set and its write rate are printed
+ * followed by all ranges that contain written pages. Unless only ranges are
+ * requested each written page is listed.
+ */
+void printWriteSets(const CmdOptions &cmd_opts, std::ostream &stream,
+    const std::vector<ProcessWriteSet> &write_sets, const PMemory &pmem,
+    double interval) {
+  // Store the format flags
+  std::ios_base::fmtflags original_fmt_flags = stream.flags();
+
+  printPageRangeHeadline(cmd_opts, stream);
+  if (cmd_opts.cmd_only_vpranges == false) {
+    printMappingHeadline(cmd_opts, stream);
+  }
+  for (const ProcessWriteSet &cur_write_set : write_sets) {
+    stream << "Process: " << cur_write_set.process_id << " [written pages:"
+           << std::dec << cur_write_set.written_pages << " bytes:"
+           << cur_write_set.written_bytes << " rate:" << std::fixed
+           << std::setprecision(0) << (cur_write_set.written_bytes / interval)
+           << "B/s]" << std::endl;
+    for (const RangeWriteSet &cur_range_set : cur_write_set.range_write_sets) {
+      const VPageRange &cur_vpr = *cur_range_set.vp_range;
+      printVPageRange(cmd_opts, stream, cur_vpr);
+      const uint64_t cur_written_bytes =
+          cur_range_set.written_pages * cur_vpr.getPageSize();
+      stream << std::setfill(' ') << std::left
+             << std::setw(out_width_page_indent) << " ";
+      stream << std::dec << "[written pages:" << cur_range_set.written_pages
+             << " of " << cur_range_set.resident_pages << " resident bytes:"
+             << cur_written_bytes << " rate:" << std::fixed
+             << std::setprecision(0) << (cur_written_bytes / interval)
+             << "B/s]" << std::endl;
+      if (cmd_opts.cmd_only_vpranges == true) {
+        continue;
+      }
+      for (const VPage &cur_vpage : cur_vpr.getVPages()) {
+        if ((cur_vpage.arePagePropertiesValid() == true)
+         && (cur_vpage.isSoftDirty() == true)) {
+          printVPage(cmd_opts, stream, cur_vpage, pmem);
         }
       }
+    }
+  }
+
+  // Restore format flags
+  stream.flags(original_fmt_flags);
+}
+
+/**
+ * \brief Prints the results of address translations.
+ *
+ * One line is printed per translation. It contains the process id, the
+ * requested virtual address and the properties of its page followed by the
+ * physical address, the frame properties and the frame's reference count.
+ * For swapped pages the swap location is printed instead.
+ */
+void printTranslations(const CmdOptions &cmd_opts, std::ostream &stream,
+    const std::vector<AddressTranslation> &translations, const PMemory &pmem) {
+  // Store the format flags
+  std::ios_base::fmtflags original_fmt_flags = stream.flags();
+
+  for (const AddressTranslation &cur_translation : translations) {
+    const VPage &cur_vpage = cur_translation.vpage;
+    stream << std::dec << cur_translation.process_id << " ";
+    stream << std::hex << std::uppercase << std::setfill('0') << std::right;
+    stream << "0x" << std::setw(out_width_page_startaddr)
+           << cur_translation.virt_address;
+    if (cur_translation.status == AddressTranslation::Status::NoProcess) {
+      stream << " [no process]" << std::endl;
+      continue;
+    } else if (cur_translation.status == AddressTranslation::Status::ReadError) {
+      stream << " [read error]" << std::endl;
+      continue;
+    }
+    stream << " ";
+    printVPageProperties(stream, cur_vpage);
+    stream << " -> ";
+    if (cur_vpage.isPresentRAM() == true) {
+      const PMemory::PF_Map_Ty::const_iterator cur_pframe_iter =
+          pmem.getPFrameMap().find(cur_vpage.getFrameNumber());
+      if ((cur_pframe_iter == pmem.getPFrameMap().end())
+       || (cur_pframe_iter->second.areFramePropertiesValid() == false)) {
+        stream << "frameno:0x" << std::left << cur_vpage.getFrameNumber()
+               << std::endl;
+        continue;
+      }
+      const PFrame &cur_pframe = cur_pframe_iter->second;
+      stream << "0x" << std::setw(out_width_frame_startaddr)
+             << cur_translation.getPhysAddress(cur_pframe.getStartAddress());
+      stream << " ";
+      printPFrameProperties(stream, cur_pframe);
+      stream << " ";
+      stream << std::dec << std::setfill('0') << std::right;
+      stream << std::setw(out_width_frame_refcnt) << cur_pframe.getFrameRefCount();
+    } else if (cur_vpage.isPresentSwap() == true) {
+      stream << "swap:" << std::dec
+             << static_cast<unsigned>(cur_vpage.getSwapType());
+      stream << std::hex << "@0x" << std::left << cur_vpage.getSwapOffset();
+    } else {
+      stream << "[null]";
+    }
+    stream << std::endl;
+  }
+
+  // Restore format flags
+  stream.flags(original_fmt_flags);
+}
+
+/**
+ * \brief Prints an estimated fraction in percent followed by its confidence
+ * \brief interval.
+ *
+ * If no page could be sampled for the estimate (e.g. because the frame flags
+ * are not readable) the estimate is printed as unknown.
+ */
+static void printProportionEstimate(std::ostream &stream, const char *name,
+    const ProportionEstimate &estimate) {
+  if ((estimate.sampled == 0) && (estimate.population > 0)) {
+    stream << " " << name << ":unknown";
+    return;
+  }
+  double lower = 0.0, upper = 0.0;
+  estimate.getInterval(lower, upper);
+  stream << " " << name << ":" << std::fixed << std::setprecision(1)
+         << (estimate.getFraction() * 100.0) << "% ["
+         << (lower * 100.0) << "%," << (upper * 100.0) << "%]";
+}
+
+/**
+ * \brief Prints the estimated number of pages of a process having some
+ * \brief property followed by the bounds of its confidence interval.
+ *
+ * The estimate and the bounds are the sums of the estimates and bounds of
+ * the process' ranges, so the interval is conservative. If no page of any
+ * range could be sampled for the estimate it is printed as unknown.
+ */
+static void printPageCountEstimate(std::ostream &stream, const char *name,
+    const ProcessSample &proc_sample,
+    ProportionEstimate RangeSample::*estimate_member) {
+  double estimate = 0.0, lower = 0.0, upper = 0.0;
+  uint64_t sampled = 0;
+  for (const RangeSample &cur_range_sample : proc_sample.range_samples) {
+    const ProportionEstimate &cur_estimate = cur_range_sample.*estimate_member;
+    sampled += cur_estimate.sampled;
+  }
+  if ((sampled == 0) && (proc_sample.total_pages > 0)) {
+    stream << " " << name << ":unknown";
+    return;
+  }
+  for (const RangeSample &cur_range_sample : proc_sample.range_samples) {
+    const ProportionEstimate &cur_estimate = cur_range_sample.*estimate_member;
+    double cur_lower = 0.0, cur_upper = 0.0;
+    cur_estimate.getInterval(cur_lower, cur_upper);
+    estimate += cur_estimate.getFraction() * cur_estimate.population;
+    lower += cur_lower * cur_estimate.population;
+    upper += cur_upper * cur_estimate.population;
+  }
+  stream << " " << name << ":" << std::fixed << std::setprecision(0)
+         << estimate << " [" << lower << "," << upper << "]";
+}
+
+/**
+ * \brief Prints the page statistics estimated from samples.
+ *
+ * For each process the estimated number of resident, swapped, dirty and THP
+ * pages is printed followed by each mapped range and the estimated fractions
+ * of its pages with the 95% confidence intervals.
+ */
+void printSamples(const CmdOptions &cmd_opts, std::ostream &stream,
+    const std::vector<ProcessSample> &samples) {
+  // Store the format flags
+  std::ios_base::fmtflags original_fmt_flags = stream.flags();
+
+  printPageRangeHeadline(cmd_opts, stream);
+  for (const ProcessSample &cur_sample : samples) {
+    stream << "Process: " << cur_sample.process_id << " [sampled pages:"
+           << std::dec << cur_sample.sampled_pages << " of "
+           << cur_sample.total_pages << "]";
+    printPageCountEstimate(stream, "resident", cur_sample, &RangeSample::resident);
+    printPageCountEstimate(stream, "swapped", cur_sample, &RangeSample::swapped);
+    printPageCountEstimate(stream, "dirty", cur_sample, &RangeSample::dirty);
+    printPageCountEstimate(stream, "thp", cur_sample, &RangeSample::thp);
+    stream << std::endl;
+    for (const RangeSample &cur_range_sample : cur_sample.range_samples) {
+      printVPageRange(cmd_opts, stream, *cur_range_sample.vp_range);
+      stream << std::setfill(' ') << std::left
+             << std::setw(out_width_page_indent) << " ";
+      stream << std::dec << "[sampled " << cur_range_sample.sampled_pages
+             << " of " << cur_range_sample.vp_range->num() << "]";
+      printProportionEstimate(stream, "resident", cur_range_sample.resident);
+      printProportionEstimate(stream, "swapped", cur_range_sample.swapped);
+      printProportionEstimate(stream, "dirty", cur_range_sample.dirty);
+      printProportionEstimate(stream, "thp", cur_range_sample.thp);
       stream << std::endl;
+    }
+  }
 
-      // Now print the mapping for each page
-      if (cmd_opts.cmd_only_vpranges == false) {
-        if ((cur_vpr.getMappingType() == VPageRange::MappingType::Anonymous)
-         || (cur_vpr.getMappingType() == VPageRange::MappingType::Filemapping)
-         || (cur_vpr.getMappingType() == VPageRange::MappingType::Mixed)) {
-          unsigned no_omitted_pages = 0;
-          for (const VPage &cur_vpage : cur_vpr.getVPages()) {
-            if (cur_vpage.arePagePropertiesValid() == false) {
-              ++no_omitted_pages;
-              continue;
-            }
-            const bool isPageUsed = cur_vpage.arePagePropertiesValid()
-                                  && (cur_vpage.isPresentRAM()
-                                   || cur_vpage.isPresentSwap()
-                                   || (cur_vpage.getFrameNumber() != 0));
-            if (cmd_opts.cmd_show_all_pages == false) {
-              if (isPageUsed == false) {
-                // Skip the current page as it is not used
-                ++no_omitted_pages;
-                continue;
-              }
-              // Test if any pages were skipped
-              if (no_omitted_pages > 0) {
-                // Print the indention for each page
-                stream << std::setfill(' ') << std::left
-                       << std::setw(out_width_page_indent) << " ";
-                // Now the note that pages were skipped
-                stream << "[" << std::dec << no_omitted_pages
-                       << " page" << ((no_omitted_pages != 1)?"s":"")
-                       << " omitted]" << std::endl;
-                no_omitted_pages = 0;
-              }
-            }
-            // Now print the page details
-            // First some indention
-            stream << std::setfill(' ') << std::left
-                   << std::setw(out_width_page_indent) << " ";
-            // First entry is the start address
-            stream << std::hex << std::uppercase << std::setfill('0') << std::right;
-            stream << "0x" << std::setw(out_width_page_startaddr) << cur_vpage.getStartAddress();
-            // Now some page propertiers
-            stream << " ";
-            stream << getBoolChar(cur_vpage.isPresentRAM(), 'p');
-            stream << getBoolChar(cur_vpage.isPresentSwap(), 's');
-            stream << getBoolChar(cur_vpage.isFileMapped(), 'f');
-            stream << getBoolChar(cur_vpage.isExclusive(), 'e');
-            stream << getBoolChar(cur_vpage.isSoftDirty(), 'd');
-            // Now the location the page is mapped to
-            stream << " -> ";
-            if (cur_vpage.isPresentRAM() == true) {
-              // The current page is present in RAM
-              const PMemory::PF_Map_Ty::const_iterator cur_pframe_iter =
-                  pmem.getPFrameMap().find(cur_vpage.getFrameNumber());
-              if (cur_pframe_iter == pmem.getPFrameMap().end()) {
-                stream << "[null]" << std::endl;
-                continue;
-              }
-              // Next fetch the corresponding frame
-              const PFrame &cur_pframe = cur_pframe_iter->second;
-              if (cur_pframe.areFramePropertiesValid() == false) {
-                stream << "frameno:0x";
-                stream << std::hex << std::uppercase << std::setfill('0') << std::left;
-                stream << cur_vpage.getFrameNumber();
-                continue;
-              }
-              // Now print the start address of the frame
-              stream << std::hex << std::uppercase << std::setfill('0') << std::right;
-              stream << "0x" << std::setw(out_width_frame_startaddr) << cur_pframe.getStartAddress();
-              // Now print the frame properties
-              stream << " ";
-              stream << getBoolChar(cur_pframe.isLocked(), 'l');
-              stream << getBoolChar(cur_pframe.hasError(), 'e');
-              stream << getBoolChar(cur_pframe.isReferenced(), 'r');
-              stream << getBoolChar(cur_pframe.isUpToDate(), 'u');
-              stream << getBoolChar(cur_pframe.isDirty(), 'd');
-              stream << getBoolChar(cur_pframe.isInLRU(), 'l');
-              stream << getBoolChar(cur_pframe.isInActiveLRU(), 'a');
-              stream << getBoolChar(cur_pframe.bySLAB(), 's');
-
-              stream << getBoolChar(cur_pframe.isWriteback(), 'w');
-              stream << getBoolChar(cur_pframe.isReclaim(), 'r');
-              stream << getBoolChar(cur_pframe.byBuddy(), 'b');
-              stream << getBoolChar(cur_pframe.isMemMapped(), 'm');
-              stream << getBoolChar(cur_pframe.isAnonMapped(), 'a');
-              stream << getBoolChar(cur_pframe.hasSwapCache(), 's');
-              stream << getBoolChar(cur_pframe.isSwapBacked(), 's');
-              stream << getBoolChar(cur_pframe.isCompdHead(), 'c');
-
-              stream << getBoolChar(cur_pframe.isCompdTail(), 'c');
-              stream << getBoolChar(cur_pframe.isHuge(), 'h');
-              stream << getBoolChar(cur_pframe.isUnevictable(), 'u');
-              stream << getBoolChar(cur_pframe.isHWPoison(), 'p');
-              stream << getBoolChar(cur_pframe.isNoFrame(), 'n');
-              stream << getBoolChar(cur_pframe.isKSM(), 'k');
-              stream << getBoolChar(cur_pframe.isTHP(), 't');
-              stream << getBoolChar(cur_pframe.isBalloon(), 'b');
-
-              stream << getBoolChar(cur_pframe.isZeroFrame(), 'z');
-              stream << getBoolChar(cur_pframe.isIdle(), 'i');
-
-              // Now print the refcounter
-              stream << " ";
-              stream << std::dec << std::setfill('0') << std::right;
-              stream << std::setw(out_width_frame_refcnt) << cur_pframe.getFrameRefCount();
-            } else if (cur_vpage.isPresentSwap() == true) {
-              // The current page is swapped
-              stream << "swap:";
-              stream << std::dec << std::setfill('0') << std::left;
-              stream << cur_vpage.getSwapType();
-              stream << std::hex << std::uppercase << std::setfill('0') << std::left;
-              stream << "@0x" << cur_vpage.getSwapOffset();
-            } else if (cur_vpage.getFrameNumber() != 0) {
-              // Page has frame number not 0
-              stream << "frameno:0x";
-              stream << std::hex << std::uppercase << std::setfill('0') << std::left;
-              stream << cur_vpage.getFrameNumber();
-            } else {
-              // Page seems not to be mapped
-              stream << "[null]";
-            }
-            stream << std::endl;
-          } // End of page loop
-          // Test if any pages were skipped at the end of the range
-          if (no_omitted_pages > 0) {
-            if ((cur_vpr.num() > 0) && (no_omitted_pages == cur_vpr.num())) {
-              stream << std::setfill(' ') << std::left
-                     << std::setw(out_width_page_indent) << " ";
-              stream << "[all pages omitted]" << std::endl;
-            } else {
-              stream << std::setfill(' ') << std::left
-                     << std::setw(out_width_page_indent) << " ";
-              stream << "[" << std::dec << no_omitted_pages
-                     << " page" << ((no_omitted_pages != 1)?"s":"")
-                     << " omitted]" << std::endl;
-              no_omitted_pages = 0;
-            }
+  // Restore format flags
+  stream.flags(original_fmt_flags);
+}
+
+/**
+ * \brief Prints the memory used by each mapped file.
+ *
+ * One line is printed per file, the file with the most resident bytes first,
+ * followed by a line with the totals over all files. Frames are counted once
+ * per file no matter how often they are mapped. Resident pages whose frame
+ * number is hidden are counted once per mapping and listed as unresolved.
+ */
+void printFileUsage(const CmdOptions &cmd_opts, std::ostream &stream,
+    const std::vector<FileUsage> &usages) {
+  // Store the format flags
+  std::ios_base::fmtflags original_fmt_flags = stream.flags();
+
+  const PathTable &path_table = PathTable::getShared();
+  uint64_t total_resident_bytes = 0;
+  uint64_t total_shared_bytes = 0;
+  stream << std::dec;
+  for (const FileUsage &cur_usage : usages) {
+    const uint64_t cur_resident_bytes =
+        (cur_usage.resident_frames + cur_usage.unresolved_pages) * cur_usage.page_size;
+    const uint64_t cur_shared_bytes = cur_usage.shared_frames * cur_usage.page_size;
+    stream << "File: " << path_table.getPath(cur_usage.path_id)
+           << " [processes:" << cur_usage.num_processes
+           << " ranges:" << cur_usage.num_ranges
+           << " mapped bytes:" << (cur_usage.mapped_pages * cur_usage.page_size)
+           << " resident bytes:" << cur_resident_bytes
+           << " shared bytes:" << cur_shared_bytes
+           << " dirty pages:" << cur_usage.dirty_frames
+           << " writeback pages:" << cur_usage.writeback_frames
+           << " copied pages:" << cur_usage.copied_frames;
+    if (cur_usage.unresolved_pages > 0) {
+      stream << " unresolved pages:" << cur_usage.unresolved_pages;
+    }
+    stream << "]" << std::endl;
+    total_resident_bytes += cur_resident_bytes;
+    total_shared_bytes += cur_shared_bytes;
+  }
+  stream << "Total: [files:" << usages.size()
+         << " resident bytes:" << total_resident_bytes
+         << " shared bytes:" << total_shared_bytes << "]" << std::endl;
+
+  // Restore format flags
+  stream.flags(original_fmt_flags);
+}
+
+/**
+ * \brief Prints the results of the content analysis.
+ *
+ * Only ranges with scanned or unreadable pages are printed. The line below
+ * each range contains the number of zero and duplicate pages and the bytes
+ * that could be reclaimed by replacing or merging them, followed by the zero
+ * pages whose frame is unknown if there are any.
+ */
+void printContent(const CmdOptions &cmd_opts, std::ostream &stream,
+    const std::vector<ProcessContent> &contents) {
+  // Store the format flags
+  std::ios_base::fmtflags original_fmt_flags = stream.flags();
+
+  uint64_t total_scanned_pages = 0;
+  uint64_t total_reclaimable_bytes = 0;
+  printPageRangeHeadline(cmd_opts, stream);
+  for (const ProcessContent &cur_content : contents) {
+    const uint64_t cur_scanned_pages = cur_content.getPages(&RangeContent::scanned_pages);
+    const uint64_t cur_reclaimable_bytes = cur_content.getReclaimableBytes();
+    stream << "Process: " << cur_content.process_id << std::dec
+           << " [scanned pages:" << cur_scanned_pages
+           << " zero pages:" << cur_content.getPages(&RangeContent::zero_pages)
+           << " duplicate pages:" << cur_content.getPages(&RangeContent::duplicate_pages)
+           << " cross-process:" << cur_content.getPages(&RangeContent::cross_duplicate_pages)
+           << " reclaimable bytes:" << cur_reclaimable_bytes;
+    const uint64_t cur_unresolved_pages =
+        cur_content.getPages(&RangeContent::unresolved_zero_pages);
+    if (cur_unresolved_pages > 0) {
+      stream << " unresolved zero pages:" << cur_unresolved_pages;
+    }
+    stream << "]" << std::endl;
+    total_scanned_pages += cur_scanned_pages;
+    total_reclaimable_bytes += cur_reclaimable_bytes;
+    for (const RangeContent &cur_range_content : cur_content.range_contents) {
+      if ((cur_range_content.scanned_pages == 0)
+       && (cur_range_content.unreadable_pages == 0)) {
+        continue;
+      }
+      printVPageRange(cmd_opts, stream, *cur_range_content.vp_range);
+      stream << std::setfill(' ') << std::left
+             << std::setw(out_width_page_indent) << " ";
+      stream << std::dec << "[scanned pages:" << cur_range_content.scanned_pages
+             << " zero pages:" << cur_range_content.zero_pages
+             << " duplicate pages:" << cur_range_content.duplicate_pages
+             << " cross-process:" << cur_range_content.cross_duplicate_pages
+             << " reclaimable bytes:" << cur_range_content.getReclaimableBytes();
+      if (cur_range_content.unresolved_zero_pages > 0) {
+        stream << " unresolved zero pages:"
+               << cur_range_content.unresolved_zero_pages;
+      }
+      if (cur_range_content.unreadable_pages > 0) {
+        stream << " unreadable pages:" << cur_range_content.unreadable_pages;
+      }
+      stream << "]" << std::endl;
+    }
+  }
+  stream << "Total: [processes:" << std::dec << contents.size()
+         << " scanned pages:" << total_scanned_pages
+         << " reclaimable bytes:" << total_reclaimable_bytes << "]" << std::endl;
+
+  // Restore format flags
+  stream.flags(original_fmt_flags);
+}
+
+/**
+ * \brief Prints the swap layout of the processes.
+ *
+ * Only ranges with swapped pages are printed. The line below each range
+ * contains the runs of adjacent swap slots, the mean distance between the
+ * runs and the slots read by the swap readahead to fault all pages back in.
+ * Afterwards one line is printed for each swap device that is used.
+ */
+void printSwapLayout(const CmdOptions &cmd_opts, std::ostream &stream,
+    const SwapLayout &layout) {
+  // Store the format flags
+  std::ios_base::fmtflags original_fmt_flags = stream.flags();
+
+  uint64_t total_swapped_pages = 0;
+  uint64_t total_read_pages = 0;
+  printPageRangeHeadline(cmd_opts, stream);
+  for (const ProcessSwap &cur_proc_swap : layout.process_swaps) {
+    const uint64_t cur_swapped_pages = cur_proc_swap.getCount(&RangeSwap::swapped_pages);
+    const uint64_t cur_unresolved_pages = cur_proc_swap.getCount(&RangeSwap::unresolved_pages);
+    const uint64_t cur_read_pages = cur_proc_swap.getReadPages();
+    stream << "Process: " << cur_proc_swap.process_id << std::dec
+           << " [swapped pages:" << cur_swapped_pages
+           << " runs:" << cur_proc_swap.getCount(&RangeSwap::num_runs)
+           << " reads:" << cur_proc_swap.getCount(&RangeSwap::num_reads)
+           << " read pages:" << cur_read_pages;
+    if (cur_unresolved_pages > 0) {
+      stream << " unresolved pages:" << cur_unresolved_pages;
+    }
+    stream << "]" << std::endl;
+    total_swapped_pages += cur_swapped_pages;
+    total_read_pages += cur_read_pages;
+    for (const RangeSwap &cur_range_swap : cur_proc_swap.range_swaps) {
+      printVPageRange(cmd_opts, stream, *cur_range_swap.vp_range);
+      stream << std::setfill(' ') << std::left
+             << std::setw(out_width_page_indent) << " ";
+      stream << std::dec << "[swapped pages:" << cur_range_swap.swapped_pages
+             << " runs:" << cur_range_swap.num_runs
+             << std::fixed << std::setprecision(1)
+             << " mean run:" << cur_range_swap.getMeanRunLength()
+             << " mean seek:" << cur_range_swap.getMeanSeekDistance()
+             << " reads:" << cur_range_swap.num_reads
+             << std::setprecision(2)
+             << " read amplification:" << cur_range_swap.getReadAmplification();
+      if (cur_range_swap.unresolved_pages > 0) {
+        stream << " unresolved pages:" << cur_range_swap.unresolved_pages;
+      }
+      stream << "]" << std::endl;
+    }
+  }
+  for (const SwapDevice &cur_device : layout.swap_devices) {
+    stream << "Swap: " << std::dec << cur_device.swap_type;
+    if (cur_device.device_path.empty() == false) {
+      stream << " " << cur_device.device_path;
+    }
+    stream << " [processes:" << cur_device.num_processes
+           << " used slots:" << cur_device.used_slots
+           << std::hex << " first slot:0x" << cur_device.first_slot
+           << " last slot:0x" << cur_device.last_slot
+           << std::dec << " clusters:" << cur_device.num_clusters << "]" << std::endl;
+  }
+  stream << "Total: [processes:" << std::dec << layout.process_swaps.size()
+         << " swapped pages:" << total_swapped_pages
+         << " read pages:" << total_read_pages
+         << " page-cluster:" << layout.page_cluster << "]" << std::endl;
+
+  // Restore format flags
+  stream.flags(original_fmt_flags);
+}
+
+/**
+ * \brief Prints the pages mapping the frames found by a reverse lookup.
+ *
+ * For each mapped frame its physical address, flags and reference count are
+ * printed followed by one line per page mapping it. That line contains the
+ * virtual address and flags of the page, the process id and the range the
+ * page belongs to.
+ */
+void printFrameMappings(const CmdOptions &cmd_opts, std::ostream &stream,
+    const std::vector<Process> &processes, const ReverseLookup &lookup,
+    const PMemory &pmem) {
+  // Store the format flags
+  std::ios_base::fmtflags original_fmt_flags = stream.flags();
+
+  const std::vector<FrameMapping> &mappings = lookup.frame_mappings;
+  for (size_t i = 0, e = mappings.size(); i < e; ) {
+    const uint64_t cur_frame_no = mappings[i].frame_no;
+    size_t j = i + 1;
+    size_t num_processes = 1;
+    for (; (j < e) && (mappings[j].frame_no == cur_frame_no); ++j) {
+      if (mappings[j].process_no != mappings[j - 1].process_no) {
+        ++num_processes;
+      }
+    }
+    stream << "Frame: ";
+    const PMemory::PF_Map_Ty::const_iterator cur_pframe_iter =
+        pmem.getPFrameMap().find(cur_frame_no);
+    if ((cur_pframe_iter == pmem.getPFrameMap().end())
+     || (cur_pframe_iter->second.areFramePropertiesValid() == false)) {
+      stream << "frameno:0x" << std::hex << std::uppercase << cur_frame_no;
+    } else {
+      const PFrame &cur_pframe = cur_pframe_iter->second;
+      stream << std::hex << std::uppercase << std::setfill('0') << std::right;
+      stream << "0x" << std::setw(out_width_frame_startaddr)
+             << cur_pframe.getStartAddress();
+      stream << " ";
+      printPFrameProperties(stream, cur_pframe);
+      stream << " ";
+      stream << std::dec << std::setfill('0') << std::right;
+      stream << std::setw(out_width_frame_refcnt) << cur_pframe.getFrameRefCount();
+    }
+    stream << std::dec << " [mappings:" << (j - i)
+           << " processes:" << num_processes << "]" << std::endl;
+    for (; i < j; ++i) {
+      const FrameMapping &cur_mapping = mappings[i];
+      stream << std::setfill(' ') << std::left
+             << std::setw(out_width_page_indent) << " ";
+      stream << std::hex << std::uppercase << std::setfill('0') << std::right;
+      stream << "0x" << std::setw(out_width_page_startaddr)
+             << cur_mapping.vpage.getStartAddress();
+      stream << " ";
+      printVPageProperties(stream, cur_mapping.vpage);
+      stream << std::dec << " [process:"
+             << processes[cur_mapping.process_no].getPID()
+             << " range:" << cur_mapping.vp_range->getVPRangeNumber();
+      if (cur_mapping.vp_range->getMappedFilePath().empty() == false) {
+        stream << " " << cur_mapping.vp_range->getMappedFilePath();
+      }
+      stream << "]" << std::endl;
+    }
+  }
+  stream << "Total: [frames:" << std::dec << lookup.getNumFrames()
+         << " mappings:" << mappings.size()
+         << " processes:" << lookup.getNumProcesses() << "]" << std::endl;
+
+  // Restore format flags
+  stream.flags(original_fmt_flags);
+}
+
+/**
+ * \brief Prints the physical contiguity of the resident pages.
+ *
+ * Only ranges with resident pages are printed. The line below each range
+ * contains the number of runs of contiguous frames, their mean and largest
+ * length and the number of runs of each order that occurs.
+ */
+void printContiguity(const CmdOptions &cmd_opts, std::ostream &stream,
+    const std::vector<ProcessContiguity> &contiguities) {
+  // Store the format flags
+  std::ios_base::fmtflags original_fmt_flags = stream.flags();
+
+  uint64_t total_resident_pages = 0;
+  uint64_t total_runs = 0;
+  printPageRangeHeadline(cmd_opts, stream);
+  for (const ProcessContiguity &cur_contiguity : contiguities) {
+    const uint64_t cur_resident_pages =
+        cur_contiguity.getCount(&RangeContiguity::resident_pages);
+    const uint64_t cur_unresolved_pages =
+        cur_contiguity.getCount(&RangeContiguity::unresolved_pages);
+    const uint64_t cur_runs = cur_contiguity.getCount(&RangeContiguity::num_runs);
+    stream << "Process: " << cur_contiguity.process_id << std::dec
+           << " [resident pages:" << cur_resident_pages
+           << " runs:" << cur_runs
+           << " largest run:" << cur_contiguity.getLargestRun();
+    if (cur_unresolved_pages > 0) {
+      stream << " unresolved pages:" << cur_unresolved_pages;
+    }
+    stream << "]" << std::endl;
+    total_resident_pages += cur_resident_pages;
+    total_runs += cur_runs;
+    for (const RangeContiguity &cur_range_contiguity : cur_contiguity.range_contiguities) {
+      printVPageRange(cmd_opts, stream, *cur_range_contiguity.vp_range);
+      stream << std::setfill(' ') << std::left
+             << std::setw(out_width_page_indent) << " ";
+      stream << std::dec << "[resident pages:" << cur_range_contiguity.resident_pages
+             << " runs:" << cur_range_contiguity.num_runs
+             << std::fixed << std::setprecision(1)
+             << " mean run:" << cur_range_contiguity.getMeanRunLength()
+             << " largest run:" << cur_range_contiguity.largest_run;
+      if (cur_range_contiguity.num_runs > 0) {
+        stream << " orders:";
+        for (unsigned i = 0; i < RangeContiguity::num_orders; ++i) {
+          if (cur_range_contiguity.run_orders[i] > 0) {
+            stream << " " << i << ":" << cur_range_contiguity.run_orders[i];
           }
         }
-      } else {
-        if (cmd_opts.cmd_prog_mode == CmdOptions::ProgMode::Pages) {
-          stream << "Omit option \"-r\" to show mappings for each page." << std::endl;
-        }
       }
-    } // End of pagerange loop
-  } // End of process loop
+      if (cur_range_contiguity.unresolved_pages > 0) {
+        stream << " unresolved pages:" << cur_range_contiguity.unresolved_pages;
+      }
+      stream << "]" << std::endl;
+    }
+  }
+  stream << "Total: [processes:" << std::dec << contiguities.size()
+         << " resident pages:" << total_resident_pages
+         << " runs:" << total_runs << "]" << std::endl;
+
+  // Restore format flags
+  stream.flags(original_fmt_flags);
+}
+
+/**
+ * \brief Prints the free blocks of the buddy allocator in each zone.
+ *
+ * One line is printed per zone. It contains the first frame and the number
+ * of frames of the zone, its free pages, the number of huge pages that could
+ * be allocated from the free blocks, the unusable free space index of the
+ * huge page order and the number of free blocks of each order.
+ */
+void printFragmentation(const CmdOptions &cmd_opts, std::ostream &stream,
+    const std::vector<ZoneFragmentation> &zones) {
+  // Store the format flags
+  std::ios_base::fmtflags original_fmt_flags = stream.flags();
+
+  const unsigned huge_order = getHugePageOrder();
+  uint64_t total_free_pages = 0;
+  uint64_t total_huge_pages = 0;
+  for (const ZoneFragmentation &cur_zone : zones) {
+    const uint64_t cur_huge_pages = cur_zone.getFreePages(huge_order) >> huge_order;
+    stream << "Zone: ";
+    if (cur_zone.node_no >= 0) {
+      stream << std::dec << cur_zone.node_no << " ";
+    }
+    stream << cur_zone.zone_name
+           << std::hex << std::uppercase << " [first frame:0x" << cur_zone.first_frame
+           << std::dec << " frames:" << cur_zone.num_frames
+           << " free pages:" << cur_zone.free_pages
+           << " huge pages:" << cur_huge_pages
+           << std::fixed << std::setprecision(3)
+           << " unusable index:" << cur_zone.getUnusableIndex(huge_order)
+           << " free blocks:";
+    for (unsigned i = 0; i < ZoneFragmentation::num_orders; ++i) {
+      stream << " " << i << ":" << cur_zone.free_blocks[i];
+    }
+    stream << "]" << std::endl;
+    total_free_pages += cur_zone.free_pages;
+    total_huge_pages += cur_huge_pages;
+  }
+  stream << "Total: [zones:" << std::dec << zones.size()
+         << " free pages:" << total_free_pages
+         << " huge pages:" << total_huge_pages
+         << " huge page order:" << huge_order << "]" << std::endl;
 
   // Restore format flags
   stream.flags(original_fmt_flags);
 }
+
+/**
+ * \brief Prints the results of a scan in the way of the mode it was run in.
+ *
+ * Nothing is printed for a captured snapshot, the streaming modes print
+ * their results while scanning.
+ */
+void printScanResult(const CmdOptions &cmd_opts, std::ostream &stream,
+    const ScanResult &result) {
+  switch (result.mode) {
+    case ScanMode::Files:
+      printFileUsage(cmd_opts, stream, result.file_usages);
+      break;
+    case ScanMode::Swap:
+      printSwapLayout(cmd_opts, stream, result.swap_layout);
+      break;
+    case ScanMode::Contiguity:
+      printContiguity(cmd_opts, stream, result.contiguities);
+      break;
+    case ScanMode::FrameLookup:
+      printFrameMappings(cmd_opts, stream, result.processes,
+                         result.frame_lookup, result.pmem);
+      break;
+    case ScanMode::Content:
+      printContent(cmd_opts, stream, result.contents);
+      break;
+    case ScanMode::Sample:
+      printSamples(cmd_opts, stream, result.samples);
+      break;
+    case ScanMode::SoftDirty:
+      printWriteSets(cmd_opts, stream, result.write_sets, result.pmem,
+                     result.write_interval);
+      break;
+    case ScanMode::Fragmentation:
+      printFragmentation(cmd_opts, stream, result.zones);
+      break;
+    case ScanMode::Diff:
+      printSnapshotDiff(cmd_opts, stream, result.proc_diffs);
+      break;
+    case ScanMode::Pages:
+      printResults(cmd_opts, stream, result.processes, result.pmem);
+      break;
+    case ScanMode::Save:
+    case ScanMode::Translate:
+    case ScanMode::Watch:
+    case ScanMode::Budget:
+      break;
+  }
+}
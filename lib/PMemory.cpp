@@ -2,19 +2,41 @@
 //===----------------------------------------------------------------------===//
 
 #include "PMemory.h"
+#include "Diagnostics.h"
+#include "Stats.h"
 
 #include <climits>
 #include <fcntl.h>
 #include <iostream>
 #include <iterator>
+#include <map>
+#include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
+// The kpageflags and kpagecount files of each proc root. They are opened on
+// first use and shared by all PMemory objects.
+static std::mutex frame_files_mutex;
+static std::map<std::string, std::pair<int, int> > frame_files;
+
 PMemory::PMemory(void)
  : frame_size(0) {
   frame_size = sysconf(_SC_PAGESIZE);
 }
 
+/**
+ * \brief Creates a physical memory that takes its frames from \c frame_arena.
+ *
+ * The arena must outlive the object and must only be used by the thread
+ * adding the frames.
+ */
+PMemory::PMemory(Arena *frame_arena)
+ : p_frames(std::less<uint64_t>(), PF_Map_Ty::allocator_type(frame_arena)),
+   frame_size(0) {
+  frame_size = sysconf(_SC_PAGESIZE);
+}
+
 /**
  * \brief Tries to add a new frame object to memory.
  * \param frame_no The frame number of the new frame.
@@ -39,35 +61,29 @@ bool PMemory::addPFrame(uint64_t frame_no, const int flags_fd,
     return false;
   }
 
-  // Now compute the proper seek position within the kpageflags file
+  // Now compute the proper position within the kpageflags file. The files
+  // are shared so they are read without moving their file offset.
   const off_t ff_offset = frame_no * (64 / CHAR_BIT);
-  if (lseek(flags_fd, ff_offset, SEEK_SET) == -1) {
-    std::cerr << "Failed to position in frameflags file." << std::endl;
-    perror("lseek(refcnt):");
-    return false;
-  }
-  if (lseek(refcount_fd, ff_offset, SEEK_SET) == -1) {
-    std::cerr << "Failed to position in frame refcount file." << std::endl;
-    perror("lseek(flags):");
-    return false;
-  }
+  ScanStats::count(ScanStats::Counter::Syscalls, 2);
   // Now read the frame flags
   uint64_t frame_flags = 0; ssize_t read_flags_bytes = 0;
   uint64_t frame_refcnt = 0; ssize_t read_refcnt_bytes = 0;
-  read_flags_bytes = read(flags_fd, &frame_flags, sizeof(frame_flags));
+  read_flags_bytes = pread(flags_fd, &frame_flags, sizeof(frame_flags), ff_offset);
   if (read_flags_bytes == -1) {
-    std::cerr << "Could not properly read from frameflags file!" << std::endl;
-    perror("read(flags):");
+    errs() << "Could not properly read from frameflags file!" << std::endl;
+    printSystemError("read(flags):");
     return false;
   }
-  read_refcnt_bytes = read(refcount_fd, &frame_refcnt, sizeof(frame_refcnt));
+  read_refcnt_bytes = pread(refcount_fd, &frame_refcnt, sizeof(frame_refcnt), ff_offset);
   if (read_refcnt_bytes == -1) {
-    std::cerr << "Could not properly read from frame refcount file!" << std::endl;
-    perror("read(refcnt):");
+    errs() << "Could not properly read from frame refcount file!" << std::endl;
+    printSystemError("read(refcnt):");
     return false;
   }
+  ScanStats::count(ScanStats::Counter::BytesRead, read_flags_bytes + read_refcnt_bytes);
   // Now set properties of pframe
   if ((read_flags_bytes == sizeof(frame_flags)) && (read_refcnt_bytes == sizeof(frame_refcnt))) {
+    ScanStats::count(ScanStats::Counter::Frames);
     PFrame cur_frame(frame_no * frame_size);
     cur_frame.setRawFrameProperties(frame_flags, frame_refcnt, true);
     p_frames.insert(std::make_pair(frame_no, cur_frame));
@@ -83,49 +99,96 @@ bool PMemory::addPFrame(uint64_t frame_no, const int flags_fd,
  * \note This function is mainly intended for debugging purposes.
  *
  * Tries to add the add frame with the given number (not address) to the memory
- * and read its status flags from the /proc/kpageflags file. If a frame with
+ * and read its status flags from the kpageflags file in the proc root. If a frame with
  * the given number already exists the existing frame is not changed. The
  * function returns \c true if a new frame was created and added. If an error
  * occured or a frame with the given frame number already exists \c false is
  * returned.
  */
 bool PMemory::addPFrame(const CmdOptions &cmd_opts, uint64_t frame_no) {
-  const std::string frameflags_file("/proc/kpageflags");
-  const std::string framerefcnt_file("/proc/kpagecount");
+  int frameflags_file_fd = -1, framerefcnt_file_fd = -1;
+  if (openFrameFiles(cmd_opts, frameflags_file_fd, framerefcnt_file_fd) == false) {
+    return false;
+  }
+  return addPFrame(frame_no, frameflags_file_fd, framerefcnt_file_fd);
+}
+
+/**
+ * \brief Returns the descriptors of the kpageflags and kpagecount files.
+ *
+ * The files of the proc root given by \c cmd_opts are opened on the first
+ * call and stay open until \c closeFrameFiles() is called. So repeated scans
+ * do not have to open them again. Returns \c false if any of the files
+ * cannot be opened.
+ */
+bool PMemory::openFrameFiles(const CmdOptions &cmd_opts, int &flags_fd,
+    int &refcount_fd) {
+  std::lock_guard<std::mutex> lock(frame_files_mutex);
+  std::map<std::string, std::pair<int, int> >::const_iterator files_it =
+      frame_files.find(cmd_opts.cmd_proc_root);
+  if (files_it != frame_files.end()) {
+    flags_fd = files_it->second.first;
+    refcount_fd = files_it->second.second;
+    return true;
+  }
+
+  const std::string frameflags_file(cmd_opts.cmd_proc_root + "/kpageflags");
+  const std::string framerefcnt_file(cmd_opts.cmd_proc_root + "/kpagecount");
   // Store format flags of clog
-  std::ios_base::fmtflags original_clog_flags = std::clog.flags();
-  // Open the required files
-  const int frameflags_file_fd = open(frameflags_file.c_str(), O_RDONLY);
+  std::ios_base::fmtflags original_clog_flags = logs().flags();
+  const int frameflags_file_fd = open(frameflags_file.c_str(), O_RDONLY | O_CLOEXEC);
+  ScanStats::count(ScanStats::Counter::Syscalls);
   if (frameflags_file_fd == -1) {
-    std::cerr << "Could not open frameflags file " << frameflags_file << std::endl;
-    perror("open:");
+    errs() << "Could not open frameflags file " << frameflags_file << std::endl;
+    printSystemError("open:");
     return false;
   }
   if (cmd_opts.cmd_verbose == true) {
-    std::clog << "Opened frameflags file." << std::endl;
+    logs() << "Opened frameflags file." << std::endl;
   }
-  const int framerefcnt_file_fd = open(framerefcnt_file.c_str(), O_RDONLY);
+  const int framerefcnt_file_fd = open(framerefcnt_file.c_str(), O_RDONLY | O_CLOEXEC);
+  ScanStats::count(ScanStats::Counter::Syscalls);
   if (framerefcnt_file_fd == -1) {
-    std::cerr << "Could not open frame refcount file " << framerefcnt_file << std::endl;
+    errs() << "Could not open frame refcount file " << framerefcnt_file << std::endl;
+    printSystemError("open:");
+    close(frameflags_file_fd);
     return false;
   }
   if (cmd_opts.cmd_verbose == true) {
-    std::clog << "Opened frame refcount file." << std::endl;
+    logs() << "Opened frame refcount file." << std::endl;
   }
-  bool added_frame = false;
-  try {
-    added_frame = addPFrame(frame_no, frameflags_file_fd, framerefcnt_file_fd);
-  } catch(...) {
-    close(frameflags_file_fd);
-    close(framerefcnt_file_fd);
-    throw;
+  // Restore clog flags
+  logs().flags(original_clog_flags);
+
+  frame_files[cmd_opts.cmd_proc_root] =
+      std::make_pair(frameflags_file_fd, framerefcnt_file_fd);
+  flags_fd = frameflags_file_fd;
+  refcount_fd = framerefcnt_file_fd;
+  return true;
+}
+
+/**
+ * \brief Closes the kpageflags and kpagecount files of all proc roots.
+ */
+void PMemory::closeFrameFiles(void) {
+  std::lock_guard<std::mutex> lock(frame_files_mutex);
+  for (const std::pair<const std::string, std::pair<int, int> > &cur_files : frame_files) {
+    close(cur_files.second.first);
+    close(cur_files.second.second);
   }
-  close(frameflags_file_fd);
-  close(framerefcnt_file_fd);
+  frame_files.clear();
+}
 
-  // Restore clog flags
-  std::clog.flags(original_clog_flags);
-  return added_frame;
+/**
+ * \brief Inserts an already initialized frame object into the memory.
+ * \param frame_no The number (not address) of the frame.
+ * \param frame The frame object whose properties were read elsewhere.
+ *
+ * Returns \c true if the frame was inserted. If a frame with the given number
+ * already exists it remains unchanged and \c false is returned.
+ */
+bool PMemory::insertPFrame(uint64_t frame_no, const PFrame &frame) {
+  return p_frames.insert(std::make_pair(frame_no, frame)).second;
 }
 
 const PMemory::PF_Map_Ty& PMemory::getPFrameMap(void) const {
@@ -0,0 +1,86 @@
+//===- PathTable.cpp ------------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "PathTable.h"
+
+#include <utility>
+
+const unsigned PathTable::first_chunk_shift;
+const unsigned PathTable::num_chunks;
+
+PathTable::PathTable(void)
+ : num_paths(0) {
+  intern("");
+}
+
+/**
+ * \brief Determines the chunk and the position within it of the given id.
+ *
+ * Chunk k holds the ids from (2^k - 1) * 2^first_chunk_shift on.
+ */
+void PathTable::locateID(PathID id, unsigned &chunk, size_t &offset) {
+  const uint64_t index =
+      static_cast<uint64_t>(id) + (1ULL << first_chunk_shift);
+  const unsigned top_bit = 63 - __builtin_clzll(index);
+  chunk = top_bit - first_chunk_shift;
+  offset = index - (1ULL << top_bit);
+}
+
+/**
+ * \brief Returns the id of the given path and adds the path to the table if
+ * \brief it is not yet known.
+ */
+PathTable::PathID PathTable::intern(const std::string &path) {
+  std::lock_guard<std::mutex> lock(intern_mutex);
+  // Known paths are looked up without copying them
+  PathID_Map_Ty::const_iterator path_it = path_ids.find(&path);
+  if (path_it != path_ids.end()) {
+    return path_it->second;
+  }
+  const PathID new_id = num_paths.load(std::memory_order_relaxed);
+  paths.push_back(path);
+  path_ids.insert(std::make_pair(&paths.back(), new_id));
+  unsigned chunk = 0;
+  size_t offset = 0;
+  locateID(new_id, chunk, offset);
+  if (path_chunks[chunk] == nullptr) {
+    const size_t chunk_paths =
+        static_cast<size_t>(1) << (chunk + first_chunk_shift);
+    path_chunks[chunk].reset(new const std::string*[chunk_paths]);
+  }
+  path_chunks[chunk][offset] = &paths.back();
+  num_paths.store(new_id + 1, std::memory_order_release);
+  return new_id;
+}
+
+/**
+ * \brief Returns the path with the given id. Unknown ids yield the empty
+ * \brief path.
+ */
+const std::string& PathTable::getPath(PathID id) const {
+  if (id >= num_paths.load(std::memory_order_acquire)) {
+    id = empty_path;
+  }
+  unsigned chunk = 0;
+  size_t offset = 0;
+  locateID(id, chunk, offset);
+  return *path_chunks[chunk][offset];
+}
+
+/**
+ * \brief Returns the number of distinct paths including the empty path.
+ */
+size_t PathTable::size(void) const {
+  return num_paths.load(std::memory_order_acquire);
+}
+
+/**
+ * \brief Returns the table shared by all page ranges.
+ *
+ * Like the scan arena the table is never destroyed so the paths remain valid
+ * until lsmmap exits.
+ */
+PathTable& PathTable::getShared(void) {
+  static PathTable *shared_table = new PathTable();
+  return *shared_table;
+}
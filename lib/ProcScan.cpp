@@ -0,0 +1,485 @@
+//===- ProcScan.cpp -------------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "ProcScan.h"
+#include "Diagnostics.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+// Flag in /proc/pid/stat marking kernel threads (see include/linux/sched.h)
+static const unsigned long proc_flag_kthread = 0x00200000;
+
+// Directory the cgroup v2 hierarchy is mounted at
+static const std::string cgroup_root("/sys/fs/cgroup");
+
+// Layout of the entries returned by getdents64 (see getdents(2))
+struct LinuxDirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[1];
+};
+
+/**
+ * \brief Returns the ids of all processes found in /proc.
+ *
+ * The directory is read with large getdents64 calls and only entries that
+ * are directories with a numeric name are returned. Kernel threads and
+ * processes not matching the \c selector are skipped before any process
+ * object is created. The returned ids are sorted numerically.
+ */
+CmdOptions::PID_List_Ty enumeratePIDs(const CmdOptions &cmd_opts,
+    const ProcessSelector &selector) {
+  CmdOptions::PID_List_Ty pids;
+  const int proc_fd = open(cmd_opts.cmd_proc_root.c_str(), O_RDONLY | O_DIRECTORY);
+  ScanStats::count(ScanStats::Counter::Syscalls);
+  if (proc_fd == -1) {
+    errs() << "Could not open " << cmd_opts.cmd_proc_root << std::endl;
+    printSystemError("open:");
+    return pids;
+  }
+  std::vector<char> buffer(1 << 16);
+  std::vector<unsigned long> numeric_pids;
+  while (true) {
+    const long read_bytes = syscall(SYS_getdents64, proc_fd, buffer.data(),
+                                    buffer.size());
+    ScanStats::count(ScanStats::Counter::Syscalls);
+    if (read_bytes == -1) {
+      errs() << "Could not read the entries of " << cmd_opts.cmd_proc_root << std::endl;
+      printSystemError("getdents64:");
+      break;
+    }
+    if (read_bytes == 0) {
+      break;
+    }
+    for (long offset = 0; offset < read_bytes; ) {
+      const LinuxDirent64 *cur_entry =
+          reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+      offset += cur_entry->d_reclen;
+      if ((cur_entry->d_type != DT_DIR) && (cur_entry->d_type != DT_UNKNOWN)) {
+        continue;
+      }
+      // Process directories are the only ones starting with a digit
+      if ((cur_entry->d_name[0] < '0') || (cur_entry->d_name[0] > '9')) {
+        continue;
+      }
+      unsigned long cur_pid = 0;
+      if (str2ulong(cur_entry->d_name, &cur_pid, 10) == true) {
+        numeric_pids.push_back(cur_pid);
+      }
+    }
+  }
+  ScanStats::count(ScanStats::Counter::Syscalls);
+  close(proc_fd);
+
+  std::sort(numeric_pids.begin(), numeric_pids.end());
+  pids.reserve(numeric_pids.size());
+  for (unsigned long cur_pid : numeric_pids) {
+    const std::string cur_pid_str(std::to_string(cur_pid));
+    ProcStat proc_stat;
+    if ((readProcStat(cmd_opts.cmd_proc_root, cur_pid_str, proc_stat) == false)
+     || (isKernelThread(proc_stat) == true)) {
+      continue;
+    }
+    if ((selector.empty() == false)
+     && (selector.matches(cur_pid_str, proc_stat) == false)) {
+      continue;
+    }
+    pids.push_back(cur_pid_str);
+  }
+  if (cmd_opts.cmd_verbose == true) {
+    logs() << "Found " << numeric_pids.size() << " processes in /proc, "
+              << pids.size() << " of them are selected." << std::endl;
+  }
+  return pids;
+}
+
+/**
+ * \brief Reads the command name and the flags from <proc root>/pid/stat.
+ *
+ * Returns \c false if the file cannot be read (e.g. because the process
+ * exited in the meantime).
+ */
+bool readProcStat(const std::string &proc_root, const std::string &pid,
+    ProcStat &proc_stat) {
+  const std::string stat_filepath(proc_root + "/" + pid + "/stat");
+  const int stat_fd = open(stat_filepath.c_str(), O_RDONLY);
+  ScanStats::count(ScanStats::Counter::Syscalls);
+  if (stat_fd == -1) {
+    return false;
+  }
+  char buffer[1024];
+  const ssize_t read_bytes = read(stat_fd, buffer, sizeof(buffer) - 1);
+  close(stat_fd);
+  ScanStats::count(ScanStats::Counter::Syscalls, 2);
+  if (read_bytes <= 0) {
+    return false;
+  }
+  ScanStats::count(ScanStats::Counter::BytesRead, read_bytes);
+  buffer[read_bytes] = '\0';
+  // The command name might contain spaces and parentheses so the fields are
+  // counted from the last closing parenthesis. The flags are the 9th field.
+  const char *comm_begin = strchr(buffer, '(');
+  const char *cur_pos = strrchr(buffer, ')');
+  if ((comm_begin == nullptr) || (cur_pos == nullptr) || (cur_pos < comm_begin)) {
+    return false;
+  }
+  proc_stat.comm.assign(comm_begin + 1, cur_pos);
+  for (unsigned field = 2; field < 9; ++field) {
+    cur_pos = strchr(cur_pos + 1, ' ');
+    if (cur_pos == nullptr) {
+      return false;
+    }
+  }
+  proc_stat.flags = strtoul(cur_pos + 1, nullptr, 10);
+  return true;
+}
+
+/**
+ * \brief Determines if the given process is a kernel thread.
+ *
+ * Kernel threads do not have an address space so there is no point in
+ * scanning them.
+ */
+bool isKernelThread(const ProcStat &proc_stat) {
+  return ((proc_stat.flags & proc_flag_kthread) != 0);
+}
+
+//===- ProcessSelector class ----------------------------------------------===//
+
+/**
+ * \brief Creates a selector for the selection options given in \c cmd_opts.
+ *
+ * The pids of the requested cgroup and all its descendants are read once.
+ * Throws \c std::invalid_argument if the cgroup cannot be read.
+ */
+ProcessSelector::ProcessSelector(const CmdOptions &cmd_opts)
+ : match_comm(cmd_opts.cmd_comm_regex.empty() == false),
+   match_cmdline(cmd_opts.cmd_cmdline_regex.empty() == false),
+   match_uid(cmd_opts.cmd_uid_userset), match_cgroup(false),
+   uid(cmd_opts.cmd_uid), proc_root(cmd_opts.cmd_proc_root) {
+  if (match_comm == true) {
+    comm_regex = std::regex(cmd_opts.cmd_comm_regex);
+  }
+  if (match_cmdline == true) {
+    cmdline_regex = std::regex(cmd_opts.cmd_cmdline_regex);
+  }
+  if (cmd_opts.cmd_cgroup_path.empty() == false) {
+    match_cgroup = true;
+    std::string cgroup_path(cmd_opts.cmd_cgroup_path);
+    if (cgroup_path.compare(0, cgroup_root.size(), cgroup_root) != 0) {
+      cgroup_path = cgroup_root + "/" + cgroup_path;
+    }
+    if (readCgroupPIDs(cgroup_path, false) == false) {
+      std::invalid_argument exc("Could not read the processes of cgroup " +
+                                cmd_opts.cmd_cgroup_path + ".");
+      throw exc;
+    }
+    std::sort(cgroup_pids.begin(), cgroup_pids.end());
+  }
+}
+
+/**
+ * \brief Adds the pids listed in cgroup.procs of the given cgroup directory
+ * and of all its child cgroups.
+ * \param is_child Indicates if the cgroup was found in the directory of its
+ * parent. It may have been removed since, then it is treated as empty.
+ */
+bool ProcessSelector::readCgroupPIDs(const std::string &cgroup_path,
+    bool is_child) {
+  std::ifstream procs_file(cgroup_path + "/cgroup.procs");
+  if (procs_file.is_open() == false) {
+    return (is_child == true) && (errno == ENOENT);
+  }
+  unsigned long cur_pid = 0;
+  while (procs_file >> cur_pid) {
+    cgroup_pids.push_back(cur_pid);
+  }
+
+  DIR *cgroup_dir = opendir(cgroup_path.c_str());
+  if (cgroup_dir == nullptr) {
+    return (is_child == true) && (errno == ENOENT);
+  }
+  bool success = true;
+  const struct dirent *cur_entry = nullptr;
+  while ((cur_entry = readdir(cgroup_dir)) != nullptr) {
+    if ((cur_entry->d_type != DT_DIR) || (cur_entry->d_name[0] == '.')) {
+      continue;
+    }
+    success &= readCgroupPIDs(cgroup_path + "/" + cur_entry->d_name, true);
+  }
+  closedir(cgroup_dir);
+  return success;
+}
+
+/**
+ * \brief Indicates if any selection option was given.
+ */
+bool ProcessSelector::empty(void) const {
+  return (match_comm == false) && (match_cmdline == false)
+      && (match_uid == false) && (match_cgroup == false);
+}
+
+/**
+ * \brief Determines if the given process matches all selection options.
+ *
+ * Cheap checks are done first. The command line of the process is only read
+ * if the command name, the owner and the cgroup already matched.
+ */
+bool ProcessSelector::matches(const std::string &pid,
+    const ProcStat &proc_stat) const {
+  if (match_cgroup == true) {
+    unsigned long numeric_pid = getpid();
+    if ((pid.compare("self") != 0)
+     && (str2ulong(pid, &numeric_pid, 10) == false)) {
+      return false;
+    }
+    if (std::binary_search(cgroup_pids.begin(), cgroup_pids.end(),
+                           numeric_pid) == false) {
+      return false;
+    }
+  }
+  if ((match_comm == true)
+   && (std::regex_search(proc_stat.comm, comm_regex) == false)) {
+    return false;
+  }
+  if (match_uid == true) {
+    uid_t effective_uid = 0;
+    if ((readEffectiveUid(pid, effective_uid) == false) || (effective_uid != uid)) {
+      return false;
+    }
+  }
+  if (match_cmdline == true) {
+    std::string cmdline;
+    if ((readCmdline(pid, cmdline) == false)
+     || (std::regex_search(cmdline, cmdline_regex) == false)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * \brief Reads the effective uid of a process from the Uid line of
+ * \brief <proc root>/pid/status.
+ *
+ * The owner of the process directory is not used, as it is root for
+ * processes that are not dumpable (e.g. setuid programs).
+ */
+bool ProcessSelector::readEffectiveUid(const std::string &pid,
+    uid_t &effective_uid) const {
+  const std::string status_filepath(proc_root + "/" + pid + "/status");
+  const int status_fd = open(status_filepath.c_str(), O_RDONLY);
+  ScanStats::count(ScanStats::Counter::Syscalls);
+  if (status_fd == -1) {
+    return false;
+  }
+  // The Uid line is among the first lines of the file
+  char buffer[4096];
+  const ssize_t read_bytes = read(status_fd, buffer, sizeof(buffer) - 1);
+  close(status_fd);
+  ScanStats::count(ScanStats::Counter::Syscalls, 2);
+  if (read_bytes <= 0) {
+    return false;
+  }
+  ScanStats::count(ScanStats::Counter::BytesRead, read_bytes);
+  buffer[read_bytes] = '\0';
+  // Uid: <real> <effective> <saved set> <filesystem>
+  const char *cur_pos = strstr(buffer, "\nUid:");
+  if (cur_pos == nullptr) {
+    return false;
+  }
+  char *field_end = nullptr;
+  strtoul(cur_pos + 5, &field_end, 10);
+  const char *uid_begin = field_end;
+  const unsigned long cur_uid = strtoul(uid_begin, &field_end, 10);
+  if ((field_end == uid_begin) || (uid_begin == cur_pos + 5)) {
+    return false;
+  }
+  effective_uid = static_cast<uid_t>(cur_uid);
+  return true;
+}
+
+/**
+ * \brief Reads the command line of a process. The arguments are separated by
+ * spaces.
+ */
+bool ProcessSelector::readCmdline(const std::string &pid,
+    std::string &cmdline) const {
+  const std::string cmdline_filepath(proc_root + "/" + pid + "/cmdline");
+  const int cmdline_fd = open(cmdline_filepath.c_str(), O_RDONLY);
+  ScanStats::count(ScanStats::Counter::Syscalls);
+  if (cmdline_fd == -1) {
+    return false;
+  }
+  char buffer[4096];
+  ssize_t read_bytes = 0;
+  while ((read_bytes = read(cmdline_fd, buffer, sizeof(buffer))) > 0) {
+    ScanStats::count(ScanStats::Counter::Syscalls);
+    ScanStats::count(ScanStats::Counter::BytesRead, read_bytes);
+    cmdline.append(buffer, read_bytes);
+  }
+  close(cmdline_fd);
+  ScanStats::count(ScanStats::Counter::Syscalls, 2);
+  if (read_bytes == -1) {
+    return false;
+  }
+  if ((cmdline.empty() == false) && (cmdline.back() == '\0')) {
+    cmdline.pop_back();
+  }
+  std::replace(cmdline.begin(), cmdline.end(), '\0', ' ');
+  return true;
+}
+
+/**
+ * \brief Removes all process ids that do not match the selection options.
+ */
+void selectPIDs(const CmdOptions &cmd_opts, const ProcessSelector &selector,
+    CmdOptions::PID_List_Ty &pids) {
+  if (selector.empty() == true) {
+    return;
+  }
+  pids.erase(std::remove_if(pids.begin(), pids.end(),
+      [&cmd_opts, &selector](const std::string &pid) {
+        ProcStat proc_stat;
+        return (readProcStat(cmd_opts.cmd_proc_root, pid, proc_stat) == false)
+            || (selector.matches(pid, proc_stat) == false);
+      }), pids.end());
+}
+
+/**
+ * \brief Creates the process objects for all requested process ids.
+ *
+ * Invalid process ids and processes whose files are not accessible are
+ * removed from the list of requested ids. Processes found by scanning /proc
+ * that exited in the meantime are skipped silently.
+ */
+std::vector<Process> createProcesses(CmdOptions &cmd_opts) {
+  std::vector<Process> processes;
+  processes.reserve(cmd_opts.cmd_req_pid.size());
+  for (CmdOptions::PID_List_Ty::iterator pid_it = cmd_opts.cmd_req_pid.begin(),
+      pid_end = cmd_opts.cmd_req_pid.end(); pid_it != pid_end; ) {
+    if ((str2ulong(*pid_it, nullptr, 10) == false)
+     && (pid_it->compare("self") != 0)) {
+      // Hmm, invalid iterator erase the pid
+      pid_it = cmd_opts.cmd_req_pid.erase(pid_it);
+      pid_end = cmd_opts.cmd_req_pid.end();
+      continue;
+    }
+    // Now try to create the process object in place. If any of the needed
+    // files the CTOR will throw an exception and the vector stays unchanged...
+    try {
+      processes.emplace_back(*pid_it, cmd_opts.cmd_proc_root);
+    } catch(const std::invalid_argument &inv_arg_exc) {
+      if ((cmd_opts.cmd_all_processes == false) || (cmd_opts.cmd_verbose == true)) {
+        errs() << "Skipping pid " << *pid_it << ": some needed files "
+                  << "are not accessible!" << std::endl;
+      }
+      pid_it = cmd_opts.cmd_req_pid.erase(pid_it);
+      pid_end = cmd_opts.cmd_req_pid.end();
+      continue;
+    }
+    ++pid_it;
+  }
+  ScanStats::count(ScanStats::Counter::Processes, processes.size());
+  return processes;
+}
+
+/**
+ * \brief Returns the number of threads to use for the given number of jobs.
+ *
+ * In verbose mode only a single thread is used so that the log messages of
+ * different processes are not mixed up.
+ */
+unsigned getNumWorkers(const CmdOptions &cmd_opts, size_t num_jobs) {
+  if (cmd_opts.cmd_verbose == true) {
+    return 1;
+  }
+  unsigned num_workers = cmd_opts.cmd_num_workers;
+  if (num_workers == 0) {
+    num_workers = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  return std::max(std::min<size_t>(num_workers, num_jobs), static_cast<size_t>(1));
+}
+
+/**
+ * \brief Calls \c job for the indices 0 to \c num_jobs - 1.
+ *
+ * The indices are distributed dynamically over several worker threads.
+ */
+void runParallel(const CmdOptions &cmd_opts, size_t num_jobs,
+    const std::function<void(size_t)> &job) {
+  std::atomic<size_t> next_job(0);
+  auto worker = [num_jobs, &job, &next_job]() {
+    size_t cur_index = 0;
+    while ((cur_index = next_job.fetch_add(1)) < num_jobs) {
+      job(cur_index);
+    }
+  };
+
+  const unsigned num_workers = getNumWorkers(cmd_opts, num_jobs);
+  if (num_workers <= 1) {
+    worker();
+  } else {
+    std::vector<std::thread> workers;
+    workers.reserve(num_workers);
+    for (unsigned i = 0; i < num_workers; ++i) {
+      workers.push_back(std::thread(worker));
+    }
+    for (std::thread &cur_worker : workers) {
+      cur_worker.join();
+    }
+  }
+}
+
+/**
+ * \brief Populates the ranges and pages of all processes.
+ *
+ * First the ranges of all processes are created and afterwards their pages
+ * are read. Both steps are distributed over several worker threads.
+ * Processes whose files could not be read (e.g. because they exited during
+ * the scan) are removed. Returns the number of remaining processes.
+ */
+size_t populateProcesses(const CmdOptions &cmd_opts,
+    std::vector<Process> &processes) {
+  {
+    ScanStats::PhaseTimer timer(ScanStats::Phase::MapsParsing);
+    runParallel(cmd_opts, processes.size(), [&cmd_opts, &processes](size_t i) {
+      if (cmd_opts.cmd_prog_mode == CmdOptions::ProgMode::Mappings) {
+        processes[i].populateFileRanges(cmd_opts);
+      } else if (cmd_opts.cmd_prog_mode == CmdOptions::ProgMode::Pages) {
+        processes[i].populateMixedRange(cmd_opts);
+      }
+    });
+  }
+  {
+    ScanStats::PhaseTimer timer(ScanStats::Phase::PagemapReads);
+    runParallel(cmd_opts, processes.size(), [&cmd_opts, &processes](size_t i) {
+      if (processes[i].isAccessible() == true) {
+        processes[i].populatePages(cmd_opts);
+      }
+    });
+  }
+
+  processes.erase(std::remove_if(processes.begin(), processes.end(),
+      [](const Process &proc) {
+        return (proc.isAccessible() == false);
+      }), processes.end());
+  return processes.size();
+}
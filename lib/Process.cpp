@@ -2,25 +2,189 @@
 //===----------------------------------------------------------------------===//
 
 #include "Process.h"
+#include "Diagnostics.h"
+#include "Stats.h"
+#include "Trace.h"
 
 #include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <fcntl.h>
-#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <limits>
+#include <sstream>
 #include <stdexcept>
+#include <poll.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
-Process::Process(std::string pid)
- : process_id(pid), maps_filepath(""), pagemap_filepath("") {
+Process::Process(std::string pid, const std::string &procroot)
+ : process_id(pid), proc_root(procroot), maps_filepath(""), pagemap_filepath(""),
+   page_arena(nullptr), pid_fd(-1), proc_dir_fd(-1), maps_fd(-1),
+   pagemap_fd(-1), accessible(true) {
   if (checkForFiles() == false) {
+    // The destructor is not run for a throwing constructor
+    closeFiles();
     std::invalid_argument exc("Could not initialize process object. Some files might are inacessible.");
     throw exc;
   }
 }
 
+/**
+ * \brief Creates a process object that is not backed by /proc.
+ * \param pid The id of the process the ranges were collected from.
+ * \param ranges The already populated page ranges of the process.
+ *
+ * The created object does not refer to any maps or pagemap file. It is used to
+ * represent processes restored from a snapshot so its ranges must not be
+ * populated again.
+ */
+Process::Process(std::string pid, const VPR_List_Ty &ranges)
+ : process_id(pid), proc_root(""), maps_filepath(""), pagemap_filepath(""),
+   vp_ranges(ranges), page_arena(nullptr),
+   pid_fd(-1), proc_dir_fd(-1), maps_fd(-1), pagemap_fd(-1), accessible(true) {
+  range_index.build(vp_ranges);
+}
+
+/**
+ * \brief Creates a process object that is not backed by /proc and takes over
+ * \brief the given ranges without copying their pages.
+ */
+Process::Process(std::string pid, VPR_List_Ty &&ranges)
+ : process_id(std::move(pid)), proc_root(""), maps_filepath(""),
+   pagemap_filepath(""), vp_ranges(std::move(ranges)), page_arena(nullptr),
+   pid_fd(-1), proc_dir_fd(-1), maps_fd(-1), pagemap_fd(-1), accessible(true) {
+  range_index.build(vp_ranges);
+}
+
+/**
+ * \brief Copies a process object.
+ *
+ * The copy refers to the same process as \c other as it duplicates the
+ * pidfd and the descriptor of the process directory. It does not share the
+ * open maps and pagemap files of \c other but will open its own files when
+ * its ranges and pages are populated. Its pages are not taken from the
+ * arena of \c other.
+ */
+Process::Process(const Process &other)
+ : process_id(other.process_id), proc_root(other.proc_root),
+   maps_filepath(other.maps_filepath),
+   pagemap_filepath(other.pagemap_filepath), vp_ranges(other.vp_ranges),
+   range_index(other.range_index), maps_content(other.maps_content),
+   page_arena(nullptr), pid_fd(duplicateFD(other.pid_fd)),
+   proc_dir_fd(duplicateFD(other.proc_dir_fd)), maps_fd(-1), pagemap_fd(-1),
+   accessible(other.accessible) {
+}
+
+/**
+ * \brief Moves a process object.
+ *
+ * The open files of \c other are handed over. As moving never throws,
+ * vectors of processes move their elements when they grow instead of copying
+ * them with all their ranges and pages.
+ */
+Process::Process(Process &&other) noexcept
+ : process_id(std::move(other.process_id)),
+   proc_root(std::move(other.proc_root)),
+   maps_filepath(std::move(other.maps_filepath)),
+   pagemap_filepath(std::move(other.pagemap_filepath)),
+   vp_ranges(std::move(other.vp_ranges)),
+   range_index(std::move(other.range_index)),
+   maps_content(std::move(other.maps_content)),
+   page_arena(other.page_arena), pid_fd(other.pid_fd),
+   proc_dir_fd(other.proc_dir_fd), maps_fd(other.maps_fd),
+   pagemap_fd(other.pagemap_fd), accessible(other.accessible) {
+  other.pid_fd = -1;
+  other.proc_dir_fd = -1;
+  other.maps_fd = -1;
+  other.pagemap_fd = -1;
+}
+
+/**
+ * \brief Copies a process object into this one.
+ *
+ * Like the copy constructor it neither shares the open files nor the arena of
+ * \c other. The arena of this object is dropped as well, since its pages are
+ * replaced. The ranges are copied into a new list because assigning them
+ * element by element would keep the pages in the arena of the old ranges.
+ */
+Process& Process::operator=(const Process &other) {
+  if (this != &other) {
+    closeFiles();
+    process_id = other.process_id;
+    proc_root = other.proc_root;
+    maps_filepath = other.maps_filepath;
+    pagemap_filepath = other.pagemap_filepath;
+    vp_ranges = VPR_List_Ty(other.vp_ranges);
+    range_index = other.range_index;
+    maps_content = other.maps_content;
+    page_arena = nullptr;
+    pid_fd = duplicateFD(other.pid_fd);
+    proc_dir_fd = duplicateFD(other.proc_dir_fd);
+    accessible = other.accessible;
+  }
+  return *this;
+}
+
+Process& Process::operator=(Process &&other) noexcept {
+  if (this != &other) {
+    closeFiles();
+    process_id = std::move(other.process_id);
+    proc_root = std::move(other.proc_root);
+    maps_filepath = std::move(other.maps_filepath);
+    pagemap_filepath = std::move(other.pagemap_filepath);
+    vp_ranges = std::move(other.vp_ranges);
+    range_index = std::move(other.range_index);
+    maps_content = std::move(other.maps_content);
+    page_arena = other.page_arena;
+    pid_fd = other.pid_fd;
+    proc_dir_fd = other.proc_dir_fd;
+    maps_fd = other.maps_fd;
+    pagemap_fd = other.pagemap_fd;
+    accessible = other.accessible;
+    other.pid_fd = -1;
+    other.proc_dir_fd = -1;
+    other.maps_fd = -1;
+    other.pagemap_fd = -1;
+  }
+  return *this;
+}
+
+Process::~Process(void) {
+  closeFiles();
+}
+
+/**
+ * \brief Duplicates a file descriptor. Returns -1 if \c fd is -1 or if it
+ * \brief cannot be duplicated.
+ */
+int Process::duplicateFD(int fd) {
+  if (fd == -1) {
+    return -1;
+  }
+  ScanStats::count(ScanStats::Counter::Syscalls);
+  return fcntl(fd, F_DUPFD_CLOEXEC, 0);
+}
+
+/**
+ * \brief Closes all files of the process including its pidfd and the
+ * \brief descriptor of its directory.
+ */
+void Process::closeFiles(void) {
+  closePageMapFile();
+  int *const fds[] = {&maps_fd, &proc_dir_fd, &pid_fd};
+  for (int *cur_fd : fds) {
+    if (*cur_fd != -1) {
+      ScanStats::count(ScanStats::Counter::Syscalls);
+      close(*cur_fd);
+      *cur_fd = -1;
+    }
+  }
+}
+
 const std::string& Process::getPID(void) const {
   return process_id;
 }
@@ -37,34 +201,88 @@ const Process::VPR_List_Ty& Process::getVPageRanges(void) const {
   return vp_ranges;
 }
 
+const VPRangeIndex& Process::getVPRangeIndex(void) const {
+  return range_index;
+}
+
+/**
+ * \brief Returns the mapped range containing \c address.
+ *
+ * Unmapped ranges are never returned. If no range contains the address
+ * \c nullptr is returned. The returned pointer is invalidated as soon as the
+ * ranges are populated again.
+ */
+const VPageRange* Process::findVPageRange(uint64_t address) const {
+  const size_t pos = range_index.find(address);
+  if (pos == VPRangeIndex::npos) {
+    return nullptr;
+  }
+  return &vp_ranges[pos];
+}
+
+/**
+ * \brief Returns all mapped ranges overlapping the address window
+ * \brief [\c lower_address, \c upper_address) in ascending order.
+ */
+std::vector<const VPageRange*> Process::findVPageRanges(uint64_t lower_address,
+    uint64_t upper_address) const {
+  std::vector<const VPageRange*> found;
+  for (size_t pos : range_index.findWindow(lower_address, upper_address)) {
+    found.push_back(&vp_ranges[pos]);
+  }
+  return found;
+}
+
+/**
+ * \brief Looks up the mapped ranges containing many addresses at once.
+ *
+ * Stores a pointer to the range containing \c addresses[i] (or \c nullptr)
+ * in \c ranges[i]. This is considerably faster than calling
+ * \c findVPageRange() for each address if many addresses are resolved.
+ */
+void Process::findVPageRanges(const std::vector<uint64_t> &addresses,
+    std::vector<const VPageRange*> &ranges) const {
+  const std::vector<size_t> found = range_index.findBatch(addresses);
+  ranges.assign(found.size(), nullptr);
+  for (size_t i = 0, e = found.size(); i < e; ++i) {
+    if (found[i] != VPRangeIndex::npos) {
+      ranges[i] = &vp_ranges[found[i]];
+    }
+  }
+}
+
 /**
  * \brief Checks if all needed files exist.
  *
- * Checks if all needed files (/proc/id/maps, /proc/id/pagemap) exist and
- * are read-accessible to the user. If so \c true is returned. Else the function
- * returns \c false.
+ * Checks if all needed files (<proc root>/id/maps, <proc root>/id/pagemap)
+ * exist and are read-accessible to the user. If so \c true is returned. Else
+ * the function returns \c false. The process directory stays open and all
+ * files of the process are opened relative to it.
  */
 bool Process::checkForFiles(void) {
-  // Test if the needed directory exists
-  const std::string dir_path("/proc/" + process_id);
-  struct stat dir_stat;
-  if (stat(dir_path.c_str(), &dir_stat) != 0) {
-    return false;
-  }
-  if (S_ISDIR(dir_stat.st_mode) == false) {
+  // The pidfd is opened before the directory. If the process did not exit
+  // after the directory was opened, the directory cannot belong to a process
+  // that reused the pid.
+  openPidFD();
+  const std::string dir_path(proc_root + "/" + process_id);
+  proc_dir_fd = open(dir_path.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+  ScanStats::count(ScanStats::Counter::Syscalls);
+  if ((proc_dir_fd == -1) || (hasExited() == true)) {
     return false;
   }
 
-  // Now set path to the maps file. One would have to make sure that we do run
-  // anywhere outside the /proc directory but... maybe later...
+  // All files are opened relative to the directory so its path is resolved
+  // only once
   maps_filepath = dir_path + "/maps";
-  if (access (maps_filepath.c_str(), F_OK | R_OK) != 0) {
+  ScanStats::count(ScanStats::Counter::Syscalls);
+  if (faccessat(proc_dir_fd, "maps", R_OK, 0) != 0) {
     maps_filepath.clear();
     return false;
   }
   // Now set path to the pagemap file.
   pagemap_filepath = dir_path + "/pagemap";
-  if (access (pagemap_filepath.c_str(), F_OK | R_OK) != 0) {
+  ScanStats::count(ScanStats::Counter::Syscalls);
+  if (faccessat(proc_dir_fd, "pagemap", R_OK, 0) != 0) {
     pagemap_filepath.clear();
     return false;
   }
@@ -72,6 +290,129 @@ bool Process::checkForFiles(void) {
   return true;
 }
 
+/**
+ * \brief Opens a pidfd for the process.
+ *
+ * A pidfd is only opened for processes of the real /proc and only if the
+ * kernel supports it. Without a pidfd \c hasExited() always returns
+ * \c false and exited processes are only detected when reading their files
+ * fails.
+ */
+void Process::openPidFD(void) {
+#ifdef SYS_pidfd_open
+  if (proc_root.compare("/proc") != 0) {
+    return;
+  }
+  unsigned long pid = 0;
+  if (process_id.compare("self") == 0) {
+    pid = getpid();
+  } else if (str2ulong(process_id, &pid, 10) == false) {
+    return;
+  }
+  pid_fd = syscall(SYS_pidfd_open, static_cast<pid_t>(pid), 0);
+  ScanStats::count(ScanStats::Counter::Syscalls);
+#endif
+}
+
+/**
+ * \brief Indicates if the process is known to have exited.
+ *
+ * The pidfd of a process becomes readable when the process exits. So a
+ * process is detected as exited even if its pid was reused by another
+ * process in the meantime.
+ */
+bool Process::hasExited(void) const {
+  if (pid_fd == -1) {
+    return false;
+  }
+  struct pollfd pid_pollfd;
+  pid_pollfd.fd = pid_fd;
+  pid_pollfd.events = POLLIN;
+  pid_pollfd.revents = 0;
+  ScanStats::count(ScanStats::Counter::Syscalls);
+  return poll(&pid_pollfd, 1, 0) == 1;
+}
+
+/**
+ * \brief Indicates if the last failed file access was caused by the process
+ * \brief having exited.
+ */
+bool Process::hasVanished(void) const {
+  return (errno == ENOENT) || (errno == ESRCH);
+}
+
+/**
+ * \brief Reads the whole maps file of the process into the given string.
+ *
+ * Returns \c true if the file could be read completely.
+ */
+bool Process::readMapsFile(std::string &content) {
+  if (hasExited() == true) {
+    errno = ESRCH;
+    return false;
+  }
+  // The file stays open. Reading it from offset 0 again returns the current
+  // mappings.
+  if (maps_fd == -1) {
+    maps_fd = openat(proc_dir_fd, "maps", O_RDONLY | O_CLOEXEC);
+    ScanStats::count(ScanStats::Counter::Syscalls);
+    if (maps_fd == -1) {
+      return false;
+    }
+  }
+  content.clear();
+  char buffer[16384];
+  ssize_t read_bytes = 0;
+  off_t cur_offset = 0;
+  while ((read_bytes = pread(maps_fd, buffer, sizeof(buffer), cur_offset)) != 0) {
+    ScanStats::count(ScanStats::Counter::Syscalls);
+    if (read_bytes == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      const int read_errno = errno;
+      ScanStats::count(ScanStats::Counter::Syscalls);
+      close(maps_fd);
+      maps_fd = -1;
+      errno = read_errno;
+      return false;
+    }
+    ScanStats::count(ScanStats::Counter::BytesRead, read_bytes);
+    content.append(buffer, read_bytes);
+    cur_offset += read_bytes;
+  }
+  // Count the final read that hit the end of the file
+  ScanStats::count(ScanStats::Counter::Syscalls);
+  // The maps file of a process that exited but was not reaped yet is empty
+  if (content.empty() == true) {
+    errno = ESRCH;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * \brief Checks if the process still exists.
+ *
+ * Uses the pidfd if there is one. Otherwise the maps file is read again, as
+ * reading it fails or returns nothing once the process is gone. If the
+ * process exited \c isAccessible() returns \c false afterwards.
+ */
+bool Process::checkAlive(void) {
+  if (hasExited() == true) {
+    accessible = false;
+    return false;
+  }
+  if (pid_fd == -1) {
+    std::string content;
+    if ((readMapsFile(content) == false) && (hasVanished() == true)) {
+      accessible = false;
+      return false;
+    }
+  }
+  return true;
+}
+
 /**
  * \brief Populates the process' page ranges.
  *
@@ -83,24 +424,91 @@ bool Process::checkForFiles(void) {
  * deleted.
  */
 size_t Process::populateFileRanges(const CmdOptions &cmd_opts) {
-  // Store the format flags of the clog stream
-  std::ios_base::fmtflags original_clog_flags = std::clog.flags();
-  // Open the stream to the /proc/pid/maps file
-  std::ifstream maps_file(maps_filepath, std::ios_base::in);
-  if (maps_file.is_open() == false) {
-    std::cerr << "Could not open maps file for process " << process_id
-              << " (stream is not open)!" << std::endl;
+  TraceSpan span("Process::populateFileRanges", "pid", process_id);
+  std::string content;
+  if (readMapsFile(content) == false) {
+    // A process that exited in the meantime is not worth an error message
+    if ((hasVanished() == false) || (cmd_opts.cmd_verbose == true)) {
+      errs() << "Could not open maps file for process " << process_id
+                << " (stream is not open)!" << std::endl;
+    }
+    accessible = false;
     return 0;
   }
-  if (maps_file.good() == false) {
-    std::cerr << "Error occured while opening maps file for process "
-              << process_id << " (stream is not good)!" << std::endl;
-    return 0;
+  maps_content.swap(content);
+  return parseFileRanges(cmd_opts);
+}
+
+/**
+ * \brief Populates the process' page ranges if the mappings changed.
+ *
+ * Reads the maps file again and only parses it if its content differs from
+ * the content the current ranges were created from. Returns \c true if the
+ * ranges were recreated. \c false is returned if nothing changed or if the
+ * maps file could not be read anymore (then \c isAccessible() returns
+ * \c false).
+ */
+bool Process::refreshFileRanges(const CmdOptions &cmd_opts) {
+  std::string content;
+  if (readMapsFile(content) == false) {
+    accessible = false;
+    return false;
+  }
+  if (content == maps_content) {
+    return false;
   }
+  maps_content.swap(content);
+  parseFileRanges(cmd_opts);
+  return true;
+}
+
+/**
+ * \brief Finds the first line of a maps file that ends above \c address.
+ *
+ * The lines of a maps file are sorted by address and the ranges do not
+ * overlap, so a binary search over the line starts finds the first line that
+ * may be wanted. Returns the offset of that line and stores its number in
+ * \c line_no.
+ */
+static size_t findFirstMapsLine(const std::string &content, uint64_t address,
+    unsigned &line_no) {
+  std::vector<size_t> line_starts;
+  for (const char *cur_pos = content.data(), *end = cur_pos + content.size();
+      cur_pos < end;) {
+    line_starts.push_back(cur_pos - content.data());
+    const char *line_end = static_cast<const char*>(
+        memchr(cur_pos, '\n', end - cur_pos));
+    if (line_end == nullptr) {
+      break;
+    }
+    cur_pos = line_end + 1;
+  }
+  // Invalid lines compare as ending at 0 and are thus skipped as well
+  std::vector<size_t>::const_iterator first_line = std::partition_point(
+      line_starts.begin(), line_starts.end(),
+      [&content, address](size_t line_start) {
+        const char *upper_str = strchr(content.c_str() + line_start, '-');
+        if (upper_str == nullptr) {
+          return true;
+        }
+        return strtoull(upper_str + 1, nullptr, 16) <= address;
+      });
+  line_no = first_line - line_starts.begin();
+  return (first_line == line_starts.end()) ? content.size() : *first_line;
+}
+
+/**
+ * \brief Creates the page ranges from the cached content of the maps file.
+ */
+size_t Process::parseFileRanges(const CmdOptions &cmd_opts) {
+  // Store the format flags of the clog stream
+  std::ios_base::fmtflags original_clog_flags = logs().flags();
+  // Parse the cached content of the /proc/pid/maps file
+  std::istringstream maps_file(maps_content);
 
   if (cmd_opts.cmd_verbose == true) {
-    std::clog << "Opened maps file for process " << process_id << std::endl;
-    std::clog << "Searching for page ranges in " << std::uppercase
+    logs() << "Parsing maps file for process " << process_id << std::endl;
+    logs() << "Searching for page ranges in " << std::uppercase
               << std::hex << std::setfill('0') << "0x" << std::setw(16)
               << cmd_opts.cmd_lower_address << " to "
               << std::hex << std::setfill('0') << "0x" << std::setw(16)
@@ -112,8 +520,27 @@ size_t Process::populateFileRanges(const CmdOptions &cmd_opts) {
 
   // This vector will temporarily store the page ranges
   std::vector<VPageRange> tmp_ranges;
+  // Lines ending below the requested range are not parsed at all
+  unsigned first_range_no = 0;
+  if (cmd_opts.cmd_low_addr_userset == true) {
+    const size_t first_line = findFirstMapsLine(maps_content,
+        cmd_opts.cmd_lower_address, first_range_no);
+    if (first_line == maps_content.size()) {
+      maps_file.setstate(std::ios_base::eofbit);
+    } else {
+      maps_file.seekg(first_line);
+    }
+    if ((cmd_opts.cmd_verbose == true) && (first_range_no > 0)) {
+      logs() << "Skipping ranges 0 to " << std::dec << (first_range_no - 1)
+                << " as below requested range!" << std::endl;
+    }
+  }
+  // Set when the parsing stopped at the first line above the requested range
+  bool reached_upper_address = false;
+  // The path of the current line. Its buffer is reused for all lines.
+  std::string cur_mappedfile;
   // Now read all lines from the maps file
-  for (unsigned cur_range_no = 0;
+  for (unsigned cur_range_no = first_range_no;
       ((maps_file.good() == true) && (maps_file.eof() == false));
       ++cur_range_no) {
     uint64_t cur_lower = 0, cur_upper = 0;
@@ -128,7 +555,7 @@ size_t Process::populateFileRanges(const CmdOptions &cmd_opts) {
     // Some sanity checks
     if (cur_lower > cur_upper) {
       if (cmd_opts.cmd_verbose == true) {
-        std::clog << "Skipping invalid range " << std::dec << cur_range_no
+        logs() << "Skipping invalid range " << std::dec << cur_range_no
                   << " (lower address > upper address)!" << std::endl;
       }
       // Ignore the remainder of the current line and continue with next one
@@ -136,12 +563,24 @@ size_t Process::populateFileRanges(const CmdOptions &cmd_opts) {
       continue;
     }
 
+    // The lines are sorted so no later range can be wanted either
+    if ((cmd_opts.cmd_up_addr_userset == true)
+     && (cur_lower >= cmd_opts.cmd_upper_address)) {
+      if (cmd_opts.cmd_verbose == true) {
+        logs() << "Skipping range " << std::dec << cur_range_no
+                  << " and all following ones as above requested range!"
+                  << std::endl;
+      }
+      reached_upper_address = true;
+      break;
+    }
+
     // Test if the current range is wanted
     if (((cmd_opts.cmd_low_addr_userset == true) && (cur_upper <= cmd_opts.cmd_lower_address))
      || ((cmd_opts.cmd_up_addr_userset == true) && (cur_lower >= cmd_opts.cmd_upper_address))) {
       // The current range is not included in the requested range
       if (cmd_opts.cmd_verbose == true) {
-        std::clog << "Skipping range " << std::dec << cur_range_no << " ("
+        logs() << "Skipping range " << std::dec << cur_range_no << " ("
                   << std::hex << std::setfill('0') << "0x" << std::setw(16) << cur_lower
                   << "-"
                   << std::hex << std::setfill('0') << "0x" << std::setw(16) << cur_upper
@@ -155,21 +594,21 @@ size_t Process::populateFileRanges(const CmdOptions &cmd_opts) {
 
     // Test if the boundaries of the ranges are aligned to the pagesize
     if ((cur_lower & proc_pageoffset_mask) != 0) {
-      std::cerr << "Skipping range " << std::dec << cur_range_no << ": "
+      errs() << "Skipping range " << std::dec << cur_range_no << ": "
                 << "lower address is not aligned to pagesize!" << std::endl;
       // Ignore the remainder of the current line and continue with next one
       maps_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
       continue;
     }
     if ((cur_upper & proc_pageoffset_mask) != 0) {
-      std::cerr << "Skipping range " << std::dec << cur_range_no << ": "
+      errs() << "Skipping range " << std::dec << cur_range_no << ": "
                 << "upper address is not aligned to pagesize!" << std::endl;
       // Ignore the remainder of the current line and continue with next one
       maps_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
       continue;
     }
     if (((cur_upper - cur_lower) & proc_pageoffset_mask) != 0) {
-      std::cerr << "Skipping range " << std::dec << cur_range_no << ": "
+      errs() << "Skipping range " << std::dec << cur_range_no << ": "
                 << "number of contained pages is not an integer!" << std::endl;
       // Ignore the remainder of the current line and continue with next one
       maps_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
@@ -269,31 +708,32 @@ size_t Process::populateFileRanges(const CmdOptions &cmd_opts) {
     } while (true);
     // Now extract the provided filename (meaning everything remaining in the
     // current line)
-    std::string cur_mappedfile;
     getline(maps_file, cur_mappedfile);
     cur_range.setMappedFilePath(cur_mappedfile);
     // Now ignore the remainder of the line
     // maps_file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
     // The object seems to be valid else we would have jumped out of the loop
     // would have continued
-    tmp_ranges.push_back(cur_range);
+    tmp_ranges.push_back(std::move(cur_range));
   } // End of for-loop iterating over lines in maps file
-  if (maps_file.eof() == false) {
+  if ((maps_file.eof() == false) && (reached_upper_address == false)) {
     // Something went wrong...
-    std::cerr << "Error occured while reading virtual page ranges for process "
+    errs() << "Error occured while reading virtual page ranges for process "
               << process_id << " (stream is not good and not eof)!" << std::endl;
   }
-  // We do not need the file anymore...
-  maps_file.close();
-
   // There should not be nothing else bail out early
   if (tmp_ranges.size() == 0) {
+    vp_ranges.clear();
+    range_index.clear();
+    if (cmd_opts.cmd_verbose == true) {
+      logs().flags(original_clog_flags);
+    }
     return vp_ranges.size();
   }
 
   // Now sort the ranges
   std::sort(tmp_ranges.begin(), tmp_ranges.end(),
-      [](const VPageRange lhs, const VPageRange rhs){
+      [](const VPageRange &lhs, const VPageRange &rhs){
         if (lhs.getFirstAddress() < rhs.getFirstAddress()) {
           return true;
         } else {
@@ -335,7 +775,7 @@ size_t Process::populateFileRanges(const CmdOptions &cmd_opts) {
     // Test if ranges overlap (should not occur) and skip them
     if (vp_ranges.size() > 0) {
       if (cur_vp_range.getFirstAddress() < vp_ranges.back().getNextAddress()) {
-        std::cerr << "Skipping overlapping range " << cur_vp_range.getVPRangeNumber()
+        errs() << "Skipping overlapping range " << cur_vp_range.getVPRangeNumber()
                   << " (preceeding range: " << vp_ranges.back().getVPRangeNumber()
                   << std::endl;
         continue;
@@ -348,13 +788,13 @@ size_t Process::populateFileRanges(const CmdOptions &cmd_opts) {
         VPageRange cur_unmapped_vpr(cur_address_pos,
             cur_vp_range.getFirstAddress(), proc_pagesize);
         cur_unmapped_vpr.setMappingType(VPageRange::MappingType::Unmapped);
-        vp_ranges.push_back(cur_unmapped_vpr);
         cur_address_pos = cur_unmapped_vpr.getNextAddress();
+        vp_ranges.push_back(std::move(cur_unmapped_vpr));
       }
     }
 
-    vp_ranges.push_back(cur_vp_range);
     cur_address_pos = cur_vp_range.getNextAddress();
+    vp_ranges.push_back(std::move(cur_vp_range));
   }
   if (cmd_opts.cmd_show_unmapped == true) {
     // Now we might need to add a last unmapped region. We only do that if
@@ -366,23 +806,31 @@ size_t Process::populateFileRanges(const CmdOptions &cmd_opts) {
       uint64_t new_upper = (cmd_opts.cmd_upper_address + proc_pagesize) & (~(proc_pagesize-1));
       VPageRange cur_unmapped_vpr(cur_address_pos, new_upper, proc_pagesize);
       cur_unmapped_vpr.setMappingType(VPageRange::MappingType::Unmapped);
-      vp_ranges.push_back(cur_unmapped_vpr);
+      vp_ranges.push_back(std::move(cur_unmapped_vpr));
     }
   }
 
-  // Restore flags for clog stream
-  std::clog.flags(original_clog_flags);
+  // Restore flags for clog stream (only changed in verbose mode)
+  if (cmd_opts.cmd_verbose == true) {
+    logs().flags(original_clog_flags);
+  }
+  range_index.build(vp_ranges);
+  ScanStats::count(ScanStats::Counter::Ranges, vp_ranges.size());
   return vp_ranges.size();
 }
 
 /**
- * \brief Populates the process' page ranges.
+ * \brief Populates the process' page ranges for the address interval given
+ * \brief by the arguments.
  *
- * Populates the process' page ranges by creating a single \c VPageRange object.
- * That range represents the address interval indicated by the arguments. The
- * information from \c /proc/pid/maps are NOT used. Therefore null pages may
- * occur. Already existing ranges will be deleted. The function returns the
- * number of created ranges.
+ * The layout from \c /proc/pid/maps is used to skip the holes of the address
+ * space: every mapping within the interval becomes a range (clipped to the
+ * interval) and each hole between them becomes a single unmapped range whose
+ * pages are never read. So even an interval spanning the whole address space
+ * only creates the pages that are mapped. If the maps file cannot be read a
+ * single \c Mixed range representing the whole interval is created instead,
+ * so null pages may occur. Already existing ranges will be deleted. The
+ * function returns the number of created ranges.
  */
 size_t Process::populateMixedRange(const CmdOptions &cmd_opts) {
   if ((cmd_opts.cmd_low_addr_userset == false)
@@ -397,9 +845,47 @@ size_t Process::populateMixedRange(const CmdOptions &cmd_opts) {
   const long proc_pagesize = sysconf(_SC_PAGESIZE);
   const long proc_pageoffset_mask = proc_pagesize - 1;
 
-  // Now align the addresses to page size
+  // Now align the addresses to page size. The last page of the address space
+  // cannot be represented as its next address would overflow.
   uint64_t cur_vpr_lower_addr = cmd_opts.cmd_lower_address & (~proc_pageoffset_mask);
-  uint64_t cur_vpr_upper_addr = (cmd_opts.cmd_upper_address & (~proc_pageoffset_mask)) + proc_pagesize;
+  uint64_t cur_vpr_upper_addr = cmd_opts.cmd_upper_address & (~proc_pageoffset_mask);
+  if (cur_vpr_upper_addr <= std::numeric_limits<uint64_t>::max() - proc_pagesize) {
+    cur_vpr_upper_addr += proc_pagesize;
+  }
+
+  std::string content;
+  if (readMapsFile(content) == true) {
+    maps_content.swap(content);
+    CmdOptions window_opts(cmd_opts);
+    window_opts.cmd_lower_address = cur_vpr_lower_addr;
+    window_opts.cmd_upper_address = cur_vpr_upper_addr;
+    window_opts.cmd_show_unmapped = false;
+    parseFileRanges(window_opts);
+
+    // Clip the mappings to the interval and fill the holes in between
+    VPR_List_Ty mapped_ranges;
+    mapped_ranges.swap(vp_ranges);
+    vp_ranges.reserve(2 * mapped_ranges.size() + 1);
+    uint64_t cur_address_pos = cur_vpr_lower_addr;
+    for (VPageRange &cur_vp_range : mapped_ranges) {
+      cur_vp_range.clip(cur_vpr_lower_addr, cur_vpr_upper_addr);
+      if (cur_vp_range.getFirstAddress() > cur_address_pos) {
+        VPageRange cur_unmapped_vpr(cur_address_pos,
+            cur_vp_range.getFirstAddress(), proc_pagesize);
+        cur_unmapped_vpr.setMappingType(VPageRange::MappingType::Unmapped);
+        vp_ranges.push_back(std::move(cur_unmapped_vpr));
+      }
+      cur_address_pos = cur_vp_range.getNextAddress();
+      vp_ranges.push_back(std::move(cur_vp_range));
+    }
+    if (cur_vpr_upper_addr > cur_address_pos) {
+      VPageRange cur_unmapped_vpr(cur_address_pos, cur_vpr_upper_addr, proc_pagesize);
+      cur_unmapped_vpr.setMappingType(VPageRange::MappingType::Unmapped);
+      vp_ranges.push_back(std::move(cur_unmapped_vpr));
+    }
+    range_index.build(vp_ranges);
+    return vp_ranges.size();
+  }
 
   // Now create the range object
   VPageRange cur_range(cur_vpr_lower_addr, cur_vpr_upper_addr, proc_pagesize);
@@ -412,11 +898,62 @@ size_t Process::populateMixedRange(const CmdOptions &cmd_opts) {
   cur_range.setMappedFilePath("");
   cur_range.setMappingType(VPageRange::MappingType::Mixed);
   vp_ranges.clear();
-  vp_ranges.push_back(cur_range);
+  vp_ranges.push_back(std::move(cur_range));
 
+  range_index.build(vp_ranges);
+  ScanStats::count(ScanStats::Counter::Ranges, vp_ranges.size());
   return vp_ranges.size();
 }
 
+/**
+ * \brief Opens the pagemap file unless it is already open.
+ *
+ * The file contains an 64bit entry for each virtual page. So that value can
+ * be perfectly stored in an uint64_t. The file stays open so that repeated
+ * scans of the same process do not have to open it again. Returns \c false
+ * if the file cannot be opened (then \c isAccessible() returns \c false).
+ */
+bool Process::openPageMapFile(const CmdOptions &cmd_opts) {
+  if (pagemap_fd != -1) {
+    return true;
+  }
+  pagemap_fd = openat(proc_dir_fd, "pagemap", O_RDONLY | O_CLOEXEC);
+  ScanStats::count(ScanStats::Counter::Syscalls);
+  if (pagemap_fd == -1) {
+    if ((hasVanished() == false) || (cmd_opts.cmd_verbose == true)) {
+      errs() << "Could not open pagemap file " << pagemap_filepath << std::endl;
+      printSystemError("open:");
+    }
+    accessible = false;
+    return false;
+  }
+  if (cmd_opts.cmd_verbose == true) {
+    logs() << "Opened pagemap file for process " << process_id << std::endl;
+  }
+  return true;
+}
+
+/**
+ * \brief Indicates if the pagemap entries of a freshly populated range could
+ * \brief not be read at all because the process exited.
+ *
+ * Reading the pagemap file returns nothing once the address space of the
+ * process is gone, but also for ranges beyond the user address space such as
+ * [vsyscall]. So only an exited process counts, which is checked with the
+ * pidfd or, without one, by reading the maps file again.
+ */
+bool Process::isAddressSpaceGone(const VPageRange &vp_range) {
+  if ((vp_range.getVPages().empty() == true)
+   || (vp_range.getVPages().front().arePagePropertiesValid() == true)) {
+    return false;
+  }
+  if (pid_fd != -1) {
+    return hasExited();
+  }
+  std::string content;
+  return (readMapsFile(content) == false) && (hasVanished() == true);
+}
+
 /**
  * \brief Populates the ranges by creating \c VPage objects.
  *
@@ -425,20 +962,12 @@ size_t Process::populateMixedRange(const CmdOptions &cmd_opts) {
  * process' pagemap file. The number of created page objects is returned.
  */
 size_t Process::populatePages(const CmdOptions &cmd_opts) {
+  TraceSpan span("Process::populatePages", "pid", process_id);
   // Store the format flags for clog
-  std::ios_base::fmtflags original_clog_flags = std::clog.flags();
-  // Open the file. We will do this on a very basic level...
-  // The file contains an 64bit entry for each virtual page. So that value can
-  // be perfectly stored in an uint64_t.
-  int pagemap_file_fd = open(pagemap_filepath.c_str(), O_RDONLY);
-  if (pagemap_file_fd == -1) {
-    std::cerr << "Could not open pagemap file " << pagemap_filepath << std::endl;
-    perror("open:");
+  std::ios_base::fmtflags original_clog_flags = logs().flags();
+  if (openPageMapFile(cmd_opts) == false) {
     return 0;
   }
-  if (cmd_opts.cmd_verbose == true) {
-    std::clog << "Opened pagemap file for process " << process_id << std::endl;
-  }
   // Now populate all ranges
   size_t num_pages = 0;
   for (VPageRange &cur_vp_range : vp_ranges) {
@@ -446,18 +975,132 @@ size_t Process::populatePages(const CmdOptions &cmd_opts) {
     if (cur_vp_range.getMappingType() == VPageRange::MappingType::Unmapped) {
       continue;
     }
-    // We want to make sure to close the file although an exception was thrown
-    try {
-      size_t cur_created_pages = cur_vp_range.populatePages(pagemap_file_fd, cmd_opts);
-      num_pages = num_pages + cur_created_pages;
-    } catch(...) {
-      close(pagemap_file_fd);
-      throw;
+    cur_vp_range.setPageArena(page_arena);
+    size_t cur_created_pages = cur_vp_range.populatePages(pagemap_fd, cmd_opts);
+    num_pages = num_pages + cur_created_pages;
+    if (isAddressSpaceGone(cur_vp_range) == true) {
+      accessible = false;
+      break;
     }
   }
-  close(pagemap_file_fd);
 
-  // Restore format flags of clog
-  std::clog.flags(original_clog_flags);
+  // Restore format flags of clog. They are only changed in verbose mode and
+  // restoring them unconditionally would race with other scanning threads.
+  if (cmd_opts.cmd_verbose == true) {
+    logs().flags(original_clog_flags);
+  }
+  return num_pages;
+}
+
+/**
+ * \brief Makes the process take the pages of its ranges from \c arena.
+ *
+ * The arena is used for all pages populated afterwards, without an arena
+ * they are taken from the heap. The arena must outlive the process and must
+ * not be used by any other thread while the pages are populated.
+ */
+void Process::setPageArena(Arena *arena) {
+  page_arena = arena;
+}
+
+/**
+ * \brief Returns the descriptor of the open pagemap file, opening it if
+ * \brief needed.
+ *
+ * The file stays open until \c closePageMapFile() is called. Returns -1 if
+ * the process is not backed by /proc or the file cannot be opened.
+ */
+int Process::getPageMapFD(const CmdOptions &cmd_opts) {
+  if ((proc_dir_fd == -1) || (openPageMapFile(cmd_opts) == false)) {
+    return -1;
+  }
+  return pagemap_fd;
+}
+
+/**
+ * \brief Closes the pagemap file if it is still open.
+ */
+void Process::closePageMapFile(void) {
+  if (pagemap_fd != -1) {
+    ScanStats::count(ScanStats::Counter::Syscalls);
+    close(pagemap_fd);
+    pagemap_fd = -1;
+  }
+}
+
+/**
+ * \brief Indicates if the files of the process could be read the last time.
+ *
+ * Becomes \c false as soon as reading the maps or pagemap file failed, e.g.
+ * because the process exited.
+ */
+bool Process::isAccessible(void) const {
+  return accessible;
+}
+
+/**
+ * \brief Clears the soft-dirty bits of all pages of the process.
+ *
+ * Writes "4" to the process' clear_refs file. Afterwards the soft-dirty bit
+ * of a page is only set again if the page is written to. Returns \c true on
+ * success.
+ */
+bool Process::clearSoftDirtyBits(void) const {
+  const std::string clear_refs_filepath(proc_root + "/" + process_id + "/clear_refs");
+  const int clear_refs_fd = openat(proc_dir_fd, "clear_refs", O_WRONLY | O_CLOEXEC);
+  if (clear_refs_fd == -1) {
+    errs() << "Could not open clear_refs file " << clear_refs_filepath << std::endl;
+    printSystemError("open:");
+    return false;
+  }
+  const char clear_soft_dirty[] = "4";
+  if (write(clear_refs_fd, clear_soft_dirty, 1) != 1) {
+    errs() << "Could not clear soft-dirty bits of process " << process_id << std::endl;
+    printSystemError("write:");
+    close(clear_refs_fd);
+    return false;
+  }
+  close(clear_refs_fd);
+  return true;
+}
+
+/**
+ * \brief Populates a window of the pages of a single range.
+ * \param range_pos The position of the range in \c getVPageRanges().
+ *
+ * Only the pages \c first_page to \c first_page + \c max_pages - 1 of the
+ * range are created. The pages of any other window of the range are
+ * discarded. Returns the number of created pages.
+ */
+size_t Process::populateRangePages(const CmdOptions &cmd_opts, size_t range_pos,
+    uint64_t first_page, uint64_t max_pages) {
+  if ((range_pos >= vp_ranges.size()) || (openPageMapFile(cmd_opts) == false)) {
+    return 0;
+  }
+  vp_ranges[range_pos].setPageArena(page_arena);
+  const size_t num_pages = vp_ranges[range_pos].populatePages(pagemap_fd,
+      cmd_opts, first_page, max_pages);
+  if (isAddressSpaceGone(vp_ranges[range_pos]) == true) {
+    accessible = false;
+  }
   return num_pages;
 }
+
+/**
+ * \brief Discards the pages of a single range and frees their memory.
+ */
+void Process::releaseRangePages(size_t range_pos) {
+  if (range_pos < vp_ranges.size()) {
+    vp_ranges[range_pos].releaseVPages();
+  }
+}
+
+/**
+ * \brief Discards all ranges and the cached maps file and frees their
+ * \brief memory.
+ */
+void Process::releaseFileRanges(void) {
+  VPR_List_Ty().swap(vp_ranges);
+  range_index.clear();
+  std::string().swap(maps_content);
+}
@@ -0,0 +1,158 @@
+//===- ReverseMap.cpp -----------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "ReverseMap.h"
+#include "ProcScan.h"
+#include "Stats.h"
+
+#include <limits>
+
+FrameSet::FrameSet(const CmdOptions::FR_List_Ty &ranges)
+ : frame_ranges(ranges), first_frame(1), last_frame(0) {
+  if (frame_ranges.empty() == true) {
+    return;
+  }
+  // Merge overlapping and adjacent ranges
+  std::sort(frame_ranges.begin(), frame_ranges.end());
+  size_t num_merged = 1;
+  for (size_t i = 1, e = frame_ranges.size(); i < e; ++i) {
+    std::pair<uint64_t, uint64_t> &prev_range = frame_ranges[num_merged - 1];
+    if ((prev_range.second == std::numeric_limits<uint64_t>::max())
+     || (frame_ranges[i].first <= prev_range.second + 1)) {
+      prev_range.second = std::max(prev_range.second, frame_ranges[i].second);
+    } else {
+      frame_ranges[num_merged++] = frame_ranges[i];
+    }
+  }
+  frame_ranges.resize(num_merged);
+  first_frame = frame_ranges.front().first;
+  last_frame = frame_ranges.back().second;
+
+  if (last_frame - first_frame < max_bitmap_frames) {
+    frame_bitmap.assign((last_frame - first_frame) / 64 + 1, 0);
+    for (const std::pair<uint64_t, uint64_t> &cur_range : frame_ranges) {
+      for (uint64_t bit_no = cur_range.first - first_frame;
+          bit_no <= cur_range.second - first_frame; ++bit_no) {
+        frame_bitmap[bit_no / 64] |= 1ULL << (bit_no % 64);
+      }
+    }
+  }
+}
+
+/**
+ * \brief Returns the number of frames in the set.
+ */
+uint64_t FrameSet::size(void) const {
+  uint64_t num_frames = 0;
+  for (const std::pair<uint64_t, uint64_t> &cur_range : frame_ranges) {
+    num_frames += cur_range.second - cur_range.first + 1;
+  }
+  return num_frames;
+}
+
+FrameMapping::FrameMapping(uint32_t processno, const RawPage &page)
+ : frame_no(page.getFrameNumber()), process_no(processno),
+   vpage(page.address), vp_range(page.vp_range) {
+  vpage.setRawPageProperties(page.page_word, true);
+}
+
+bool FrameMapping::operator<(const FrameMapping &other) const {
+  if (frame_no != other.frame_no) {
+    return frame_no < other.frame_no;
+  }
+  if (process_no != other.process_no) {
+    return process_no < other.process_no;
+  }
+  return vpage.getStartAddress() < other.vpage.getStartAddress();
+}
+
+ReverseLookup::ReverseLookup(void) : hidden_pages(0) {
+}
+
+/**
+ * \brief Returns the number of distinct frames that are mapped.
+ */
+size_t ReverseLookup::getNumFrames(void) const {
+  size_t num_frames = 0;
+  for (size_t i = 0, e = frame_mappings.size(); i < e; ++i) {
+    if ((i == 0) || (frame_mappings[i].frame_no != frame_mappings[i - 1].frame_no)) {
+      ++num_frames;
+    }
+  }
+  return num_frames;
+}
+
+/**
+ * \brief Returns the number of distinct processes mapping any of the frames.
+ */
+size_t ReverseLookup::getNumProcesses(void) const {
+  std::vector<uint32_t> process_nos;
+  process_nos.reserve(frame_mappings.size());
+  for (const FrameMapping &cur_mapping : frame_mappings) {
+    process_nos.push_back(cur_mapping.process_no);
+  }
+  std::sort(process_nos.begin(), process_nos.end());
+  return std::unique(process_nos.begin(), process_nos.end()) - process_nos.begin();
+}
+
+/**
+ * \brief Finds all pages of the given processes that map one of the frames
+ * \brief in \c cmd_frame_ranges.
+ *
+ * The ranges of all processes are created and their pagemap entries are
+ * decoded by several worker threads. The frame filter is applied to every
+ * entry during the decoding, so no page objects are created except for the
+ * matching pages. Afterwards only the processes with matching pages keep
+ * their ranges, as the mappings refer to them.
+ */
+ReverseLookup lookupFrames(const CmdOptions &cmd_opts,
+    std::vector<Process> &processes) {
+  const FrameSet frame_set(cmd_opts.cmd_frame_ranges);
+  {
+    ScanStats::PhaseTimer timer(ScanStats::Phase::MapsParsing);
+    runParallel(cmd_opts, processes.size(), [&cmd_opts, &processes](size_t i) {
+      processes[i].populateFileRanges(cmd_opts);
+    });
+  }
+
+  std::vector<std::vector<FrameMapping> > process_mappings(processes.size());
+  std::vector<uint64_t> process_hidden_pages(processes.size(), 0);
+  {
+    ScanStats::PhaseTimer timer(ScanStats::Phase::PagemapReads);
+    runParallel(cmd_opts, processes.size(),
+        [&cmd_opts, &processes, &frame_set, &process_mappings,
+         &process_hidden_pages](size_t i) {
+          if (processes[i].isAccessible() == false) {
+            return;
+          }
+          std::vector<FrameMapping> &cur_mappings = process_mappings[i];
+          uint64_t &cur_hidden_pages = process_hidden_pages[i];
+          auto consumer = [i, &cur_mappings, &cur_hidden_pages](const RawPage &page) {
+            if (page.getFrameNumber() == 0) {
+              ++cur_hidden_pages;
+            } else {
+              cur_mappings.push_back(FrameMapping(static_cast<uint32_t>(i), page));
+            }
+          };
+          visitPages(cmd_opts, processes[i], AnyRange(),
+              OrPredicate<FrameSetPage, HiddenFramePage>(FrameSetPage(frame_set),
+                                                         HiddenFramePage()),
+              consumer);
+          // Keeping the files of all processes open could exhaust the
+          // descriptors
+          processes[i].closePageMapFile();
+          if (cur_mappings.empty() == true) {
+            processes[i].releaseFileRanges();
+          }
+        });
+  }
+
+  ReverseLookup lookup;
+  for (size_t i = 0, e = processes.size(); i < e; ++i) {
+    lookup.frame_mappings.insert(lookup.frame_mappings.end(),
+        process_mappings[i].begin(), process_mappings[i].end());
+    lookup.hidden_pages += process_hidden_pages[i];
+  }
+  std::sort(lookup.frame_mappings.begin(), lookup.frame_mappings.end());
+  return lookup;
+}
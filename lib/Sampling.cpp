@@ -0,0 +1,210 @@
+//===- Sampling.cpp -------------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "Sampling.h"
+#include "Stats.h"
+#include "Trace.h"
+#include "Translate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+// Quantile of the standard normal distribution for 95% confidence intervals
+static const double confidence_z = 1.96;
+
+ProportionEstimate::ProportionEstimate(void)
+ : hits(0), sampled(0), population(0) {
+}
+
+double ProportionEstimate::getFraction(void) const {
+  if (sampled == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(hits) / sampled;
+}
+
+/**
+ * \brief Computes the bounds of the 95% confidence interval of the fraction.
+ */
+void ProportionEstimate::getInterval(double &lower, double &upper) const {
+  if (sampled == 0) {
+    lower = 0.0;
+    upper = 1.0;
+    return;
+  }
+  const double fraction = getFraction();
+  if (sampled >= population) {
+    // All pages were sampled so the fraction is exact
+    lower = fraction;
+    upper = fraction;
+    return;
+  }
+  // The finite population correction scales the variance by (N-n)/(N-1)
+  // which is the same as using a larger effective sample size
+  const double n = static_cast<double>(sampled)
+      * (static_cast<double>(population) - 1.0) / (population - sampled);
+  const double z2 = confidence_z * confidence_z;
+  const double denominator = 1.0 + z2 / n;
+  const double center = (fraction + z2 / (2.0 * n)) / denominator;
+  const double half_width = (confidence_z / denominator)
+      * std::sqrt(fraction * (1.0 - fraction) / n + z2 / (4.0 * n * n));
+  lower = std::max(0.0, center - half_width);
+  upper = std::min(1.0, center + half_width);
+}
+
+RangeSample::RangeSample(const VPageRange &range)
+ : vp_range(&range), sampled_pages(0) {
+}
+
+ProcessSample::ProcessSample(const std::string &pid)
+ : process_id(pid), sampled_pages(0), total_pages(0) {
+}
+
+/**
+ * \brief Chooses the indices of the pages to sample from a range.
+ * \param num_pages The number of pages of the range.
+ * \param sample_size The number of pages to sample.
+ * \param strided Take every k-th page starting at a random page instead of
+ * a simple random sample.
+ *
+ * The returned indices are sorted in ascending order. If the range has at
+ * most \c sample_size pages all of them are returned.
+ */
+std::vector<uint64_t> choosePageSample(uint64_t num_pages, uint64_t sample_size,
+    bool strided, std::mt19937_64 &generator) {
+  std::vector<uint64_t> indices;
+  if (sample_size >= num_pages) {
+    indices.resize(num_pages);
+    for (uint64_t i = 0; i < num_pages; ++i) {
+      indices[i] = i;
+    }
+    return indices;
+  }
+  indices.reserve(sample_size);
+  if (strided == true) {
+    const double stride = static_cast<double>(num_pages) / sample_size;
+    const double start = std::uniform_real_distribution<double>(0.0, stride)(generator);
+    for (uint64_t i = 0; i < sample_size; ++i) {
+      indices.push_back(std::min<uint64_t>(
+          static_cast<uint64_t>(start + i * stride), num_pages - 1));
+    }
+    return indices;
+  }
+  // Floyd's algorithm draws sample_size distinct indices with as many
+  // random numbers, independent of the size of the range
+  std::unordered_set<uint64_t> chosen;
+  chosen.reserve(sample_size);
+  for (uint64_t j = num_pages - sample_size; j < num_pages; ++j) {
+    const uint64_t cur_index = std::uniform_int_distribution<uint64_t>(0, j)(generator);
+    if (chosen.insert(cur_index).second == true) {
+      indices.push_back(cur_index);
+    } else {
+      chosen.insert(j);
+      indices.push_back(j);
+    }
+  }
+  std::sort(indices.begin(), indices.end());
+  return indices;
+}
+
+/**
+ * \brief Estimates the page statistics of all mapped ranges of a process.
+ *
+ * The ranges of the process must already be populated (but not their
+ * pages). Of each range \c cmd_sample_size pages are sampled. Only the
+ * pagemap entries of the sampled pages and the frames of the sampled
+ * resident pages are read, so the costs do not depend on the size of the
+ * ranges. The dirty and THP flags are taken from the frames and can only be
+ * determined if the frame flags are readable. So only the non-resident pages
+ * and the resident pages with valid frame flags are sampled for them.
+ */
+ProcessSample sampleProcess(const CmdOptions &cmd_opts, const Process &proc,
+    std::mt19937_64 &generator) {
+  TraceSpan span("sampleProcess", "pid", proc.getPID());
+  ProcessSample proc_sample(proc.getPID());
+  std::vector<TranslationRequest> requests;
+  for (const VPageRange &cur_vpr : proc.getVPageRanges()) {
+    if (cur_vpr.getMappingType() == VPageRange::MappingType::Unmapped) {
+      continue;
+    }
+    const std::vector<uint64_t> indices = choosePageSample(cur_vpr.num(),
+        cmd_opts.cmd_sample_size, cmd_opts.cmd_sample_strided, generator);
+    for (uint64_t cur_index : indices) {
+      requests.push_back(TranslationRequest(proc.getPID(),
+          cur_vpr.getFirstAddress() + cur_index * cur_vpr.getPageSize()));
+    }
+    RangeSample cur_range_sample(cur_vpr);
+    cur_range_sample.sampled_pages = indices.size();
+    proc_sample.range_samples.push_back(cur_range_sample);
+    proc_sample.sampled_pages += indices.size();
+    proc_sample.total_pages += cur_vpr.num();
+  }
+
+  // The sampled pages are read like translation requests
+  std::vector<AddressTranslation> translations;
+  {
+    ScanStats::PhaseTimer timer(ScanStats::Phase::PagemapReads);
+    AddressTranslator translator(cmd_opts.cmd_proc_root);
+    translations = translator.translate(requests);
+  }
+  std::vector<uint64_t> frames;
+  for (const AddressTranslation &cur_translation : translations) {
+    if ((cur_translation.status == AddressTranslation::Status::Translated)
+     && (cur_translation.vpage.isPresentRAM() == true)
+     && (cur_translation.vpage.getFrameNumber() != 0)) {
+      frames.push_back(cur_translation.vpage.getFrameNumber());
+    }
+  }
+  std::sort(frames.begin(), frames.end());
+  frames.erase(std::unique(frames.begin(), frames.end()), frames.end());
+  PMemory pmem;
+  if (frames.empty() == false) {
+    ScanStats::PhaseTimer timer(ScanStats::Phase::FrameReads);
+    pmem.addPFrames(cmd_opts, frames.begin(), frames.end());
+  }
+
+  // The translations are in the order of the ranges
+  std::vector<AddressTranslation>::const_iterator translation_it =
+      translations.begin();
+  for (RangeSample &cur_range_sample : proc_sample.range_samples) {
+    ProportionEstimate *estimates[] = {&cur_range_sample.resident,
+        &cur_range_sample.swapped, &cur_range_sample.dirty, &cur_range_sample.thp};
+    for (ProportionEstimate *cur_estimate : estimates) {
+      cur_estimate->population = cur_range_sample.vp_range->num();
+    }
+    for (uint64_t i = 0; i < cur_range_sample.sampled_pages; ++i, ++translation_it) {
+      if (translation_it->status != AddressTranslation::Status::Translated) {
+        continue;
+      }
+      ++cur_range_sample.resident.sampled;
+      ++cur_range_sample.swapped.sampled;
+      const VPage &cur_vpage = translation_it->vpage;
+      if (cur_vpage.isPresentSwap() == true) {
+        ++cur_range_sample.swapped.hits;
+      }
+      if (cur_vpage.isPresentRAM() == false) {
+        // Pages which are not resident are neither dirty nor THPs
+        ++cur_range_sample.dirty.sampled;
+        ++cur_range_sample.thp.sampled;
+        continue;
+      }
+      ++cur_range_sample.resident.hits;
+      const PMemory::PF_Map_Ty::const_iterator cur_pframe_iter =
+          pmem.getPFrameMap().find(cur_vpage.getFrameNumber());
+      if ((cur_pframe_iter == pmem.getPFrameMap().end())
+       || (cur_pframe_iter->second.areFramePropertiesValid() == false)) {
+        continue;
+      }
+      ++cur_range_sample.dirty.sampled;
+      ++cur_range_sample.thp.sampled;
+      if (cur_pframe_iter->second.isDirty() == true) {
+        ++cur_range_sample.dirty.hits;
+      }
+      if (cur_pframe_iter->second.isTHP() == true) {
+        ++cur_range_sample.thp.hits;
+      }
+    }
+  }
+  return proc_sample;
+}
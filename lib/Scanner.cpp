@@ -0,0 +1,555 @@
+//===- Scanner.cpp --------------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "Scanner.h"
+#include "Budget.h"
+#include "Diagnostics.h"
+#include "ProcScan.h"
+#include "Snapshot.h"
+#include "Stats.h"
+#include "Translate.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+/**
+ * \brief Collects the frame numbers of all present pages of the processes.
+ *
+ * Unmapped ranges and pages without valid properties are skipped. The
+ * returned list may contain the same frame several times.
+ */
+std::vector<uint64_t> collectFrameNumbers(const std::vector<Process> &processes) {
+  std::vector<uint64_t> reqd_frames;
+  for (const Process &cur_proc : processes) {
+    for (const VPageRange &cur_vpr : cur_proc.getVPageRanges()) {
+      // Skip unmapped ranges as they should not require any valid frames
+      if (cur_vpr.getMappingType() == VPageRange::MappingType::Unmapped) {
+        continue;
+      }
+
+      for (const VPage &cur_vpage : cur_vpr.getVPages()) {
+        if (cur_vpage.arePagePropertiesValid() == false) {
+          continue;
+        }
+        // Only present pages map to a valid frame
+        if (cur_vpage.isPresentRAM() == false) {
+          continue;
+        }
+        if (cur_vpage.getFrameNumber() == 0) {
+          continue;
+        }
+        // Page maps to a frame so add its frame to the list of required frames
+        reqd_frames.push_back(cur_vpage.getFrameNumber());
+      }
+    }
+  }
+  return reqd_frames;
+}
+
+ScanResult::ScanResult(void)
+ : mode(ScanMode::Pages), pmem(createArena()), swap_layout(0),
+   write_interval(0.0) {
+}
+
+/**
+ * \brief Creates an arena that is released with the result.
+ */
+Arena* ScanResult::createArena(void) {
+  arenas.push_back(std::unique_ptr<Arena>(new Arena()));
+  return arenas.back().get();
+}
+
+/**
+ * \brief Returns the number of bytes reserved by all arenas of the result.
+ */
+uint64_t ScanResult::getReservedBytes(void) const {
+  uint64_t reserved_bytes = 0;
+  for (const std::unique_ptr<Arena> &cur_arena : arenas) {
+    reserved_bytes += cur_arena->getReservedBytes();
+  }
+  return reserved_bytes;
+}
+
+//===- Scanner class ------------------------------------------------------===//
+
+Scanner::Scanner(const CmdOptions &opts)
+ : cmd_opts(opts) {
+}
+
+/**
+ * \brief Returns the options of the scanner. After a snapshot was loaded the
+ * \brief program mode is the one of the snapshot.
+ */
+const CmdOptions& Scanner::getOptions(void) const {
+  return cmd_opts;
+}
+
+/**
+ * \brief Determines the kind of scan selected by the options.
+ *
+ * A loaded snapshot only provides the ranges, pages and frames, so the modes
+ * that need live processes are not considered then.
+ */
+ScanMode Scanner::getMode(void) const {
+  if (cmd_opts.cmd_diff_path.empty() == false) {
+    return ScanMode::Diff;
+  }
+  if (cmd_opts.cmd_translate == true) {
+    return ScanMode::Translate;
+  }
+  if (cmd_opts.cmd_fragmentation == true) {
+    return ScanMode::Fragmentation;
+  }
+  if (cmd_opts.cmd_load_path.empty() == true) {
+    if (cmd_opts.cmd_sample_size > 0) {
+      return ScanMode::Sample;
+    }
+    if (cmd_opts.cmd_watch_interval > 0.0) {
+      return ScanMode::Watch;
+    }
+    if (cmd_opts.cmd_softdirty_interval > 0.0) {
+      return ScanMode::SoftDirty;
+    }
+    if (cmd_opts.cmd_max_mem > 0) {
+      return ScanMode::Budget;
+    }
+    if (cmd_opts.cmd_content == true) {
+      return ScanMode::Content;
+    }
+    if (cmd_opts.cmd_frame_ranges.empty() == false) {
+      return ScanMode::FrameLookup;
+    }
+  }
+  if (cmd_opts.cmd_swap == true) {
+    return ScanMode::Swap;
+  }
+  if (cmd_opts.cmd_contiguity == true) {
+    return ScanMode::Contiguity;
+  }
+  if ((cmd_opts.cmd_save_path.empty() == false)
+   && (cmd_opts.cmd_load_path.empty() == true)) {
+    return ScanMode::Save;
+  }
+  if (cmd_opts.cmd_files == true) {
+    return ScanMode::Files;
+  }
+  return ScanMode::Pages;
+}
+
+/**
+ * \brief Creates the process objects of all selected processes.
+ *
+ * Either all processes of the system or the requested process ids are
+ * filtered by the selection options. Returns \c false if no process is left
+ * or the selection options could not be applied.
+ */
+bool Scanner::selectProcesses(std::vector<Process> &processes) {
+  ScanStats::PhaseTimer timer(ScanStats::Phase::PIDValidation);
+  try {
+    const ProcessSelector selector(cmd_opts);
+    if (cmd_opts.cmd_all_processes == true) {
+      cmd_opts.cmd_req_pid = enumeratePIDs(cmd_opts, selector);
+    } else {
+      selectPIDs(cmd_opts, selector, cmd_opts.cmd_req_pid);
+    }
+  } catch(const std::invalid_argument &inv_arg_exc) {
+    errs() << inv_arg_exc.what() << std::endl;
+    return false;
+  }
+  // Validate pids and create process objects
+  processes = createProcesses(cmd_opts);
+  if (processes.empty() == true) {
+    errs() << "No pids to process!" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * \brief Creates the process objects of the result.
+ *
+ * Each process takes its pages from an arena of its own, so the processes
+ * can be read by several threads without sharing an arena.
+ */
+bool Scanner::selectProcesses(ScanResult &result) {
+  if (selectProcesses(result.processes) == false) {
+    return false;
+  }
+  for (Process &cur_proc : result.processes) {
+    cur_proc.setPageArena(result.createArena());
+  }
+  return true;
+}
+
+/**
+ * \brief Reads the ranges and pages of the given processes.
+ *
+ * Processes that could not be read are removed. Returns the number of
+ * remaining processes.
+ */
+size_t Scanner::populateProcesses(std::vector<Process> &processes) const {
+  return ::populateProcesses(cmd_opts, processes);
+}
+
+/**
+ * \brief Reads the frames of all present pages of the processes into
+ * \brief \c pmem. Returns the number of added frames.
+ */
+size_t Scanner::loadFrames(const std::vector<Process> &processes,
+    PMemory &pmem) const {
+  std::vector<uint64_t> reqd_frames;
+  {
+    ScanStats::PhaseTimer timer(ScanStats::Phase::FrameCollection);
+    reqd_frames = collectFrameNumbers(processes);
+  }
+  ScanStats::PhaseTimer timer(ScanStats::Phase::FrameReads);
+  return pmem.addPFrames(cmd_opts, reqd_frames.begin(), reqd_frames.end());
+}
+
+/**
+ * \brief Reads the ranges and pages of the selected processes and, if
+ * \brief requested, the frames of all present pages.
+ *
+ * If a snapshot is given it replaces all information otherwise read from
+ * /proc. Returns \c false if no process could be selected or the snapshot
+ * could not be read.
+ */
+bool Scanner::readPages(ScanResult &result, bool with_frames) {
+  if (cmd_opts.cmd_load_path.empty() == false) {
+    return loadSnapshot(result);
+  }
+  if (selectProcesses(result) == false) {
+    return false;
+  }
+  populateProcesses(result.processes);
+  if (with_frames == true) {
+    loadFrames(result.processes, result.pmem);
+  }
+  return true;
+}
+
+/**
+ * \brief Restores the processes and frames of the snapshot given by
+ * \brief \c cmd_load_path. The program mode is taken from the snapshot.
+ */
+bool Scanner::loadSnapshot(ScanResult &result) {
+  try {
+    Snapshot snapshot(cmd_opts.cmd_load_path);
+    cmd_opts.cmd_prog_mode =
+        static_cast<CmdOptions::ProgMode>(snapshot.getHeader().prog_mode);
+    snapshot.materialize(result.processes, result.pmem);
+  } catch(const std::invalid_argument &inv_arg_exc) {
+    errs() << inv_arg_exc.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * \brief Runs the whole scan pipeline.
+ *
+ * Selects the processes, reads their ranges and pages and the frames of all
+ * present pages. Returns \c false if no process could be selected.
+ */
+bool Scanner::scan(ScanResult &result) {
+  return readPages(result, true);
+}
+
+/**
+ * \brief Scans the processes and writes them to the snapshot file given by
+ * \brief \c cmd_save_path. Returns \c false if the file could not be written.
+ */
+bool Scanner::captureSnapshot(ScanResult &result) {
+  if (scan(result) == false) {
+    return false;
+  }
+  // Writing the snapshot replaces printing the results
+  ScanStats::PhaseTimer timer(ScanStats::Phase::Output);
+  return saveSnapshot(cmd_opts, cmd_opts.cmd_save_path, result.processes,
+                      result.pmem);
+}
+
+bool Scanner::analyzeFiles(ScanResult &result) {
+  if (scan(result) == false) {
+    return false;
+  }
+  result.file_usages = computeFileUsage(result.processes, result.pmem);
+  return true;
+}
+
+/**
+ * \brief Analyzes the swap layout. Only the pages are read, no frames.
+ */
+bool Scanner::analyzeSwap(ScanResult &result) {
+  if (readPages(result, false) == false) {
+    return false;
+  }
+  result.swap_layout = ::analyzeSwap(cmd_opts, result.processes);
+  return true;
+}
+
+/**
+ * \brief Analyzes the physical contiguity. Only the pages are read, no
+ * \brief frames.
+ */
+bool Scanner::analyzeContiguity(ScanResult &result) {
+  if (readPages(result, false) == false) {
+    return false;
+  }
+  result.contiguities = computeContiguity(result.processes);
+  return true;
+}
+
+/**
+ * \brief Finds the pages mapping the frames in \c cmd_frame_ranges.
+ *
+ * Only the pages mapping one of the frames are kept and only the frames
+ * that are mapped are read.
+ */
+bool Scanner::lookupFrames(ScanResult &result) {
+  if (selectProcesses(result) == false) {
+    return false;
+  }
+  result.frame_lookup = ::lookupFrames(cmd_opts, result.processes);
+  const ReverseLookup &lookup = result.frame_lookup;
+  if ((lookup.frame_mappings.empty() == true) && (lookup.hidden_pages > 0)) {
+    errs() << "The frame numbers of " << lookup.hidden_pages
+           << " present pages are hidden, run lsmmap as root!" << std::endl;
+  }
+  std::vector<uint64_t> mapped_frames;
+  for (const FrameMapping &cur_mapping : lookup.frame_mappings) {
+    if ((mapped_frames.empty() == true)
+     || (mapped_frames.back() != cur_mapping.frame_no)) {
+      mapped_frames.push_back(cur_mapping.frame_no);
+    }
+  }
+  ScanStats::PhaseTimer timer(ScanStats::Phase::FrameReads);
+  result.pmem.addPFrames(cmd_opts, mapped_frames.begin(), mapped_frames.end());
+  return true;
+}
+
+/**
+ * \brief Reads and compares the contents of the resident anonymous pages.
+ */
+bool Scanner::analyzeContent(ScanResult &result) {
+  if (selectProcesses(result) == false) {
+    return false;
+  }
+  populateProcesses(result.processes);
+  ScanStats::PhaseTimer timer(ScanStats::Phase::ContentReads);
+  result.contents = ::analyzeContent(cmd_opts, result.processes);
+  return true;
+}
+
+/**
+ * \brief Reads only a random subset of the pages of each range.
+ */
+bool Scanner::sampleProcesses(ScanResult &result) {
+  if (selectProcesses(result) == false) {
+    return false;
+  }
+  std::mt19937_64 generator(std::random_device{}());
+  for (Process &cur_proc : result.processes) {
+    {
+      ScanStats::PhaseTimer timer(ScanStats::Phase::MapsParsing);
+      cur_proc.populateFileRanges(cmd_opts);
+    }
+    if (cur_proc.isAccessible() == true) {
+      result.samples.push_back(sampleProcess(cmd_opts, cur_proc, generator));
+    }
+  }
+  return true;
+}
+
+/**
+ * \brief Determines the pages written to within the soft-dirty interval.
+ *
+ * The soft-dirty bits of all processes are cleared and the pages are read
+ * after the interval. Only the processes whose bits could be cleared are
+ * kept and only the frames of the written pages are read.
+ */
+bool Scanner::trackWrites(ScanResult &result) {
+  std::vector<Process> processes;
+  if (selectProcesses(processes) == false) {
+    return false;
+  }
+  for (Process &cur_proc : processes) {
+    cur_proc.populateFileRanges(cmd_opts);
+    if (cur_proc.clearSoftDirtyBits() == true) {
+      result.processes.push_back(std::move(cur_proc));
+    }
+  }
+  const std::chrono::steady_clock::time_point cleared_at =
+      std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::microseconds(
+      static_cast<long long>(cmd_opts.cmd_softdirty_interval * 1000000.0)));
+  for (Process &cur_proc : result.processes) {
+    cur_proc.setPageArena(result.createArena());
+    cur_proc.refreshFileRanges(cmd_opts);
+    cur_proc.populatePages(cmd_opts);
+    result.write_sets.push_back(computeWriteSet(cur_proc));
+  }
+  result.write_interval = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - cleared_at).count();
+  // Frames are only read for the pages that were written to
+  std::vector<uint64_t> written_frames;
+  for (const ProcessWriteSet &cur_write_set : result.write_sets) {
+    for (const RangeWriteSet &cur_range_set : cur_write_set.range_write_sets) {
+      for (const VPage &cur_vpage : cur_range_set.vp_range->getVPages()) {
+        if ((cur_vpage.arePagePropertiesValid() == true)
+         && (cur_vpage.isSoftDirty() == true)
+         && (cur_vpage.isPresentRAM() == true)
+         && (cur_vpage.getFrameNumber() != 0)) {
+          written_frames.push_back(cur_vpage.getFrameNumber());
+        }
+      }
+    }
+  }
+  std::sort(written_frames.begin(), written_frames.end());
+  written_frames.erase(std::unique(written_frames.begin(), written_frames.end()),
+                       written_frames.end());
+  if (cmd_opts.cmd_only_vpranges == false) {
+    ScanStats::PhaseTimer timer(ScanStats::Phase::FrameReads);
+    result.pmem.addPFrames(cmd_opts, written_frames.begin(), written_frames.end());
+  }
+  return true;
+}
+
+/**
+ * \brief Counts the free blocks of each memory zone. No process is read.
+ */
+bool Scanner::scanFragmentation(ScanResult &result) {
+  result.zones = readZones(cmd_opts);
+  ScanStats::PhaseTimer timer(ScanStats::Phase::FrameReads);
+  return scanFreeBlocks(cmd_opts, result.zones);
+}
+
+/**
+ * \brief Compares the snapshot given by \c cmd_diff_path with the newer one
+ * \brief given by \c cmd_load_path.
+ */
+bool Scanner::diffSnapshots(ScanResult &result) {
+  try {
+    Snapshot old_snapshot(cmd_opts.cmd_diff_path);
+    Snapshot new_snapshot(cmd_opts.cmd_load_path);
+    result.proc_diffs = ::diffSnapshots(old_snapshot, new_snapshot,
+        cmd_opts.cmd_only_vpranges == false);
+  } catch(const std::invalid_argument &inv_arg_exc) {
+    errs() << inv_arg_exc.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * \brief Runs the scan of the mode selected by the options.
+ *
+ * The results are stored in \c result, which also records the mode. The
+ * streaming modes cannot be run this way. Returns \c false if the scan
+ * failed.
+ */
+bool Scanner::run(ScanResult &result) {
+  result.mode = getMode();
+  bool scanned = false;
+  switch (result.mode) {
+    case ScanMode::Save:
+      scanned = captureSnapshot(result);
+      break;
+    case ScanMode::Files:
+      scanned = analyzeFiles(result);
+      break;
+    case ScanMode::Swap:
+      scanned = analyzeSwap(result);
+      break;
+    case ScanMode::Contiguity:
+      scanned = analyzeContiguity(result);
+      break;
+    case ScanMode::FrameLookup:
+      scanned = lookupFrames(result);
+      break;
+    case ScanMode::Content:
+      scanned = analyzeContent(result);
+      break;
+    case ScanMode::Sample:
+      scanned = sampleProcesses(result);
+      break;
+    case ScanMode::SoftDirty:
+      scanned = trackWrites(result);
+      break;
+    case ScanMode::Fragmentation:
+      scanned = scanFragmentation(result);
+      break;
+    case ScanMode::Diff:
+      scanned = diffSnapshots(result);
+      break;
+    case ScanMode::Translate:
+    case ScanMode::Watch:
+    case ScanMode::Budget:
+      errs() << "The results of this mode are only streamed!" << std::endl;
+      return false;
+    case ScanMode::Pages:
+      scanned = scan(result);
+      break;
+  }
+  ScanStats::recordArenaBytes(result.getReservedBytes());
+  return scanned;
+}
+
+//===- Streaming modes ----------------------------------------------------===//
+
+/**
+ * \brief Answers the translation requests read from \c requests.
+ *
+ * Each answer is written to \c answers as soon as its batch of requests is
+ * translated. Returns \c false if any request could not be parsed.
+ */
+bool Scanner::translate(std::istream &requests, std::ostream &answers) {
+  return translateAddresses(cmd_opts, requests, answers);
+}
+
+/**
+ * \brief Rescans the selected processes periodically until all of them
+ * \brief exited.
+ *
+ * The deltas of each scan are handed to \c consumer together with the time
+ * of the scan in seconds since the epoch.
+ */
+bool Scanner::watch(const WatchConsumer_Ty &consumer) {
+  std::vector<Process> processes;
+  if (selectProcesses(processes) == false) {
+    return false;
+  }
+  const std::chrono::microseconds interval(
+      static_cast<long long>(cmd_opts.cmd_watch_interval * 1000000.0));
+  Watcher watcher(std::move(processes));
+  std::chrono::steady_clock::time_point next_scan = std::chrono::steady_clock::now();
+  while (watcher.empty() == false) {
+    const PDelta_List_Ty deltas = watcher.update(cmd_opts);
+    const double timestamp = std::chrono::duration<double>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    consumer(timestamp, deltas);
+    next_scan += interval;
+    std::this_thread::sleep_until(next_scan);
+  }
+  return true;
+}
+
+/**
+ * \brief Prints the selected processes within the memory budget given by
+ * \brief \c cmd_max_mem.
+ *
+ * The pages are printed window by window while they are read, so they are
+ * never held in memory at once. Returns \c false if the pages of any process
+ * had to be omitted.
+ */
+bool Scanner::scanWithinBudget(std::ostream &stream) {
+  std::vector<Process> processes;
+  if (selectProcesses(processes) == false) {
+    return false;
+  }
+  MemoryBudget budget(cmd_opts.cmd_max_mem);
+  return printResultsWithinBudget(cmd_opts, stream, processes, budget);
+}
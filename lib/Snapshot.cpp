@@ -0,0 +1,516 @@
+//===- Snapshot.cpp -------------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "Snapshot.h"
+#include "Diagnostics.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+/**
+ * \brief Rounds the given offset up to the next multiple of 8.
+ */
+static uint64_t alignSnapshotOffset(uint64_t offset) {
+  return (offset + 7) & (~static_cast<uint64_t>(7));
+}
+
+/**
+ * This class collects the data written to the snapshot file in a large buffer
+ * so that the file is written with only a few system calls.
+ */
+class SnapshotWriter {
+private:
+  int fd;
+  std::vector<char> buffer;
+  size_t buffer_used;
+  uint64_t written_bytes;
+  bool failed;
+
+public:
+  SnapshotWriter(int out_fd)
+   : fd(out_fd), buffer(1 << 20), buffer_used(0), written_bytes(0),
+     failed(false) {
+  }
+
+  bool flush(void) {
+    size_t flushed = 0;
+    while ((failed == false) && (flushed < buffer_used)) {
+      ssize_t cur_written = write(fd, buffer.data() + flushed,
+                                  buffer_used - flushed);
+      if (cur_written == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+        printSystemError("write:");
+        failed = true;
+        break;
+      }
+      flushed += cur_written;
+    }
+    buffer_used = 0;
+    return (failed == false);
+  }
+
+  void append(const void *data, size_t length) {
+    const char *data_bytes = static_cast<const char*>(data);
+    while (length > 0) {
+      if (buffer_used == buffer.size()) {
+        flush();
+      }
+      const size_t cur_length = std::min(length, buffer.size() - buffer_used);
+      memcpy(buffer.data() + buffer_used, data_bytes, cur_length);
+      buffer_used += cur_length;
+      written_bytes += cur_length;
+      data_bytes += cur_length;
+      length -= cur_length;
+    }
+  }
+
+  void pad(void) {
+    static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    const uint64_t aligned = alignSnapshotOffset(written_bytes);
+    append(zeros, aligned - written_bytes);
+  }
+
+  uint64_t getWrittenBytes(void) const {
+    return written_bytes;
+  }
+
+  bool hasFailed(void) const {
+    return failed;
+  }
+};
+
+/**
+ * \brief Saves processes, their ranges and pages and the frames to a file.
+ * \param path The path of the snapshot file to create.
+ *
+ * Writes all collected information into a single snapshot file. The file is
+ * first written to a temporary file next to \c path and then renamed so a
+ * reader never observes a partially written snapshot. Returns \c true on
+ * success.
+ */
+bool saveSnapshot(const CmdOptions &cmd_opts, const std::string &path,
+    const std::vector<Process> &processes, const PMemory &pmem) {
+  // First determine the size of all sections
+  SnapshotHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+  header.version = snapshot_version;
+  header.header_size = sizeof(SnapshotHeader);
+  header.byte_order = snapshot_byte_order;
+  header.page_size = sysconf(_SC_PAGESIZE);
+  header.prog_mode = static_cast<uint64_t>(cmd_opts.cmd_prog_mode);
+  header.capture_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  header.num_processes = processes.size();
+  for (const Process &cur_proc : processes) {
+    header.strings_size += cur_proc.getPID().size();
+    header.num_ranges += cur_proc.getVPageRanges().size();
+    for (const VPageRange &cur_vpr : cur_proc.getVPageRanges()) {
+      header.num_pages += cur_vpr.getVPages().size();
+      header.strings_size += cur_vpr.getMappedFilePath().size();
+    }
+  }
+  header.num_frames = pmem.getPFrameMap().size();
+  header.processes_offset = alignSnapshotOffset(sizeof(SnapshotHeader));
+  header.ranges_offset = header.processes_offset
+                       + header.num_processes * sizeof(SnapshotProcess);
+  header.pages_offset = header.ranges_offset
+                      + header.num_ranges * sizeof(SnapshotRange);
+  header.valid_offset = header.pages_offset
+                      + header.num_pages * sizeof(uint64_t);
+  header.frames_offset = header.valid_offset
+                       + ((header.num_pages + 63) / 64) * sizeof(uint64_t);
+  header.strings_offset = header.frames_offset
+                        + header.num_frames * sizeof(SnapshotFrame);
+  header.file_size = alignSnapshotOffset(header.strings_offset
+                                         + header.strings_size);
+
+  const std::string tmp_path(path + ".tmp");
+  const int snapshot_fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (snapshot_fd == -1) {
+    errs() << "Could not create snapshot file " << tmp_path << std::endl;
+    printSystemError("open:");
+    return false;
+  }
+  if (cmd_opts.cmd_verbose == true) {
+    logs() << "Writing snapshot with " << header.num_processes
+              << " processes, " << header.num_ranges << " ranges, "
+              << header.num_pages << " pages and " << header.num_frames
+              << " frames." << std::endl;
+  }
+
+  SnapshotWriter writer(snapshot_fd);
+  writer.append(&header, sizeof(header));
+  writer.pad();
+  // The process and range records
+  uint64_t cur_string_offset = 0;
+  uint64_t cur_range_no = 0;
+  for (const Process &cur_proc : processes) {
+    SnapshotProcess cur_record;
+    memset(&cur_record, 0, sizeof(cur_record));
+    cur_record.pid_offset = cur_string_offset;
+    cur_record.pid_length = cur_proc.getPID().size();
+    cur_record.first_range = cur_range_no;
+    cur_record.num_ranges = cur_proc.getVPageRanges().size();
+    writer.append(&cur_record, sizeof(cur_record));
+    cur_string_offset += cur_record.pid_length;
+    cur_range_no += cur_record.num_ranges;
+    for (const VPageRange &cur_vpr : cur_proc.getVPageRanges()) {
+      cur_string_offset += cur_vpr.getMappedFilePath().size();
+    }
+  }
+  cur_string_offset = 0;
+  uint64_t cur_page_no = 0;
+  for (const Process &cur_proc : processes) {
+    cur_string_offset += cur_proc.getPID().size();
+    for (const VPageRange &cur_vpr : cur_proc.getVPageRanges()) {
+      SnapshotRange cur_record;
+      memset(&cur_record, 0, sizeof(cur_record));
+      cur_record.first_address = cur_vpr.getFirstAddress();
+      cur_record.next_address = cur_vpr.getNextAddress();
+      cur_record.map_offset = cur_vpr.getMappingOffset();
+      cur_record.first_page = cur_page_no;
+      cur_record.num_pages = cur_vpr.getVPages().size();
+      cur_record.path_offset = cur_string_offset;
+      cur_record.path_length = cur_vpr.getMappedFilePath().size();
+      cur_record.range_no = cur_vpr.getVPRangeNumber();
+      cur_record.map_ty = static_cast<uint8_t>(cur_vpr.getMappingType());
+      cur_record.perm_canread = static_cast<uint8_t>(cur_vpr.canRead());
+      cur_record.perm_canwrite = static_cast<uint8_t>(cur_vpr.canWrite());
+      cur_record.perm_canexec = static_cast<uint8_t>(cur_vpr.canExec());
+      cur_record.perm_isprivate = static_cast<uint8_t>(cur_vpr.isPrivate());
+      writer.append(&cur_record, sizeof(cur_record));
+      cur_string_offset += cur_record.path_length;
+      cur_page_no += cur_record.num_pages;
+    }
+  }
+  // The raw page words
+  for (const Process &cur_proc : processes) {
+    for (const VPageRange &cur_vpr : cur_proc.getVPageRanges()) {
+      for (const VPage &cur_vpage : cur_vpr.getVPages()) {
+        const uint64_t cur_word = cur_vpage.getRawPageProperties();
+        writer.append(&cur_word, sizeof(cur_word));
+      }
+    }
+  }
+  // The validity bitmap of the pages
+  uint64_t cur_valid_word = 0;
+  unsigned cur_valid_bit = 0;
+  for (const Process &cur_proc : processes) {
+    for (const VPageRange &cur_vpr : cur_proc.getVPageRanges()) {
+      for (const VPage &cur_vpage : cur_vpr.getVPages()) {
+        if (cur_vpage.arePagePropertiesValid() == true) {
+          cur_valid_word |= (static_cast<uint64_t>(1) << cur_valid_bit);
+        }
+        if (++cur_valid_bit == 64) {
+          writer.append(&cur_valid_word, sizeof(cur_valid_word));
+          cur_valid_word = 0;
+          cur_valid_bit = 0;
+        }
+      }
+    }
+  }
+  if (cur_valid_bit != 0) {
+    writer.append(&cur_valid_word, sizeof(cur_valid_word));
+  }
+  // The frames (the map is already ordered by frame number)
+  for (const PMemory::PF_Map_Ty::value_type &cur_entry : pmem.getPFrameMap()) {
+    SnapshotFrame cur_record;
+    cur_record.frame_no = cur_entry.first;
+    cur_record.frame_props = cur_entry.second.getRawFrameProperties();
+    cur_record.frame_refcount = cur_entry.second.getFrameRefCount();
+    cur_record.frame_props_valid = cur_entry.second.areFramePropertiesValid();
+    writer.append(&cur_record, sizeof(cur_record));
+  }
+  // And finally the strings
+  for (const Process &cur_proc : processes) {
+    writer.append(cur_proc.getPID().data(), cur_proc.getPID().size());
+    for (const VPageRange &cur_vpr : cur_proc.getVPageRanges()) {
+      const std::string &cur_path = cur_vpr.getMappedFilePath();
+      writer.append(cur_path.data(), cur_path.size());
+    }
+  }
+  writer.pad();
+  writer.flush();
+  close(snapshot_fd);
+
+  if ((writer.hasFailed() == true)
+   || (writer.getWrittenBytes() != header.file_size)) {
+    errs() << "Could not write snapshot file " << tmp_path << std::endl;
+    unlink(tmp_path.c_str());
+    return false;
+  }
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    errs() << "Could not rename snapshot file to " << path << std::endl;
+    printSystemError("rename:");
+    unlink(tmp_path.c_str());
+    return false;
+  }
+  if (cmd_opts.cmd_verbose == true) {
+    logs() << "Wrote " << header.file_size << " bytes to snapshot file "
+              << path << std::endl;
+  }
+  return true;
+}
+
+//===- Snapshot class -----------------------------------------------------===//
+
+/**
+ * \brief Checks that a section of \c count records of \c size bytes each
+ * \brief starting at \c offset is aligned and ends at or before \c limit.
+ *
+ * The check cannot overflow, no matter which values a corrupted header holds.
+ */
+static bool isSectionValid(uint64_t offset, uint64_t count, uint64_t size,
+    uint64_t limit) {
+  return (alignSnapshotOffset(offset) == offset) && (offset <= limit)
+      && (count <= (limit - offset) / size);
+}
+
+/**
+ * \brief Opens the given snapshot file and maps it into memory.
+ * \param path The path to the snapshot file.
+ *
+ * The CTOR throws a \c std::invalid_argument exception if the file cannot be
+ * mapped or if it is not a valid snapshot of a supported version.
+ */
+Snapshot::Snapshot(const std::string &path)
+ : snapshot_fd(-1), mapped_data(nullptr), mapped_size(0), header(nullptr) {
+  snapshot_fd = open(path.c_str(), O_RDONLY);
+  if (snapshot_fd == -1) {
+    throw std::invalid_argument("Could not open snapshot file " + path);
+  }
+  struct stat snapshot_stat;
+  if ((fstat(snapshot_fd, &snapshot_stat) != 0)
+   || (static_cast<uint64_t>(snapshot_stat.st_size) < sizeof(SnapshotHeader))) {
+    close(snapshot_fd);
+    throw std::invalid_argument("Snapshot file " + path + " is too small");
+  }
+  mapped_size = snapshot_stat.st_size;
+  void *mapping = mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED,
+                       snapshot_fd, 0);
+  if (mapping == MAP_FAILED) {
+    close(snapshot_fd);
+    throw std::invalid_argument("Could not map snapshot file " + path);
+  }
+  mapped_data = static_cast<const char*>(mapping);
+  header = reinterpret_cast<const SnapshotHeader*>(mapped_data);
+
+  // Validate the header before anybody relies on the offsets
+  std::string error;
+  if (memcmp(header->magic, snapshot_magic, sizeof(snapshot_magic)) != 0) {
+    error = "is not a snapshot file";
+  } else if (header->version != snapshot_version) {
+    error = "has an unsupported version";
+  } else if (header->byte_order != snapshot_byte_order) {
+    error = "was captured on a host with a different byte order";
+  } else if ((header->header_size != sizeof(SnapshotHeader))
+          || (header->file_size != mapped_size)
+          || (header->page_size == 0)
+          || ((header->page_size & (header->page_size - 1)) != 0)
+          || (header->processes_offset < sizeof(SnapshotHeader))
+          // Every section must end before the next one starts
+          || (isSectionValid(header->processes_offset, header->num_processes,
+                             sizeof(SnapshotProcess), header->ranges_offset) == false)
+          || (isSectionValid(header->ranges_offset, header->num_ranges,
+                             sizeof(SnapshotRange), header->pages_offset) == false)
+          || (isSectionValid(header->pages_offset, header->num_pages,
+                             sizeof(uint64_t), header->valid_offset) == false)
+          || (isSectionValid(header->valid_offset, header->num_pages / 64
+                             + (((header->num_pages % 64) != 0) ? 1 : 0),
+                             sizeof(uint64_t), header->frames_offset) == false)
+          || (isSectionValid(header->frames_offset, header->num_frames,
+                             sizeof(SnapshotFrame), header->strings_offset) == false)
+          || (isSectionValid(header->strings_offset, header->strings_size, 1,
+                             mapped_size) == false)) {
+    error = "is truncated or corrupted";
+  }
+  if (error.empty() == false) {
+    munmap(const_cast<char*>(mapped_data), mapped_size);
+    close(snapshot_fd);
+    throw std::invalid_argument("Snapshot file " + path + " " + error);
+  }
+  // The data is read sequentially when materialized
+  madvise(const_cast<char*>(mapped_data), mapped_size, MADV_SEQUENTIAL);
+}
+
+Snapshot::~Snapshot(void) {
+  if (mapped_data != nullptr) {
+    munmap(const_cast<char*>(mapped_data), mapped_size);
+  }
+  if (snapshot_fd != -1) {
+    close(snapshot_fd);
+  }
+}
+
+const SnapshotHeader& Snapshot::getHeader(void) const {
+  return *header;
+}
+
+const SnapshotProcess* Snapshot::getProcesses(void) const {
+  return reinterpret_cast<const SnapshotProcess*>(
+      mapped_data + header->processes_offset);
+}
+
+const SnapshotRange* Snapshot::getRanges(void) const {
+  return reinterpret_cast<const SnapshotRange*>(
+      mapped_data + header->ranges_offset);
+}
+
+/**
+ * \brief Returns the raw pagemap entries of all pages.
+ *
+ * The pages of all ranges of all processes are stored consecutively. The pages
+ * of a range start at the index given by \c SnapshotRange::first_page.
+ */
+const uint64_t* Snapshot::getPageWords(void) const {
+  return reinterpret_cast<const uint64_t*>(mapped_data + header->pages_offset);
+}
+
+bool Snapshot::isPageValid(uint64_t page_no) const {
+  const uint64_t *valid_words = reinterpret_cast<const uint64_t*>(
+      mapped_data + header->valid_offset);
+  return ((valid_words[page_no / 64] >> (page_no % 64)) & 1) != 0;
+}
+
+const SnapshotFrame* Snapshot::getFrames(void) const {
+  return reinterpret_cast<const SnapshotFrame*>(
+      mapped_data + header->frames_offset);
+}
+
+/**
+ * \brief Looks up the frame with the given number.
+ *
+ * Returns a pointer to the frame record or \c nullptr if the snapshot does not
+ * contain such a frame. As the frames are sorted a binary search is used.
+ */
+const SnapshotFrame* Snapshot::findFrame(uint64_t frame_no) const {
+  const SnapshotFrame *frames_begin = getFrames();
+  const SnapshotFrame *frames_end = frames_begin + header->num_frames;
+  const SnapshotFrame *found = std::lower_bound(frames_begin, frames_end,
+      frame_no, [](const SnapshotFrame &lhs, uint64_t rhs) {
+        return (lhs.frame_no < rhs);
+      });
+  if ((found == frames_end) || (found->frame_no != frame_no)) {
+    return nullptr;
+  }
+  return found;
+}
+
+/**
+ * \brief Checks that the ranges of a process record lie within the ranges
+ * \brief section.
+ */
+bool Snapshot::isProcessRecordValid(const SnapshotProcess &record) const {
+  return (record.first_range <= header->num_ranges)
+      && (record.num_ranges <= header->num_ranges - record.first_range);
+}
+
+/**
+ * \brief Checks that the pages of a range record lie within the pages
+ * \brief section.
+ */
+bool Snapshot::isRangeRecordValid(const SnapshotRange &record) const {
+  return (record.first_page <= header->num_pages)
+      && (record.num_pages <= header->num_pages - record.first_page);
+}
+
+std::string Snapshot::getString(uint64_t offset, uint64_t length) const {
+  if ((offset > header->strings_size) || (length > header->strings_size - offset)) {
+    return std::string();
+  }
+  return std::string(mapped_data + header->strings_offset + offset, length);
+}
+
+/**
+ * \brief Creates a page range object from a range record.
+ *
+ * The returned range carries all properties of the record but no pages.
+ */
+VPageRange Snapshot::makeVPageRange(const SnapshotRange &record) const {
+  VPageRange vp_range(record.first_address, record.next_address,
+                      header->page_size);
+  vp_range.setMappingType(static_cast<VPageRange::MappingType>(record.map_ty));
+  vp_range.setMappedFilePath(getString(record.path_offset, record.path_length));
+  vp_range.setMappingOffset(record.map_offset);
+  vp_range.setReadP(static_cast<VPageRange::TriState>(record.perm_canread));
+  vp_range.setWriteP(static_cast<VPageRange::TriState>(record.perm_canwrite));
+  vp_range.setExecP(static_cast<VPageRange::TriState>(record.perm_canexec));
+  vp_range.setPrivateS(static_cast<VPageRange::TriState>(record.perm_isprivate));
+  vp_range.setVPRangeNumber(record.range_no);
+  return vp_range;
+}
+
+/**
+ * \brief Recreates the process and frame objects stored in the snapshot.
+ * \param processes The vector the restored processes are appended to.
+ * \param pmem The memory the restored frames are added to.
+ *
+ * Returns the number of restored processes.
+ */
+size_t Snapshot::materialize(std::vector<Process> &processes,
+    PMemory &pmem) const {
+  const SnapshotProcess *proc_records = getProcesses();
+  const SnapshotRange *range_records = getRanges();
+  const uint64_t *page_words = getPageWords();
+  const long page_size = header->page_size;
+
+  for (uint64_t i = 0; i < header->num_processes; ++i) {
+    const SnapshotProcess &cur_proc_record = proc_records[i];
+    if (isProcessRecordValid(cur_proc_record) == false) {
+      errs() << "Skipping corrupted process record " << i << std::endl;
+      continue;
+    }
+    Process::VPR_List_Ty cur_ranges;
+    cur_ranges.reserve(cur_proc_record.num_ranges);
+    for (uint64_t j = 0; j < cur_proc_record.num_ranges; ++j) {
+      const SnapshotRange &cur_record =
+          range_records[cur_proc_record.first_range + j];
+      if (isRangeRecordValid(cur_record) == false) {
+        errs() << "Skipping corrupted range record " << j << std::endl;
+        continue;
+      }
+      VPageRange cur_range(makeVPageRange(cur_record));
+
+      VPageRange::VP_List_Ty cur_pages;
+      cur_pages.reserve(cur_record.num_pages);
+      uint64_t cur_addr = cur_record.first_address & (~(page_size - 1));
+      for (uint64_t k = 0; k < cur_record.num_pages; ++k) {
+        const uint64_t cur_page_no = cur_record.first_page + k;
+        VPage cur_page(cur_addr);
+        cur_page.setRawPageProperties(page_words[cur_page_no],
+                                      isPageValid(cur_page_no));
+        cur_pages.push_back(cur_page);
+        cur_addr += page_size;
+      }
+      cur_range.setVPages(std::move(cur_pages));
+      cur_ranges.push_back(std::move(cur_range));
+    }
+    processes.emplace_back(getString(cur_proc_record.pid_offset,
+                                     cur_proc_record.pid_length),
+                           std::move(cur_ranges));
+  }
+
+  const SnapshotFrame *frame_records = getFrames();
+  for (uint64_t i = 0; i < header->num_frames; ++i) {
+    const SnapshotFrame &cur_record = frame_records[i];
+    PFrame cur_frame(cur_record.frame_no * page_size);
+    cur_frame.setRawFrameProperties(cur_record.frame_props,
+                                    cur_record.frame_refcount,
+                                    cur_record.frame_props_valid != 0);
+    pmem.insertPFrame(cur_record.frame_no, cur_frame);
+  }
+  return header->num_processes;
+}
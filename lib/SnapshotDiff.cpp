@@ -0,0 +1,339 @@
+//===- SnapshotDiff.cpp ---------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "SnapshotDiff.h"
+#include "Diagnostics.h"
+
+#include <map>
+
+PageChange::PageChange(uint64_t pageaddress)
+ : address(pageaddress), old_page_word(0), new_page_word(0),
+   old_page_valid(false), new_page_valid(false), changes(0) {
+}
+
+//===- RangeDiff class ----------------------------------------------------===//
+
+RangeDiff::RangeDiff(Status rangestatus, const VPageRange &range)
+ : status(rangestatus), vp_range(range) {
+  for (unsigned i = 0; i < PageChange::num_change_kinds; ++i) {
+    change_counts[i] = 0;
+  }
+}
+
+/**
+ * \brief Indicates if the range was added, removed or contains changed pages.
+ */
+bool RangeDiff::hasChanges(void) const {
+  if (status != Status::Kept) {
+    return true;
+  }
+  for (unsigned i = 0; i < PageChange::num_change_kinds; ++i) {
+    if (change_counts[i] != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * \brief Returns the number of pages in the range that show the given change.
+ */
+uint64_t RangeDiff::getChangeCount(PageChange::ChangeKind kind) const {
+  for (unsigned i = 0; i < PageChange::num_change_kinds; ++i) {
+    if ((1u << i) == static_cast<unsigned>(kind)) {
+      return change_counts[i];
+    }
+  }
+  return 0;
+}
+
+/**
+ * \brief Adds the changes of one page to the counters of the range.
+ * \param keep_page If \c true the change is also stored to be listed later.
+ */
+void RangeDiff::addPageChange(const PageChange &change, bool keep_page) {
+  for (unsigned i = 0; i < PageChange::num_change_kinds; ++i) {
+    if ((change.changes & (1u << i)) != 0) {
+      ++change_counts[i];
+    }
+  }
+  if (keep_page == true) {
+    page_changes.push_back(change);
+  }
+}
+
+ProcessDiff::ProcessDiff(Status procstatus, const std::string &pid)
+ : status(procstatus), process_id(pid) {
+}
+
+//===- Diff computation ---------------------------------------------------===//
+
+/**
+ * This class walks over all pages of one process stored in a snapshot in
+ * ascending address order. Ranges without pages (e.g. unmapped ranges) are
+ * skipped.
+ */
+class SnapshotPageCursor {
+private:
+  const Snapshot &snapshot;
+  const SnapshotRange *ranges;
+  uint64_t num_ranges;
+  uint64_t cur_range;
+  uint64_t cur_page;
+
+  void skipEmptyRanges(void) {
+    while ((cur_range < num_ranges) && (cur_page >= ranges[cur_range].num_pages)) {
+      ++cur_range;
+      cur_page = 0;
+    }
+  }
+
+public:
+  SnapshotPageCursor(const Snapshot &snap, const SnapshotProcess &proc)
+   : snapshot(snap), ranges(snap.getRanges() + proc.first_range),
+     num_ranges(proc.num_ranges), cur_range(0), cur_page(0) {
+    skipEmptyRanges();
+  }
+
+  bool atEnd(void) const {
+    return (cur_range >= num_ranges);
+  }
+
+  uint64_t getRangeIndex(void) const {
+    return cur_range;
+  }
+
+  uint64_t getAddress(void) const {
+    const uint64_t page_size = snapshot.getHeader().page_size;
+    return (ranges[cur_range].first_address & (~(page_size - 1)))
+         + cur_page * page_size;
+  }
+
+  uint64_t getPageWord(void) const {
+    return snapshot.getPageWords()[ranges[cur_range].first_page + cur_page];
+  }
+
+  bool isPageValid(void) const {
+    return snapshot.isPageValid(ranges[cur_range].first_page + cur_page);
+  }
+
+  void advance(void) {
+    ++cur_page;
+    skipEmptyRanges();
+  }
+};
+
+/**
+ * \brief Determines the changes of a page that exists in both snapshots.
+ */
+static unsigned comparePages(const Snapshot &old_snapshot,
+    const Snapshot &new_snapshot, const PageChange &change) {
+  VPage old_page(change.address), new_page(change.address);
+  old_page.setRawPageProperties(change.old_page_word, change.old_page_valid);
+  new_page.setRawPageProperties(change.new_page_word, change.new_page_valid);
+  if ((old_page.arePagePropertiesValid() == false)
+   || (new_page.arePagePropertiesValid() == false)) {
+    return 0;
+  }
+
+  unsigned changes = 0;
+  if (old_page.isPresentRAM() == false) {
+    if (new_page.isPresentRAM() == true) {
+      changes |= PageChange::NewlyResident;
+    }
+    return changes;
+  }
+  if (new_page.isPresentRAM() == false) {
+    if (new_page.isPresentSwap() == true) {
+      changes |= PageChange::SwappedOut;
+    } else {
+      changes |= PageChange::Dropped;
+    }
+    return changes;
+  }
+  // The page is resident in both snapshots
+  if ((old_page.getFrameNumber() != 0) && (new_page.getFrameNumber() != 0)
+   && (old_page.getFrameNumber() != new_page.getFrameNumber())) {
+    changes |= PageChange::FrameChanged;
+  }
+  const SnapshotFrame *old_record = old_snapshot.findFrame(old_page.getFrameNumber());
+  const SnapshotFrame *new_record = new_snapshot.findFrame(new_page.getFrameNumber());
+  if ((old_record == nullptr) || (new_record == nullptr)
+   || (old_record->frame_props_valid == 0) || (new_record->frame_props_valid == 0)) {
+    return changes;
+  }
+  PFrame old_frame(0), new_frame(0);
+  old_frame.setRawFrameProperties(old_record->frame_props,
+                                  old_record->frame_refcount, true);
+  new_frame.setRawFrameProperties(new_record->frame_props,
+                                  new_record->frame_refcount, true);
+  if ((old_frame.isDirty() == false) && (new_frame.isDirty() == true)) {
+    changes |= PageChange::BecameDirty;
+  } else if ((old_frame.isDirty() == true) && (new_frame.isDirty() == false)) {
+    changes |= PageChange::BecameClean;
+  }
+  if ((old_frame.isInActiveLRU() == false) && (new_frame.isInActiveLRU() == true)) {
+    changes |= PageChange::BecameActive;
+  } else if ((old_frame.isInActiveLRU() == true) && (new_frame.isInActiveLRU() == false)) {
+    changes |= PageChange::BecameInactive;
+  }
+  return changes;
+}
+
+/**
+ * \brief Indicates if a page word describes a page that is in RAM or swap.
+ */
+static bool isPageWordUsed(uint64_t page_word, bool valid) {
+  VPage page(0);
+  page.setRawPageProperties(page_word, valid);
+  return (page.arePagePropertiesValid() == true)
+      && ((page.isPresentRAM() == true) || (page.isPresentSwap() == true));
+}
+
+/**
+ * \brief Computes the differences of one process found in both snapshots.
+ */
+static void diffProcess(const Snapshot &old_snapshot,
+    const SnapshotProcess &old_proc, const Snapshot &new_snapshot,
+    const SnapshotProcess &new_proc, bool keep_pages, ProcessDiff &proc_diff) {
+  const SnapshotRange *old_ranges = old_snapshot.getRanges() + old_proc.first_range;
+  const SnapshotRange *new_ranges = new_snapshot.getRanges() + new_proc.first_range;
+  // Maps from the range indices of both snapshots to the range diffs
+  std::vector<size_t> old_range_diff(old_proc.num_ranges);
+  std::vector<size_t> new_range_diff(new_proc.num_ranges);
+
+  // First merge the ranges. Both lists are sorted by their address.
+  uint64_t i = 0, j = 0;
+  while ((i < old_proc.num_ranges) || (j < new_proc.num_ranges)) {
+    if ((i < old_proc.num_ranges) && (j < new_proc.num_ranges)
+     && (old_ranges[i].first_address == new_ranges[j].first_address)
+     && (old_ranges[i].next_address == new_ranges[j].next_address)
+     && (old_ranges[i].map_ty == new_ranges[j].map_ty)) {
+      old_range_diff[i] = proc_diff.range_diffs.size();
+      new_range_diff[j] = proc_diff.range_diffs.size();
+      proc_diff.range_diffs.push_back(RangeDiff(RangeDiff::Status::Kept,
+          new_snapshot.makeVPageRange(new_ranges[j])));
+      ++i; ++j;
+    } else if ((j >= new_proc.num_ranges)
+            || ((i < old_proc.num_ranges)
+             && ((old_ranges[i].first_address < new_ranges[j].first_address)
+              || ((old_ranges[i].first_address == new_ranges[j].first_address)
+               && (old_ranges[i].next_address <= new_ranges[j].next_address))))) {
+      old_range_diff[i] = proc_diff.range_diffs.size();
+      proc_diff.range_diffs.push_back(RangeDiff(RangeDiff::Status::Removed,
+          old_snapshot.makeVPageRange(old_ranges[i])));
+      ++i;
+    } else {
+      new_range_diff[j] = proc_diff.range_diffs.size();
+      proc_diff.range_diffs.push_back(RangeDiff(RangeDiff::Status::Added,
+          new_snapshot.makeVPageRange(new_ranges[j])));
+      ++j;
+    }
+  }
+
+  // Now merge the pages of both snapshots. The page arrays of both snapshots
+  // are sorted by address so a single linear pass is sufficient.
+  SnapshotPageCursor old_cursor(old_snapshot, old_proc);
+  SnapshotPageCursor new_cursor(new_snapshot, new_proc);
+  while ((old_cursor.atEnd() == false) || (new_cursor.atEnd() == false)) {
+    if ((old_cursor.atEnd() == false) && (new_cursor.atEnd() == false)
+     && (old_cursor.getAddress() == new_cursor.getAddress())) {
+      PageChange cur_change(new_cursor.getAddress());
+      cur_change.old_page_word = old_cursor.getPageWord();
+      cur_change.old_page_valid = old_cursor.isPageValid();
+      cur_change.new_page_word = new_cursor.getPageWord();
+      cur_change.new_page_valid = new_cursor.isPageValid();
+      cur_change.changes = comparePages(old_snapshot, new_snapshot, cur_change);
+      if (cur_change.changes != 0) {
+        proc_diff.range_diffs[new_range_diff[new_cursor.getRangeIndex()]]
+            .addPageChange(cur_change, keep_pages);
+      }
+      old_cursor.advance();
+      new_cursor.advance();
+    } else if ((new_cursor.atEnd() == true)
+            || ((old_cursor.atEnd() == false)
+             && (old_cursor.getAddress() < new_cursor.getAddress()))) {
+      // The page only exists in the old snapshot
+      if (isPageWordUsed(old_cursor.getPageWord(), old_cursor.isPageValid()) == true) {
+        PageChange cur_change(old_cursor.getAddress());
+        cur_change.old_page_word = old_cursor.getPageWord();
+        cur_change.old_page_valid = old_cursor.isPageValid();
+        cur_change.changes = PageChange::PageRemoved;
+        proc_diff.range_diffs[old_range_diff[old_cursor.getRangeIndex()]]
+            .addPageChange(cur_change, keep_pages);
+      }
+      old_cursor.advance();
+    } else {
+      // The page only exists in the new snapshot
+      if (isPageWordUsed(new_cursor.getPageWord(), new_cursor.isPageValid()) == true) {
+        PageChange cur_change(new_cursor.getAddress());
+        cur_change.new_page_word = new_cursor.getPageWord();
+        cur_change.new_page_valid = new_cursor.isPageValid();
+        cur_change.changes = PageChange::PageAdded;
+        proc_diff.range_diffs[new_range_diff[new_cursor.getRangeIndex()]]
+            .addPageChange(cur_change, keep_pages);
+      }
+      new_cursor.advance();
+    }
+  }
+}
+
+/**
+ * \brief Checks that a process record and all of its range records can be
+ * \brief used. Corrupted processes are reported and skipped.
+ */
+static bool isProcessUsable(const Snapshot &snapshot, uint64_t proc_no) {
+  const SnapshotProcess &proc = snapshot.getProcesses()[proc_no];
+  bool usable = snapshot.isProcessRecordValid(proc);
+  for (uint64_t i = 0; (usable == true) && (i < proc.num_ranges); ++i) {
+    usable = snapshot.isRangeRecordValid(snapshot.getRanges()[proc.first_range + i]);
+  }
+  if (usable == false) {
+    errs() << "Skipping corrupted process record " << proc_no << std::endl;
+  }
+  return usable;
+}
+
+/**
+ * \brief Computes the differences between two snapshots.
+ * \param keep_pages If \c true every changed page is stored in the result.
+ *
+ * Processes are matched by their process id. Ranges are matched if their
+ * boundaries and their mapping type are identical. Pages are matched by their
+ * address independent of the range they belong to.
+ */
+PD_List_Ty diffSnapshots(const Snapshot &old_snapshot,
+    const Snapshot &new_snapshot, bool keep_pages) {
+  PD_List_Ty proc_diffs;
+  const SnapshotProcess *old_procs = old_snapshot.getProcesses();
+  const SnapshotProcess *new_procs = new_snapshot.getProcesses();
+
+  std::map<std::string, uint64_t> old_proc_indices;
+  for (uint64_t i = 0; i < old_snapshot.getHeader().num_processes; ++i) {
+    if (isProcessUsable(old_snapshot, i) == false) {
+      continue;
+    }
+    old_proc_indices.insert(std::make_pair(old_snapshot.getString(
+        old_procs[i].pid_offset, old_procs[i].pid_length), i));
+  }
+  for (uint64_t i = 0; i < new_snapshot.getHeader().num_processes; ++i) {
+    if (isProcessUsable(new_snapshot, i) == false) {
+      continue;
+    }
+    const std::string cur_pid(new_snapshot.getString(new_procs[i].pid_offset,
+                                                     new_procs[i].pid_length));
+    std::map<std::string, uint64_t>::iterator old_it = old_proc_indices.find(cur_pid);
+    if (old_it == old_proc_indices.end()) {
+      proc_diffs.push_back(ProcessDiff(ProcessDiff::Status::Added, cur_pid));
+      continue;
+    }
+    proc_diffs.push_back(ProcessDiff(ProcessDiff::Status::Kept, cur_pid));
+    diffProcess(old_snapshot, old_procs[old_it->second], new_snapshot,
+                new_procs[i], keep_pages, proc_diffs.back());
+    old_proc_indices.erase(old_it);
+  }
+  for (const std::map<std::string, uint64_t>::value_type &cur_entry : old_proc_indices) {
+    proc_diffs.push_back(ProcessDiff(ProcessDiff::Status::Removed, cur_entry.first));
+  }
+  return proc_diffs;
+}
@@ -0,0 +1,45 @@
+//===- SoftDirty.cpp ------------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "SoftDirty.h"
+
+RangeWriteSet::RangeWriteSet(const VPageRange &range)
+ : vp_range(&range), written_pages(0), resident_pages(0) {
+}
+
+ProcessWriteSet::ProcessWriteSet(const std::string &pid)
+ : process_id(pid), written_pages(0), written_bytes(0) {
+}
+
+/**
+ * \brief Determines the pages of a process that were written to.
+ *
+ * A page counts as written if its soft-dirty bit is set. Note that the kernel
+ * also reports all pages of ranges that were mapped after the bits were
+ * cleared as soft-dirty. Only ranges that contain written pages are part of
+ * the returned write set.
+ */
+ProcessWriteSet computeWriteSet(const Process &proc) {
+  ProcessWriteSet write_set(proc.getPID());
+  for (const VPageRange &cur_vpr : proc.getVPageRanges()) {
+    RangeWriteSet cur_range_set(cur_vpr);
+    for (const VPage &cur_vpage : cur_vpr.getVPages()) {
+      if (cur_vpage.arePagePropertiesValid() == false) {
+        continue;
+      }
+      if (cur_vpage.isPresentRAM() == true) {
+        ++cur_range_set.resident_pages;
+      }
+      if (cur_vpage.isSoftDirty() == true) {
+        ++cur_range_set.written_pages;
+      }
+    }
+    if (cur_range_set.written_pages == 0) {
+      continue;
+    }
+    write_set.written_pages += cur_range_set.written_pages;
+    write_set.written_bytes += cur_range_set.written_pages * cur_vpr.getPageSize();
+    write_set.range_write_sets.push_back(cur_range_set);
+  }
+  return write_set;
+}
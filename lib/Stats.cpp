@@ -0,0 +1,196 @@
+//===- Stats.cpp ----------------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "Stats.h"
+
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sys/resource.h>
+#include <unistd.h>
+
+std::atomic<bool> ScanStats::enabled(false);
+std::atomic<uint64_t> ScanStats::counters[ScanStats::num_counters];
+std::atomic<uint64_t> ScanStats::phase_wall_ns[ScanStats::num_phases];
+std::atomic<uint64_t> ScanStats::phase_cpu_ns[ScanStats::num_phases];
+std::atomic<uint64_t> ScanStats::budget_limit(0);
+std::atomic<uint64_t> ScanStats::budget_peak(0);
+std::atomic<uint64_t> ScanStats::budget_rss_growth(0);
+std::atomic<uint64_t> ScanStats::arena_peak(0);
+
+static const char *const phase_names[ScanStats::num_phases] = {
+  "pid_validation", "maps_parsing", "pagemap_reads", "frame_collection",
+  "frame_reads", "content_reads", "output"
+};
+
+static const char *const counter_names[ScanStats::num_counters] = {
+  "syscalls", "bytes_read", "processes", "ranges", "pages", "frames"
+};
+
+/**
+ * \brief Returns the CPU time consumed by all threads of the process.
+ */
+static uint64_t getProcessCPUTime(void) {
+  struct timespec cpu_time;
+  if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_time) != 0) {
+    return 0;
+  }
+  return static_cast<uint64_t>(cpu_time.tv_sec) * 1000000000 + cpu_time.tv_nsec;
+}
+
+//===- PhaseTimer class ---------------------------------------------------===//
+
+ScanStats::PhaseTimer::PhaseTimer(Phase timedphase)
+ : phase(timedphase), span(phase_names[static_cast<unsigned>(timedphase)]),
+   wall_start(std::chrono::steady_clock::now()),
+   cpu_start_ns(getProcessCPUTime()) {
+}
+
+ScanStats::PhaseTimer::~PhaseTimer(void) {
+  if (ScanStats::isEnabled() == false) {
+    return;
+  }
+  const uint64_t wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - wall_start).count();
+  const uint64_t cpu_ns = getProcessCPUTime() - cpu_start_ns;
+  phase_wall_ns[static_cast<unsigned>(phase)].fetch_add(wall_ns);
+  phase_cpu_ns[static_cast<unsigned>(phase)].fetch_add(cpu_ns);
+}
+
+//===- ScanStats class ----------------------------------------------------===//
+
+void ScanStats::enable(void) {
+  enabled = true;
+}
+
+bool ScanStats::isEnabled(void) {
+  return enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t ScanStats::getCounter(Counter counter) {
+  return counters[static_cast<unsigned>(counter)].load();
+}
+
+/**
+ * \brief Records the memory budget of the scan, the peak amount of memory
+ * \brief charged against it and the measured growth of the resident set.
+ *
+ * The charged amount is an estimate of the memory needed for the ranges,
+ * pages and frames. The largest growth of the resident set sampled during
+ * the scan is recorded next to it to tell how good the estimate is.
+ */
+void ScanStats::recordBudget(uint64_t limit, uint64_t peak,
+    uint64_t rss_growth) {
+  budget_limit = limit;
+  budget_peak = peak;
+  budget_rss_growth = rss_growth;
+}
+
+/**
+ * \brief Records the number of bytes reserved by the arenas of a scan. The
+ * \brief largest recorded number is printed.
+ */
+void ScanStats::recordArenaBytes(uint64_t reserved) {
+  uint64_t cur_peak = arena_peak.load();
+  while ((cur_peak < reserved)
+      && (arena_peak.compare_exchange_weak(cur_peak, reserved) == false)) {
+  }
+}
+
+/**
+ * \brief Returns the current resident set size of lsmmap in bytes as read
+ * \brief from /proc/self/statm, or 0 if it could not be read.
+ */
+uint64_t ScanStats::getResidentBytes(void) {
+  std::ifstream statm_file("/proc/self/statm");
+  uint64_t size_pages = 0;
+  uint64_t resident_pages = 0;
+  if (!(statm_file >> size_pages >> resident_pages)) {
+    return 0;
+  }
+  return resident_pages * sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * \brief Returns the peak resident set size of lsmmap in bytes, or 0 if it
+ * \brief could not be determined.
+ */
+uint64_t ScanStats::getPeakResidentBytes(void) {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  // Linux reports the peak in KiB
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+}
+
+/**
+ * \brief Prints the collected statistics.
+ * \param json Print the statistics as a JSON object instead of a table.
+ *
+ * Besides the phase times and counters the peak resident set size of lsmmap
+ * and the bytes reserved by the arenas of the scan are printed. If a memory
+ * budget was recorded its limit, the estimated peak usage and the measured
+ * peak growth of the resident set are printed as well.
+ */
+void ScanStats::print(std::ostream &stream, bool json) {
+  std::ios_base::fmtflags original_flags = stream.flags();
+  const std::streamsize original_precision = stream.precision();
+  const uint64_t peak_rss_kib = getPeakResidentBytes() / 1024;
+
+  stream << std::fixed << std::setprecision(3);
+  if (json == true) {
+    stream << "{\"phases\": {";
+    for (unsigned i = 0; i < num_phases; ++i) {
+      stream << ((i > 0) ? ", " : "") << "\"" << phase_names[i] << "\": "
+             << "{\"wall_ms\": " << (phase_wall_ns[i].load() / 1000000.0)
+             << ", \"cpu_ms\": " << (phase_cpu_ns[i].load() / 1000000.0) << "}";
+    }
+    stream << "}, \"counters\": {";
+    for (unsigned i = 0; i < num_counters; ++i) {
+      stream << ((i > 0) ? ", " : "") << "\"" << counter_names[i] << "\": "
+             << counters[i].load();
+    }
+    stream << "}, \"peak_rss_kib\": " << peak_rss_kib
+           << ", \"arena_kib\": " << (arena_peak.load() / 1024);
+    if (budget_limit.load() > 0) {
+      stream << ", \"budget\": {\"limit_bytes\": " << budget_limit.load()
+             << ", \"peak_bytes\": " << budget_peak.load()
+             << ", \"rss_growth_bytes\": " << budget_rss_growth.load() << "}";
+    }
+    stream << "}" << std::endl;
+  } else {
+    stream << std::left << std::setw(18) << "phase" << std::right
+           << std::setw(12) << "wall [ms]" << std::setw(12) << "cpu [ms]"
+           << std::endl;
+    for (unsigned i = 0; i < num_phases; ++i) {
+      stream << std::left << std::setw(18) << phase_names[i] << std::right
+             << std::setw(12) << (phase_wall_ns[i].load() / 1000000.0)
+             << std::setw(12) << (phase_cpu_ns[i].load() / 1000000.0)
+             << std::endl;
+    }
+    for (unsigned i = 0; i < num_counters; ++i) {
+      stream << std::left << std::setw(18) << counter_names[i] << std::right
+             << std::setw(12) << counters[i].load() << std::endl;
+    }
+    stream << std::left << std::setw(18) << "peak_rss [KiB]" << std::right
+           << std::setw(12) << peak_rss_kib << std::endl;
+    stream << std::left << std::setw(18) << "arena [KiB]" << std::right
+           << std::setw(12) << (arena_peak.load() / 1024) << std::endl;
+    if (budget_limit.load() > 0) {
+      stream << std::left << std::setw(18) << "budget [KiB]" << std::right
+             << std::setw(12) << (budget_limit.load() / 1024) << std::endl;
+      stream << std::left << std::setw(18) << "budget_peak [KiB]" << std::right
+             << std::setw(12) << (budget_peak.load() / 1024) << " ("
+             << std::setprecision(1)
+             << (100.0 * budget_peak.load() / budget_limit.load()) << "%)"
+             << std::endl;
+      stream << std::left << std::setw(18) << "rss_growth [KiB]" << std::right
+             << std::setw(12) << (budget_rss_growth.load() / 1024) << " ("
+             << (100.0 * budget_rss_growth.load() / budget_limit.load()) << "%)"
+             << std::endl;
+    }
+  }
+  stream.flags(original_flags);
+  stream.precision(original_precision);
+}
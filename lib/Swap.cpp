@@ -0,0 +1,243 @@
+//===- Swap.cpp -----------------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "Swap.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+// Default of vm.page-cluster if it cannot be read
+static const unsigned default_page_cluster = 3;
+// The kernel limits vm.page-cluster to this value
+static const unsigned max_page_cluster = 31;
+// Number of bits of the swap type in a cluster key
+static const unsigned swap_type_shift = 58;
+
+/**
+ * A swap slot used by a page of a process. The slots of all processes are
+ * sorted so the pages using the same slot end up next to each other.
+ */
+class SwapSlot {
+public:
+  uint64_t offset;
+  uint32_t process_no;
+  uint8_t swap_type;
+
+  SwapSlot(uint8_t swaptype, uint64_t slotoffset, uint32_t processno)
+   : offset(slotoffset), process_no(processno), swap_type(swaptype) {}
+
+  bool operator<(const SwapSlot &other) const {
+    if (swap_type != other.swap_type) {
+      return swap_type < other.swap_type;
+    }
+    if (offset != other.offset) {
+      return offset < other.offset;
+    }
+    return process_no < other.process_no;
+  }
+};
+
+RangeSwap::RangeSwap(const VPageRange &range, unsigned pagecluster)
+ : vp_range(&range), swapped_pages(0), unresolved_pages(0), num_runs(0),
+   num_seeks(0), seek_distance(0), num_reads(0), page_cluster(pagecluster) {
+}
+
+/**
+ * \brief Returns the number of slots read to fault in all swapped pages.
+ */
+uint64_t RangeSwap::getReadPages(void) const {
+  return num_reads << page_cluster;
+}
+
+double RangeSwap::getMeanRunLength(void) const {
+  return (num_runs == 0) ? 0.0 : static_cast<double>(swapped_pages) / num_runs;
+}
+
+double RangeSwap::getMeanSeekDistance(void) const {
+  return (num_seeks == 0) ? 0.0 : static_cast<double>(seek_distance) / num_seeks;
+}
+
+/**
+ * \brief Returns the number of slots read per swapped page. A value of 1
+ * \brief means that readahead only reads pages of the range.
+ */
+double RangeSwap::getReadAmplification(void) const {
+  return (swapped_pages == 0) ? 0.0
+      : static_cast<double>(getReadPages()) / swapped_pages;
+}
+
+ProcessSwap::ProcessSwap(const std::string &pid) : process_id(pid) {
+}
+
+/**
+ * \brief Returns the sum of the given counter over all ranges.
+ */
+uint64_t ProcessSwap::getCount(uint64_t RangeSwap::*counter) const {
+  uint64_t count = 0;
+  for (const RangeSwap &cur_range_swap : range_swaps) {
+    count += cur_range_swap.*counter;
+  }
+  return count;
+}
+
+uint64_t ProcessSwap::getReadPages(void) const {
+  uint64_t read_pages = 0;
+  for (const RangeSwap &cur_range_swap : range_swaps) {
+    read_pages += cur_range_swap.getReadPages();
+  }
+  return read_pages;
+}
+
+SwapDevice::SwapDevice(unsigned swaptype, const std::string &devicepath)
+ : swap_type(swaptype), device_path(devicepath), used_slots(0),
+   num_processes(0), first_slot(0), last_slot(0), num_clusters(0) {
+}
+
+SwapLayout::SwapLayout(unsigned pagecluster) : page_cluster(pagecluster) {
+}
+
+/**
+ * \brief Returns the value of vm.page-cluster, i.e. the base 2 logarithm of
+ * \brief the number of slots read at once when a page is swapped in.
+ *
+ * The value is read from the sys/vm directory of the proc root. If it is not
+ * available the default of the kernel is returned.
+ */
+unsigned readPageCluster(const CmdOptions &cmd_opts) {
+  std::ifstream cluster_file(cmd_opts.cmd_proc_root + "/sys/vm/page-cluster");
+  unsigned page_cluster = default_page_cluster;
+  if ((cluster_file >> page_cluster).fail() == true) {
+    return default_page_cluster;
+  }
+  return std::min(page_cluster, max_page_cluster);
+}
+
+/**
+ * \brief Returns the paths of the active swap devices.
+ *
+ * The devices are listed by the swaps file of the proc root in the order of
+ * their swap types, so the path of swap type \c i is at index \c i. Devices
+ * that were swapped off leave no gap in that list, in that case the paths of
+ * the later types are off.
+ */
+std::vector<std::string> readSwapDevicePaths(const CmdOptions &cmd_opts) {
+  std::vector<std::string> device_paths;
+  std::ifstream swaps_file(cmd_opts.cmd_proc_root + "/swaps");
+  std::string cur_line;
+  // The first line contains the column names
+  std::getline(swaps_file, cur_line);
+  while (std::getline(swaps_file, cur_line).good() == true) {
+    std::istringstream line_stream(cur_line);
+    std::string cur_path;
+    if ((line_stream >> cur_path).fail() == false) {
+      device_paths.push_back(cur_path);
+    }
+  }
+  return device_paths;
+}
+
+/**
+ * \brief Computes the swap layout of a single range and appends the slots of
+ * \brief its swapped pages to \c slots.
+ */
+static void computeRangeSwap(RangeSwap &range_swap, uint32_t process_no,
+    std::vector<uint64_t> &cluster_keys, std::vector<SwapSlot> &slots) {
+  cluster_keys.clear();
+  bool in_run = false;
+  uint8_t prev_type = 0;
+  uint64_t prev_offset = 0;
+  for (const VPage &cur_vpage : range_swap.vp_range->getVPages()) {
+    if ((cur_vpage.arePagePropertiesValid() == false)
+     || (cur_vpage.isPresentSwap() == false)) {
+      continue;
+    }
+    // Slot 0 holds the swap header, so offset 0 means the location is hidden
+    const uint8_t cur_type = cur_vpage.getSwapType();
+    const uint64_t cur_offset = cur_vpage.getSwapOffset();
+    if (cur_offset == 0) {
+      ++range_swap.unresolved_pages;
+      continue;
+    }
+    ++range_swap.swapped_pages;
+    if ((in_run == false) || (cur_type != prev_type)) {
+      ++range_swap.num_runs;
+    } else if (cur_offset != prev_offset + 1) {
+      ++range_swap.num_runs;
+      ++range_swap.num_seeks;
+      range_swap.seek_distance += (cur_offset > prev_offset)
+          ? (cur_offset - prev_offset) : (prev_offset - cur_offset);
+    }
+    in_run = true;
+    prev_type = cur_type;
+    prev_offset = cur_offset;
+    cluster_keys.push_back((static_cast<uint64_t>(cur_type) << swap_type_shift)
+        | (cur_offset >> range_swap.page_cluster));
+    slots.push_back(SwapSlot(cur_type, cur_offset, process_no));
+  }
+  std::sort(cluster_keys.begin(), cluster_keys.end());
+  range_swap.num_reads =
+      std::unique(cluster_keys.begin(), cluster_keys.end()) - cluster_keys.begin();
+}
+
+/**
+ * \brief Analyzes where the swapped pages of the given processes are stored.
+ *
+ * The pages must already be populated. Only ranges with swapped pages are
+ * part of the result. The reads assume the cluster based readahead of the
+ * kernel. With VMA based readahead (the default for SSDs) the pages around
+ * the faulting address are read instead, so the reads of a range are lower
+ * but scattered slots still cost a request each.
+ */
+SwapLayout analyzeSwap(const CmdOptions &cmd_opts,
+    const std::vector<Process> &processes) {
+  SwapLayout layout(readPageCluster(cmd_opts));
+  std::vector<uint64_t> cluster_keys;
+  std::vector<SwapSlot> slots;
+  for (uint32_t i = 0; i < processes.size(); ++i) {
+    ProcessSwap cur_proc_swap(processes[i].getPID());
+    for (const VPageRange &cur_vpr : processes[i].getVPageRanges()) {
+      RangeSwap cur_range_swap(cur_vpr, layout.page_cluster);
+      computeRangeSwap(cur_range_swap, i, cluster_keys, slots);
+      if ((cur_range_swap.swapped_pages > 0)
+       || (cur_range_swap.unresolved_pages > 0)) {
+        cur_proc_swap.range_swaps.push_back(cur_range_swap);
+      }
+    }
+    layout.process_swaps.push_back(std::move(cur_proc_swap));
+  }
+
+  // Count each slot of a device once and the processes using the device
+  const std::vector<std::string> device_paths = readSwapDevicePaths(cmd_opts);
+  std::sort(slots.begin(), slots.end());
+  std::vector<bool> device_processes;
+  for (size_t i = 0, e = slots.size(); i < e; ) {
+    const uint8_t cur_type = slots[i].swap_type;
+    layout.swap_devices.push_back(SwapDevice(cur_type,
+        (cur_type < device_paths.size()) ? device_paths[cur_type] : std::string()));
+    SwapDevice &cur_device = layout.swap_devices.back();
+    cur_device.first_slot = slots[i].offset;
+    device_processes.assign(processes.size(), false);
+    bool in_cluster = false;
+    uint64_t cur_cluster = 0;
+    for (; (i < e) && (slots[i].swap_type == cur_type); ++i) {
+      if (device_processes[slots[i].process_no] == false) {
+        device_processes[slots[i].process_no] = true;
+        ++cur_device.num_processes;
+      }
+      if ((i > 0) && (slots[i - 1].swap_type == cur_type)
+       && (slots[i - 1].offset == slots[i].offset)) {
+        continue;
+      }
+      ++cur_device.used_slots;
+      cur_device.last_slot = slots[i].offset;
+      if ((in_cluster == false)
+       || ((slots[i].offset >> layout.page_cluster) != cur_cluster)) {
+        in_cluster = true;
+        cur_cluster = slots[i].offset >> layout.page_cluster;
+        ++cur_device.num_clusters;
+      }
+    }
+  }
+  return layout;
+}
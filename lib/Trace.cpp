@@ -0,0 +1,184 @@
+//===- Trace.cpp ----------------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "Trace.h"
+#include "Diagnostics.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * A finished span. Times are stored in nanoseconds since the start of the
+ * trace.
+ */
+struct TraceEvent {
+  const char *name;
+  const char *arg_name;
+  std::string arg_str;
+  uint64_t arg_num;
+  bool numeric_arg;
+  uint64_t start_ns;
+  uint64_t duration_ns;
+};
+
+/**
+ * The events recorded by a single thread.
+ */
+struct TraceBuffer {
+  long thread_id;
+  std::vector<TraceEvent> events;
+};
+
+std::atomic<bool> Tracer::enabled(false);
+
+// All buffers ever created. They are owned here so that the events of exited
+// threads are kept until the trace is written.
+static std::mutex trace_buffers_mutex;
+static std::vector<std::unique_ptr<TraceBuffer>> trace_buffers;
+static std::chrono::steady_clock::time_point trace_start;
+
+/**
+ * \brief Returns the buffer of the calling thread. The buffer is created and
+ * \brief registered on the first call of each thread.
+ */
+static TraceBuffer& getThreadBuffer(void) {
+  static thread_local TraceBuffer *thread_buffer = nullptr;
+  if (thread_buffer == nullptr) {
+    std::unique_ptr<TraceBuffer> new_buffer(new TraceBuffer());
+    new_buffer->thread_id = syscall(SYS_gettid);
+    new_buffer->events.reserve(4096);
+    thread_buffer = new_buffer.get();
+    std::lock_guard<std::mutex> lock(trace_buffers_mutex);
+    trace_buffers.push_back(std::move(new_buffer));
+  }
+  return *thread_buffer;
+}
+
+/**
+ * \brief Writes the given string as JSON string literal.
+ */
+static void writeJSONString(std::ostream &stream, const std::string &str) {
+  stream << '"';
+  for (char cur_char : str) {
+    if ((cur_char == '"') || (cur_char == '\\')) {
+      stream << '\\' << cur_char;
+    } else if (static_cast<unsigned char>(cur_char) < 0x20) {
+      stream << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+             << static_cast<unsigned>(cur_char) << std::dec;
+    } else {
+      stream << cur_char;
+    }
+  }
+  stream << '"';
+}
+
+//===- Tracer class -------------------------------------------------------===//
+
+void Tracer::enable(void) {
+  trace_start = std::chrono::steady_clock::now();
+  enabled = true;
+}
+
+/**
+ * \brief Writes all recorded spans to the given file.
+ *
+ * Must only be called when no other thread is recording anymore. Returns
+ * \c false if the file could not be written.
+ */
+bool Tracer::write(const std::string &path) {
+  std::ofstream trace_file(path);
+  if (trace_file.is_open() == false) {
+    errs() << "Could not open trace file " << path << std::endl;
+    return false;
+  }
+  const long process_id = getpid();
+  trace_file << std::fixed << std::setprecision(3);
+  trace_file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl;
+  bool first_event = true;
+  std::lock_guard<std::mutex> lock(trace_buffers_mutex);
+  for (const std::unique_ptr<TraceBuffer> &cur_buffer : trace_buffers) {
+    // Name the threads so that the viewers show them in a stable order
+    trace_file << (first_event ? "" : ",\n")
+               << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": "
+               << process_id << ", \"tid\": " << cur_buffer->thread_id
+               << ", \"args\": {\"name\": \""
+               << ((cur_buffer->thread_id == process_id) ? "main" : "worker")
+               << "\"}}";
+    first_event = false;
+    for (const TraceEvent &cur_event : cur_buffer->events) {
+      trace_file << ",\n{\"name\": \"" << cur_event.name
+                 << "\", \"cat\": \"lsmmap\", \"ph\": \"X\", \"ts\": "
+                 << (cur_event.start_ns / 1000.0) << ", \"dur\": "
+                 << (cur_event.duration_ns / 1000.0) << ", \"pid\": "
+                 << process_id << ", \"tid\": " << cur_buffer->thread_id;
+      if (cur_event.arg_name != nullptr) {
+        trace_file << ", \"args\": {\"" << cur_event.arg_name << "\": ";
+        if (cur_event.numeric_arg == true) {
+          trace_file << cur_event.arg_num;
+        } else {
+          writeJSONString(trace_file, cur_event.arg_str);
+        }
+        trace_file << "}";
+      }
+      trace_file << "}";
+    }
+  }
+  trace_file << std::endl << "]}" << std::endl;
+  if (trace_file.good() == false) {
+    errs() << "Could not write trace file " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//===- TraceSpan class ----------------------------------------------------===//
+
+TraceSpan::TraceSpan(const char *spanname)
+ : name(spanname), arg_name(nullptr), arg_num(0), numeric_arg(false),
+   active(Tracer::isEnabled()) {
+  if (active == true) {
+    start = std::chrono::steady_clock::now();
+  }
+}
+
+TraceSpan::TraceSpan(const char *spanname, const char *argname,
+    const std::string &argvalue)
+ : name(spanname), arg_name(argname), arg_num(0), numeric_arg(false),
+   active(Tracer::isEnabled()) {
+  if (active == true) {
+    arg_str = argvalue;
+    start = std::chrono::steady_clock::now();
+  }
+}
+
+TraceSpan::TraceSpan(const char *spanname, const char *argname, uint64_t argvalue)
+ : name(spanname), arg_name(argname), arg_num(argvalue), numeric_arg(true),
+   active(Tracer::isEnabled()) {
+  if (active == true) {
+    start = std::chrono::steady_clock::now();
+  }
+}
+
+TraceSpan::~TraceSpan(void) {
+  if (active == false) {
+    return;
+  }
+  const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  TraceEvent event;
+  event.name = name;
+  event.arg_name = arg_name;
+  event.arg_str.swap(arg_str);
+  event.arg_num = arg_num;
+  event.numeric_arg = numeric_arg;
+  event.start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      start - trace_start).count();
+  event.duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      end - start).count();
+  getThreadBuffer().events.push_back(std::move(event));
+}
@@ -0,0 +1,280 @@
+//===- Translate.cpp ------------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "Translate.h"
+#include "Diagnostics.h"
+#include "Output.h"
+#include "PMemory.h"
+#include "Stats.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <numeric>
+#include <sstream>
+#include <unistd.h>
+
+// Number of pagemap entries described by one page table. The requests for
+// pages of the same page table are served by a single read.
+static const size_t entries_per_table = 512;
+// Requests whose pages are further apart are served by separate reads even
+// if they belong to the same page table
+static const uint64_t max_entry_gap = 32;
+// Maximal number of requests translated at once
+static const size_t max_batch_size = 4096;
+
+TranslationRequest::TranslationRequest(const std::string &pid, uint64_t address)
+ : process_id(pid), virt_address(address) {
+}
+
+/**
+ * \brief Parses a single translation request.
+ *
+ * A request consists of a process id and a hexadecimal virtual address
+ * separated by white space (e.g. "1234 0x7ffd1234"). Returns \c false if the
+ * line is not a valid request.
+ */
+bool parseTranslationRequest(const std::string &line, TranslationRequest &request) {
+  std::istringstream line_stream(line);
+  std::string pid, address, remainder;
+  line_stream >> pid >> address;
+  if ((line_stream.fail() == true) || (line_stream >> remainder)) {
+    return false;
+  }
+  unsigned long virt_address = 0;
+  if ((isPID(pid) == false) || (str2ulong(address, &virt_address, 16) == false)) {
+    return false;
+  }
+  request.process_id = pid;
+  request.virt_address = virt_address;
+  return true;
+}
+
+AddressTranslation::AddressTranslation(const TranslationRequest &request,
+    uint64_t page_address)
+ : process_id(request.process_id), virt_address(request.virt_address),
+   vpage(page_address), status(Status::ReadError) {
+}
+
+/**
+ * \brief Returns the physical address of the translated address if its page
+ * \brief is backed by the frame starting at \c frame_address.
+ */
+uint64_t AddressTranslation::getPhysAddress(uint64_t frame_address) const {
+  return frame_address + (virt_address - vpage.getStartAddress());
+}
+
+//===- AddressTranslator functions ----------------------------------------===//
+
+AddressTranslator::AddressTranslator(const std::string &procroot)
+ : proc_root(procroot), page_size(sysconf(_SC_PAGESIZE)) {
+}
+
+AddressTranslator::~AddressTranslator(void) {
+  closePageMapFiles();
+}
+
+/**
+ * \brief Returns the open pagemap file of the given process or -1 if it
+ * \brief cannot be opened.
+ */
+int AddressTranslator::getPageMapFD(const std::string &pid) {
+  std::map<std::string, int>::const_iterator fd_it = pagemap_fds.find(pid);
+  if (fd_it != pagemap_fds.end()) {
+    return fd_it->second;
+  }
+  const std::string pagemap_filepath(proc_root + "/" + pid + "/pagemap");
+  const int pagemap_fd = open(pagemap_filepath.c_str(), O_RDONLY);
+  ScanStats::count(ScanStats::Counter::Syscalls);
+  if (pagemap_fd == -1) {
+    return -1;
+  }
+  pagemap_fds[pid] = pagemap_fd;
+  return pagemap_fd;
+}
+
+void AddressTranslator::closePageMapFD(const std::string &pid) {
+  std::map<std::string, int>::iterator fd_it = pagemap_fds.find(pid);
+  if (fd_it != pagemap_fds.end()) {
+    close(fd_it->second);
+    ScanStats::count(ScanStats::Counter::Syscalls);
+    pagemap_fds.erase(fd_it);
+  }
+}
+
+void AddressTranslator::closePageMapFiles(void) {
+  for (const std::pair<const std::string, int> &cur_fd : pagemap_fds) {
+    close(cur_fd.second);
+  }
+  ScanStats::count(ScanStats::Counter::Syscalls, pagemap_fds.size());
+  pagemap_fds.clear();
+}
+
+/**
+ * \brief Reads \c num_pages consecutive pagemap entries starting with the
+ * \brief entry of page \c first_page.
+ *
+ * A pagemap file kept open from an earlier batch may belong to a process
+ * that exited in the meantime. If reading fails the file is therefore opened
+ * again once.
+ */
+bool AddressTranslator::readPageMapEntries(const std::string &pid,
+    uint64_t first_page, size_t num_pages, uint64_t *entries) {
+  const size_t num_bytes = num_pages * sizeof(uint64_t);
+  for (unsigned attempt = 0; attempt < 2; ++attempt) {
+    const int pagemap_fd = getPageMapFD(pid);
+    if (pagemap_fd == -1) {
+      return false;
+    }
+    const ssize_t read_bytes = pread(pagemap_fd, entries, num_bytes,
+        first_page * sizeof(uint64_t));
+    ScanStats::count(ScanStats::Counter::Syscalls);
+    if (read_bytes == static_cast<ssize_t>(num_bytes)) {
+      ScanStats::count(ScanStats::Counter::BytesRead, read_bytes);
+      ScanStats::count(ScanStats::Counter::Pages, num_pages);
+      return true;
+    }
+    closePageMapFD(pid);
+  }
+  return false;
+}
+
+/**
+ * \brief Translates the given requests.
+ *
+ * Returns one translation per request in the order of \c requests.
+ */
+std::vector<AddressTranslation> AddressTranslator::translate(
+    const std::vector<TranslationRequest> &requests) {
+  TraceSpan span("AddressTranslator::translate", "requests",
+      static_cast<uint64_t>(requests.size()));
+  std::vector<AddressTranslation> translations;
+  translations.reserve(requests.size());
+  for (const TranslationRequest &cur_request : requests) {
+    translations.push_back(AddressTranslation(cur_request,
+        cur_request.virt_address & ~(page_size - 1)));
+  }
+
+  // Group the requests by process and sort them by their pagemap offset
+  std::vector<size_t> order(requests.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&requests](size_t lhs, size_t rhs) {
+        const int pid_cmp = requests[lhs].process_id.compare(requests[rhs].process_id);
+        if (pid_cmp != 0) {
+          return pid_cmp < 0;
+        }
+        return requests[lhs].virt_address < requests[rhs].virt_address;
+      });
+
+  uint64_t entries[entries_per_table];
+  size_t i = 0;
+  const size_t e = order.size();
+  while (i < e) {
+    const std::string &cur_pid = requests[order[i]].process_id;
+    const uint64_t first_page = requests[order[i]].virt_address / page_size;
+    // Processes that cannot be opened are skipped as a whole
+    if (getPageMapFD(cur_pid) == -1) {
+      for (; (i < e) && (requests[order[i]].process_id == cur_pid); ++i) {
+        translations[order[i]].status = AddressTranslation::Status::NoProcess;
+      }
+      continue;
+    }
+    // Collect all requests served by the same page table that are close
+    // enough to each other
+    size_t j = i + 1;
+    uint64_t last_page = first_page;
+    for (; j < e; ++j) {
+      const TranslationRequest &cur_request = requests[order[j]];
+      const uint64_t cur_page = cur_request.virt_address / page_size;
+      if ((cur_request.process_id != cur_pid)
+       || ((cur_page / entries_per_table) != (first_page / entries_per_table))
+       || ((cur_page - last_page) > max_entry_gap)) {
+        break;
+      }
+      last_page = cur_page;
+    }
+    const bool entries_read = readPageMapEntries(cur_pid, first_page,
+        last_page - first_page + 1, entries);
+    for (; i < j; ++i) {
+      AddressTranslation &cur_translation = translations[order[i]];
+      if (entries_read == true) {
+        const uint64_t cur_page = cur_translation.virt_address / page_size;
+        cur_translation.vpage.setRawPageProperties(entries[cur_page - first_page], true);
+        cur_translation.status = AddressTranslation::Status::Translated;
+      } else {
+        cur_translation.status = AddressTranslation::Status::ReadError;
+      }
+    }
+  }
+  return translations;
+}
+
+/**
+ * \brief Reads translation requests from \c in and writes the translations
+ * \brief to \c out.
+ *
+ * Each line of the input holds one request (see \c parseTranslationRequest).
+ * Empty lines and lines starting with '#' are ignored. The requests are
+ * translated in batches: a batch is complete if no further input is buffered
+ * or if it reached its maximal size. So interactive clients get their answer
+ * immediately while piped input is translated in large batches. The output is
+ * flushed after each batch. Returns \c false if reading the input failed.
+ */
+bool translateAddresses(const CmdOptions &cmd_opts, std::istream &in,
+    std::ostream &out) {
+  AddressTranslator translator(cmd_opts.cmd_proc_root);
+  std::vector<TranslationRequest> requests;
+  TranslationRequest cur_request("", 0);
+  std::string cur_line;
+  uint64_t cur_line_no = 0;
+  while (in.good() == true) {
+    requests.clear();
+    while ((requests.size() < max_batch_size)
+        && (std::getline(in, cur_line).fail() == false)) {
+      ++cur_line_no;
+      const size_t first_char = cur_line.find_first_not_of(" \t\r");
+      if ((first_char != std::string::npos) && (cur_line[first_char] != '#')) {
+        if (parseTranslationRequest(cur_line, cur_request) == true) {
+          requests.push_back(cur_request);
+        } else {
+          errs() << "Ignoring invalid translation request in line "
+                 << cur_line_no << ": " << cur_line << std::endl;
+        }
+      }
+      if (in.rdbuf()->in_avail() <= 0) {
+        break;
+      }
+    }
+    if (requests.empty() == true) {
+      continue;
+    }
+
+    std::vector<AddressTranslation> translations;
+    {
+      ScanStats::PhaseTimer timer(ScanStats::Phase::PagemapReads);
+      translations = translator.translate(requests);
+    }
+    // Only the frames of pages present in RAM are read
+    std::vector<uint64_t> frames;
+    for (const AddressTranslation &cur_translation : translations) {
+      if ((cur_translation.status == AddressTranslation::Status::Translated)
+       && (cur_translation.vpage.isPresentRAM() == true)
+       && (cur_translation.vpage.getFrameNumber() != 0)) {
+        frames.push_back(cur_translation.vpage.getFrameNumber());
+      }
+    }
+    std::sort(frames.begin(), frames.end());
+    frames.erase(std::unique(frames.begin(), frames.end()), frames.end());
+    PMemory pmem;
+    if (frames.empty() == false) {
+      ScanStats::PhaseTimer timer(ScanStats::Phase::FrameReads);
+      pmem.addPFrames(cmd_opts, frames.begin(), frames.end());
+    }
+    {
+      ScanStats::PhaseTimer timer(ScanStats::Phase::Output);
+      printTranslations(cmd_opts, out, translations, pmem);
+      out.flush();
+    }
+  }
+  return in.bad() == false;
+}
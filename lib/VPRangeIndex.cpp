@@ -0,0 +1,130 @@
+//===- VPRangeIndex.cpp ---------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "VPRangeIndex.h"
+
+#include <algorithm>
+#include <numeric>
+
+const size_t VPRangeIndex::npos;
+
+VPRangeIndex::VPRangeIndex(void) {
+}
+
+/**
+ * \brief Indexes the given ranges.
+ *
+ * The ranges must be sorted by their addresses and must not overlap (which is
+ * the case for the ranges of a \c Process). Any previous content of the index
+ * is discarded.
+ */
+void VPRangeIndex::build(const std::vector<VPageRange> &vp_ranges) {
+  clear();
+  first_addresses.reserve(vp_ranges.size());
+  next_addresses.reserve(vp_ranges.size());
+  positions.reserve(vp_ranges.size());
+  for (size_t i = 0, e = vp_ranges.size(); i < e; ++i) {
+    if (vp_ranges[i].getMappingType() == VPageRange::MappingType::Unmapped) {
+      continue;
+    }
+    first_addresses.push_back(vp_ranges[i].getFirstAddress());
+    next_addresses.push_back(vp_ranges[i].getNextAddress());
+    positions.push_back(i);
+  }
+}
+
+void VPRangeIndex::clear(void) {
+  first_addresses.clear();
+  next_addresses.clear();
+  positions.clear();
+}
+
+bool VPRangeIndex::empty(void) const {
+  return positions.empty();
+}
+
+size_t VPRangeIndex::size(void) const {
+  return positions.size();
+}
+
+/**
+ * \brief Returns the position of the range containing \c address or
+ * \brief \c npos if no indexed range contains it.
+ */
+size_t VPRangeIndex::find(uint64_t address) const {
+  // The first range starting after the address follows the wanted one
+  std::vector<uint64_t>::const_iterator range_it =
+      std::upper_bound(first_addresses.begin(), first_addresses.end(), address);
+  if (range_it == first_addresses.begin()) {
+    return npos;
+  }
+  const size_t i = (range_it - first_addresses.begin()) - 1;
+  if (address >= next_addresses[i]) {
+    return npos;
+  }
+  return positions[i];
+}
+
+/**
+ * \brief Returns the positions of all ranges overlapping the address window
+ * \brief [\c lower_address, \c upper_address) in ascending order.
+ */
+std::vector<size_t> VPRangeIndex::findWindow(uint64_t lower_address,
+    uint64_t upper_address) const {
+  std::vector<size_t> found;
+  if (lower_address >= upper_address) {
+    return found;
+  }
+  // The ranges are sorted and do not overlap, so their ends are sorted too
+  const size_t first = std::upper_bound(next_addresses.begin(),
+      next_addresses.end(), lower_address) - next_addresses.begin();
+  const size_t last = std::lower_bound(first_addresses.begin(),
+      first_addresses.end(), upper_address) - first_addresses.begin();
+  for (size_t i = first; i < last; ++i) {
+    found.push_back(positions[i]);
+  }
+  return found;
+}
+
+/**
+ * \brief Looks up many addresses at once.
+ *
+ * Returns the position of the containing range (or \c npos) for each of the
+ * given addresses in the order of \c addresses. The addresses are visited in
+ * ascending order so that the index is swept once instead of being searched
+ * from scratch for each address.
+ */
+std::vector<size_t> VPRangeIndex::findBatch(
+    const std::vector<uint64_t> &addresses) const {
+  std::vector<size_t> found(addresses.size(), npos);
+  // Determine the order in which the addresses are visited. Sorted input (the
+  // common case for symbolizers) does not need to be sorted again.
+  std::vector<size_t> order;
+  const bool sorted_input = std::is_sorted(addresses.begin(), addresses.end());
+  if (sorted_input == false) {
+    order.resize(addresses.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&addresses](size_t lhs, size_t rhs) {
+      return addresses[lhs] < addresses[rhs];
+    });
+  }
+
+  size_t cur_range = 0;
+  const size_t num_ranges = positions.size();
+  for (size_t i = 0, e = addresses.size(); i < e; ++i) {
+    const size_t cur_index = (sorted_input == true) ? i : order[i];
+    const uint64_t cur_address = addresses[cur_index];
+    // Skip all ranges ending before the current address. As the addresses
+    // are ascending these ranges cannot contain any of the following ones.
+    while ((cur_range < num_ranges) && (next_addresses[cur_range] <= cur_address)) {
+      ++cur_range;
+    }
+    if (cur_range == num_ranges) {
+      break;
+    }
+    if (cur_address >= first_addresses[cur_range]) {
+      found[cur_index] = positions[cur_range];
+    }
+  }
+  return found;
+}
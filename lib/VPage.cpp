@@ -2,11 +2,18 @@
 //===----------------------------------------------------------------------===//
 
 #include "VPage.h"
+#include "Diagnostics.h"
+#include "Stats.h"
+#include "Trace.h"
 
+#include <algorithm>
 #include <climits>
 #include <fcntl.h>
 #include <iostream>
 #include <iomanip>
+#include <limits>
+#include <unistd.h>
+#include <utility>
 
 VPage::VPage(uint64_t startaddress)
  : page_props(0), page_props_valid(false), start_address(startaddress) {
@@ -39,43 +46,35 @@ void VPage::setRawPageProperties(uint64_t new_props, bool valid) {
 }
 
 bool VPage::isPresentRAM(void) const {
-  // Since 2.6.25
-  return ((page_props & 0x8000000000000000) != 0);
+  return PagemapEntry::isPresentRAM(page_props);
 }
 
 bool VPage::isPresentSwap(void) const {
-  // Since 2.6.25
-  return ((page_props & 0x4000000000000000) != 0);
+  return PagemapEntry::isPresentSwap(page_props);
 }
 
 bool VPage::isFileMapped(void) const {
-  // Since 3.5
-  return ((page_props & 0x2000000000000000) != 0);
+  return PagemapEntry::isFileMapped(page_props);
 }
 
 bool VPage::isSoftDirty(void) const {
-  // Since 2.6.25
-  return ((page_props & 0x0080000000000000) != 0);
+  return PagemapEntry::isSoftDirty(page_props);
 }
 
 bool VPage::isExclusive(void) const {
-  // Since 4.2
-  return ((page_props & 0x0100000000000000) != 0);
+  return PagemapEntry::isExclusive(page_props);
 }
 
 uint64_t VPage::getFrameNumber(void) const {
-  // Since 2.6.25
-  return (page_props & 0x007FFFFFFFFFFFFF);
+  return PagemapEntry::getFrameNumber(page_props);
 }
 
 uint8_t VPage::getSwapType(void) const {
-  // Since 2.6.25
-  return static_cast<uint8_t>((page_props & 0x000000000000001F));
+  return PagemapEntry::getSwapType(page_props);
 }
 
 uint64_t VPage::getSwapOffset(void) const {
-  // Since 2.6.25
-  return ((page_props & 0x007FFFFFFFFFFFE0) >> 5);
+  return PagemapEntry::getSwapOffset(page_props);
 }
 
 std::ostream& operator<<(std::ostream &stream, const VPage &page) {
@@ -157,7 +156,7 @@ std::ostream& operator<<(std::ostream &stream, const VPage &page) {
  */
 VPageRange::VPageRange(uint64_t firstaddress, uint64_t nextaddress, long pagesize)
  : map_ty(MappingType::Unmapped), first_address(firstaddress),
-   next_address(nextaddress), mapped_file_path(""), map_offset(0),
+   next_address(nextaddress), mapped_file_id(PathTable::empty_path), map_offset(0),
    page_size(pagesize), perm_canread(TriState::Unknown),
    perm_canwrite(TriState::Unknown), perm_canexec(TriState::Unknown),
    perm_isprivate(TriState::Unknown), range_no(0) {
@@ -209,16 +208,27 @@ void VPageRange::setMappingType(VPageRange::MappingType newtype) {
  * \brief Returns the path to the mapped file.
  * \note The path will only be valid if the range is file mapped.
  */
-std::string VPageRange::getMappedFilePath(void) const {
-  return mapped_file_path;
+const std::string& VPageRange::getMappedFilePath(void) const {
+  return PathTable::getShared().getPath(mapped_file_id);
+}
+
+/**
+ * \brief Returns the id of the mapped file within the shared path table.
+ * \brief Ranges that map the same file share the same id.
+ */
+PathTable::PathID VPageRange::getMappedFileID(void) const {
+  return mapped_file_id;
 }
 
 /**
  * \brief Sets the file mapped by the pages contained in the range.
  * \param path The path to the mapped file.
+ *
+ * The path is interned in the shared path table so each distinct path is
+ * stored only once no matter how many ranges map it.
  */
 void VPageRange::setMappedFilePath(const std::string &path) {
-  mapped_file_path = path;
+  mapped_file_id = PathTable::getShared().intern(path);
 }
 
 uint64_t VPageRange::getMappingOffset(void) const {
@@ -323,6 +333,57 @@ const VPageRange::VP_List_Ty& VPageRange::getVPages(void) const {
   return v_pages;
 }
 
+/**
+ * \brief Discards the pages of the range and frees their memory.
+ */
+void VPageRange::releaseVPages(void) {
+  VP_List_Ty().swap(v_pages);
+}
+
+/**
+ * \brief Makes the range take its pages from \c arena, or from the heap if
+ * \brief \c arena is null. The pages of another arena are released.
+ */
+void VPageRange::setPageArena(Arena *arena) {
+  if (v_pages.get_allocator().arena != arena) {
+    VP_List_Ty(ArenaAllocator<VPage>(arena)).swap(v_pages);
+  }
+}
+
+/**
+ * \brief Replaces the pages of the range.
+ * \param pages The pages that were read elsewhere (e.g. from a snapshot).
+ */
+void VPageRange::setVPages(const VP_List_Ty &pages) {
+  v_pages = pages;
+}
+
+/**
+ * \brief Replaces the pages of the range by taking over the given pages.
+ */
+void VPageRange::setVPages(VP_List_Ty &&pages) {
+  v_pages = std::move(pages);
+}
+
+/**
+ * \brief Limits the range to the interval from \c lower_address to
+ * \brief \c upper_address (exclusive).
+ *
+ * Both addresses must be aligned to the page size. The mapping offset is
+ * moved along with the first address so it still refers to the first page.
+ * The pages of the range are released.
+ */
+void VPageRange::clip(uint64_t lower_address, uint64_t upper_address) {
+  if (lower_address > first_address) {
+    map_offset += lower_address - first_address;
+    first_address = lower_address;
+  }
+  if (upper_address < next_address) {
+    next_address = std::max(upper_address, first_address);
+  }
+  releaseVPages();
+}
+
 /**
  * \brief Populates the range with pages.
  * \param fd The file descriptor of the file to read page information from.
@@ -332,8 +393,23 @@ const VPageRange::VP_List_Ty& VPageRange::getVPages(void) const {
  * described by \c fd. This function does not close the file.
  */
 size_t VPageRange::populatePages(const int fd, const CmdOptions &cmd_opts) {
+  return populatePages(fd, cmd_opts, 0, std::numeric_limits<uint64_t>::max());
+}
+
+/**
+ * \brief Populates the range with a window of its pages.
+ * \param first_page The index of the first page of the window.
+ * \param max_pages The maximal number of pages of the window.
+ *
+ * Works like \c populatePages(fd, cmd_opts) but only creates the pages of the
+ * given window. The pages of a previously populated window are discarded.
+ * This allows to walk huge ranges with a bounded amount of memory.
+ */
+size_t VPageRange::populatePages(const int fd, const CmdOptions &cmd_opts,
+    uint64_t first_page, uint64_t max_pages) {
+  TraceSpan span("VPageRange::populatePages", "first_address", first_address);
   // Store format flags for clog
-  std::ios_base::fmtflags original_clog_flags = std::clog.flags();
+  std::ios_base::fmtflags original_clog_flags = logs().flags();
   // Ignore unmapped ranges
   if (map_ty == MappingType::Unmapped) {
     return 0;
@@ -343,54 +419,80 @@ size_t VPageRange::populatePages(const int fd, const CmdOptions &cmd_opts) {
     return 0;
   }
   // Compute start and end addresses that are aligned to page size
-  const uint64_t aligned_low_addr = first_address & (~(page_size - 1));
+  const uint64_t aligned_first_addr = first_address & (~(page_size - 1));
   uint64_t tmp_addr = next_address & (page_size - 1);
   if (tmp_addr == 0) {
     tmp_addr = next_address;
   } else {
     tmp_addr = (next_address + page_size) & (~(page_size - 1));
   }
-  const uint64_t aligned_up_addr = tmp_addr;
-
+  // Restrict the addresses to the requested window
+  const uint64_t range_pages = (tmp_addr - aligned_first_addr) / page_size;
   v_pages.clear();
+  if (first_page >= range_pages) {
+    return 0;
+  }
+  const uint64_t window_pages = std::min(max_pages, range_pages - first_page);
+  const uint64_t aligned_low_addr = aligned_first_addr + first_page * page_size;
+  const uint64_t aligned_up_addr = aligned_low_addr + window_pages * page_size;
+  // The number of pages is known upfront so the list is allocated only once
+  v_pages.reserve(window_pages);
+
   // Compute the proper first seek position within the pagemap file
   const off_t pm_vpr_offset = (aligned_low_addr / page_size) * (64 / CHAR_BIT);
   if (cmd_opts.cmd_verbose == true) {
-    std::clog << "Trying to position reader in pagemap file at offset "
+    logs() << "Reading pagemap file from offset "
               << std::hex << std::uppercase << "0x" << pm_vpr_offset
               << " for address " << "0x" << aligned_low_addr << std::endl;
   }
-  // Now seek to the position
-  if (lseek(fd, pm_vpr_offset, SEEK_SET) == -1) {
-    std::cerr << "Failed to position in pagemap file." << std::endl;
-    perror("lseek:");
-    return 0;
-  }
-  // Create the pages
-  for (uint64_t cur_addr = aligned_low_addr; cur_addr < aligned_up_addr;
-      cur_addr += page_size) {
-    // We do not have to seek again as the read command increments the file
-    // offset by the number of bytes read
-    uint64_t page_descriptor = 0;
-    ssize_t read_bytes = read(fd, &page_descriptor, sizeof(page_descriptor));
+  // Create the pages. The entries are read in chunks to avoid issuing one
+  // read call per page. A short read marks all remaining pages as invalid.
+  const uint64_t num_pages = (aligned_up_addr - aligned_low_addr) / page_size;
+  const uint64_t max_chunk_entries = 4096;
+  std::vector<uint64_t> page_descriptors(std::min(num_pages, max_chunk_entries));
+  uint64_t cur_addr = aligned_low_addr;
+  off_t cur_offset = pm_vpr_offset;
+  bool read_failed = false;
+  while ((cur_addr < aligned_up_addr) && (read_failed == false)) {
+    const uint64_t cur_chunk_entries =
+        std::min((aligned_up_addr - cur_addr) / page_size, max_chunk_entries);
+    const size_t cur_chunk_bytes = cur_chunk_entries * sizeof(uint64_t);
+    ssize_t read_bytes = pread(fd, page_descriptors.data(), cur_chunk_bytes,
+                               cur_offset);
+    ScanStats::count(ScanStats::Counter::Syscalls);
     if (read_bytes == -1) {
-      std::cerr << "Could not properly read from pagemap file!" << std::endl;
-      perror("read:");
+      errs() << "Could not properly read from pagemap file!" << std::endl;
+      printSystemError("read:");
       break;
-    } else if (read_bytes == sizeof(page_descriptor)) {
-      VPage cur_page(cur_addr);
-      cur_page.setRawPageProperties(page_descriptor, true);
-      v_pages.push_back(cur_page);
-    } else {
-      VPage cur_page(cur_addr);
-      cur_page.setRawPageProperties(0, false);
-      v_pages.push_back(cur_page);
     }
-    VPage cur_page(cur_addr);
+    ScanStats::count(ScanStats::Counter::BytesRead, read_bytes);
+    const uint64_t valid_entries = read_bytes / sizeof(uint64_t);
+    for (uint64_t i = 0; i < cur_chunk_entries; ++i) {
+      v_pages.emplace_back(cur_addr);
+      if (i < valid_entries) {
+        v_pages.back().setRawPageProperties(page_descriptors[i], true);
+      } else {
+        v_pages.back().setRawPageProperties(0, false);
+      }
+      cur_addr += page_size;
+    }
+    if (valid_entries < cur_chunk_entries) {
+      // Mark the remaining pages as invalid without trying to read them
+      for (; cur_addr < aligned_up_addr; cur_addr += page_size) {
+        v_pages.emplace_back(cur_addr);
+        v_pages.back().setRawPageProperties(0, false);
+      }
+      read_failed = true;
+    }
+    cur_offset += cur_chunk_bytes;
   }
 
-  // Restore format flags of clog
-  std::clog.flags(original_clog_flags);
+  // Restore format flags of clog. They are only changed in verbose mode and
+  // restoring them unconditionally would race with other scanning threads.
+  if (cmd_opts.cmd_verbose == true) {
+    logs().flags(original_clog_flags);
+  }
+  ScanStats::count(ScanStats::Counter::Pages, v_pages.size());
   return v_pages.size();
 }
 
@@ -0,0 +1,158 @@
+//===- Watch.cpp ----------------------------------------------------------===//
+//===----------------------------------------------------------------------===//
+
+#include "Watch.h"
+
+RangeDelta::RangeDelta(Status deltastatus, const VPageRange &range,
+    uint64_t oldresident, uint64_t newresident)
+ : status(deltastatus), vp_range(range), old_resident(oldresident),
+   new_resident(newresident) {
+}
+
+ProcessDelta::ProcessDelta(const std::string &pid)
+ : process_id(pid), exited(false) {
+}
+
+//===- Watcher class ------------------------------------------------------===//
+
+Watcher::Watcher(std::vector<Process> &&procs)
+ : processes(std::move(procs)), states(processes.size()), first_update(true) {
+}
+
+/**
+ * \brief Indicates if there are no processes left to watch.
+ */
+bool Watcher::empty(void) const {
+  return processes.empty();
+}
+
+/**
+ * \brief Counts the pages of a range that are present in RAM.
+ */
+static uint64_t countResidentPages(const VPageRange &vp_range) {
+  uint64_t resident = 0;
+  for (const VPage &cur_vpage : vp_range.getVPages()) {
+    if ((cur_vpage.arePagePropertiesValid() == true)
+     && (cur_vpage.isPresentRAM() == true)) {
+      ++resident;
+    }
+  }
+  return resident;
+}
+
+/**
+ * \brief Indicates if two ranges describe the same mapping.
+ */
+static bool isSameRange(const VPageRange &lhs, const VPageRange &rhs) {
+  return (lhs.getFirstAddress() == rhs.getFirstAddress())
+      && (lhs.getNextAddress() == rhs.getNextAddress())
+      && (lhs.getMappingType() == rhs.getMappingType());
+}
+
+/**
+ * \brief Rescans a single process and records its deltas.
+ */
+void Watcher::scanProcess(const CmdOptions &cmd_opts, Process &proc,
+    WatchState &state, ProcessDelta &delta) {
+  bool reparsed = false;
+  if (first_update == true) {
+    if (cmd_opts.cmd_prog_mode == CmdOptions::ProgMode::Pages) {
+      proc.populateMixedRange(cmd_opts);
+    } else {
+      proc.populateFileRanges(cmd_opts);
+    }
+    reparsed = true;
+  } else if (cmd_opts.cmd_prog_mode == CmdOptions::ProgMode::Mappings) {
+    reparsed = proc.refreshFileRanges(cmd_opts);
+  } else {
+    // The maps file is not read again for a window of pages, so a process
+    // that exited must be detected explicitly
+    proc.checkAlive();
+  }
+  if (proc.isAccessible() == false) {
+    delta.exited = true;
+    return;
+  }
+  // Freshly parsed ranges do not contain any pages yet so they are cheap to
+  // copy and can be used to report removed ranges later on
+  WatchState new_state;
+  if (reparsed == true) {
+    new_state.range_shapes = proc.getVPageRanges();
+  }
+  proc.populatePages(cmd_opts);
+  if (proc.isAccessible() == false) {
+    delta.exited = true;
+    return;
+  }
+  new_state.resident_counts.reserve(proc.getVPageRanges().size());
+  for (const VPageRange &cur_vpr : proc.getVPageRanges()) {
+    new_state.resident_counts.push_back(countResidentPages(cur_vpr));
+  }
+
+  if (reparsed == false) {
+    // The ranges did not change so only the resident counts are compared
+    for (size_t i = 0, e = state.range_shapes.size(); i < e; ++i) {
+      if (state.resident_counts[i] != new_state.resident_counts[i]) {
+        delta.range_deltas.push_back(RangeDelta(
+            RangeDelta::Status::ResidentChanged, state.range_shapes[i],
+            state.resident_counts[i], new_state.resident_counts[i]));
+      }
+    }
+    state.resident_counts.swap(new_state.resident_counts);
+    return;
+  }
+
+  // Merge the old and new ranges. Both are sorted by their addresses.
+  const std::vector<VPageRange> &old_shapes = state.range_shapes;
+  const std::vector<VPageRange> &new_shapes = new_state.range_shapes;
+  size_t i = 0, j = 0;
+  while ((i < old_shapes.size()) || (j < new_shapes.size())) {
+    if ((i < old_shapes.size()) && (j < new_shapes.size())
+     && (isSameRange(old_shapes[i], new_shapes[j]) == true)) {
+      if (state.resident_counts[i] != new_state.resident_counts[j]) {
+        delta.range_deltas.push_back(RangeDelta(
+            RangeDelta::Status::ResidentChanged, new_shapes[j],
+            state.resident_counts[i], new_state.resident_counts[j]));
+      }
+      ++i; ++j;
+    } else if ((j >= new_shapes.size())
+            || ((i < old_shapes.size())
+             && (old_shapes[i].getFirstAddress() <= new_shapes[j].getFirstAddress()))) {
+      delta.range_deltas.push_back(RangeDelta(RangeDelta::Status::Removed,
+          old_shapes[i], state.resident_counts[i], 0));
+      ++i;
+    } else {
+      delta.range_deltas.push_back(RangeDelta(RangeDelta::Status::Added,
+          new_shapes[j], 0, new_state.resident_counts[j]));
+      ++j;
+    }
+  }
+  state.range_shapes.swap(new_state.range_shapes);
+  state.resident_counts.swap(new_state.resident_counts);
+}
+
+/**
+ * \brief Rescans all watched processes.
+ *
+ * Returns the deltas of all processes whose ranges changed since the last
+ * call. On the first call all ranges are reported as added. Processes that
+ * exited are reported once and are not watched anymore.
+ */
+PDelta_List_Ty Watcher::update(const CmdOptions &cmd_opts) {
+  PDelta_List_Ty deltas;
+  for (size_t i = 0; i < processes.size(); ) {
+    ProcessDelta cur_delta(processes[i].getPID());
+    scanProcess(cmd_opts, processes[i], states[i], cur_delta);
+    if ((cur_delta.exited == true) || (cur_delta.range_deltas.empty() == false)) {
+      deltas.push_back(cur_delta);
+    }
+    if (cur_delta.exited == true) {
+      processes.erase(processes.begin() + i);
+      states.erase(states.begin() + i);
+      continue;
+    }
+    ++i;
+  }
+  first_update = false;
+  return deltas;
+}
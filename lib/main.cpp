@@ -1,13 +1,59 @@
 #include "CmdOptions.h"
+#include "Diagnostics.h"
 #include "Output.h"
-#include "PMemory.h"
-#include "Process.h"
+#include "Scanner.h"
+#include "Stats.h"
+#include "Trace.h"
 
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
-#include <limits>
-#include <string>
-#include <vector>
+
+/**
+ * \brief Answers the translation requests of the requests file or, if none
+ * \brief is given, of stdin.
+ */
+static bool runTranslation(Scanner &scanner) {
+  const CmdOptions &cmdopts = scanner.getOptions();
+  if (cmdopts.cmd_translate_path.empty() == true) {
+    // Lets the translator see how much input is already buffered
+    std::ios_base::sync_with_stdio(false);
+    return scanner.translate(std::cin, std::cout);
+  }
+  std::ifstream request_file(cmdopts.cmd_translate_path);
+  if (request_file.is_open() == false) {
+    errs() << "Could not open translation requests file "
+           << cmdopts.cmd_translate_path << std::endl;
+    return false;
+  }
+  return scanner.translate(request_file, std::cout);
+}
+
+/**
+ * \brief Runs the scan selected by the options and prints its results.
+ */
+static bool runScan(Scanner &scanner) {
+  switch (scanner.getMode()) {
+    case ScanMode::Translate:
+      return runTranslation(scanner);
+    case ScanMode::Watch:
+      return scanner.watch(
+          [&scanner](double timestamp, const PDelta_List_Ty &deltas) {
+        printWatchDeltas(scanner.getOptions(), std::cout, timestamp, deltas);
+      });
+    case ScanMode::Budget:
+      return scanner.scanWithinBudget(std::cout);
+    default:
+      break;
+  }
+  ScanResult result;
+  if (scanner.run(result) == false) {
+    return false;
+  }
+  ScanStats::PhaseTimer timer(ScanStats::Phase::Output);
+  printScanResult(scanner.getOptions(), std::cout, result);
+  return true;
+}
 
 int main(int argc, char *argv[]) {
   CmdOptions cmdopts;
@@ -19,79 +65,22 @@ int main(int argc, char *argv[]) {
    || (opts_parsed == CmdOptions::ErrorType::PID)) {
     exit(EXIT_FAILURE);
   }
-
-  // Validate pids and create process objects
-  std::vector<Process> processes;
-  for (CmdOptions::PID_List_Ty::iterator pid_it = cmdopts.cmd_req_pid.begin(),
-      pid_end = cmdopts.cmd_req_pid.end(); pid_it != pid_end; ) {
-    if ((str2ulong(*pid_it, nullptr, 10) == false)
-     && (pid_it->compare("self") != 0)) {
-      // Hmm, invalid iterator erase the pid
-      pid_it = cmdopts.cmd_req_pid.erase(pid_it);
-      pid_end = cmdopts.cmd_req_pid.end();
-      continue;
-    }
-    // Now try to create the process object. If any of the needed files the
-    // CTOR will throw an exception...
-    try {
-      Process cur_proc(*pid_it);
-      processes.push_back(cur_proc);
-    } catch(std::invalid_argument inv_arg_exc) {
-      std::cerr << "Skipping pid " << *pid_it << ": some needed files "
-                << "are not accessible!" << std::endl;
-      pid_it = cmdopts.cmd_req_pid.erase(pid_it);
-      pid_end = cmdopts.cmd_req_pid.end();
-      continue;
-    }
-    ++pid_it;
+  if (cmdopts.cmd_stats == true) {
+    ScanStats::enable();
   }
-
-  if (processes.size() <= 0) {
-    std::cerr << "No pids to process!" << std::endl;
-    exit(EXIT_FAILURE);
+  if (cmdopts.cmd_trace_path.empty() == false) {
+    Tracer::enable();
   }
 
-  // First gather information about page ranges and pages
-  for (Process &cur_proc : processes) {
-    if (cmdopts.cmd_prog_mode == CmdOptions::ProgMode::Mappings) {
-      cur_proc.populateFileRanges(cmdopts);
-      cur_proc.populatePages(cmdopts);
-    } else if (cmdopts.cmd_prog_mode == CmdOptions::ProgMode::Pages) {
-      cur_proc.populateMixedRange(cmdopts);
-      cur_proc.populatePages(cmdopts);
-    }
-  }
-  
-  // Now gather all required physical frames
-  std::vector<uint64_t> reqd_frames;
-  for (const Process &cur_proc : processes) {
-    for (const VPageRange &cur_vpr : cur_proc.getVPageRanges()) {
-      // Skip unmapped ranges as they should not require any valid frames
-      if (cur_vpr.getMappingType() == VPageRange::MappingType::Unmapped) {
-        continue;
-      }
+  Scanner scanner(cmdopts);
+  bool succeeded = runScan(scanner);
 
-      for (const VPage &cur_vpage : cur_vpr.getVPages()) {
-        if (cur_vpage.arePagePropertiesValid() == false) {
-          continue;
-        }
-        // Only present pages map to a valid frame
-        if (cur_vpage.isPresentRAM() == false) {
-          continue;
-        }
-        if (cur_vpage.getFrameNumber() == 0) {
-          continue;
-        }
-        // Page maps to a frame so add its frame to the list of required frames
-        reqd_frames.push_back(cur_vpage.getFrameNumber());
-      }
-    }
+  // Every mode ends the same way, also if its scan failed
+  if (cmdopts.cmd_stats == true) {
+    ScanStats::print(errs(), cmdopts.cmd_stats_json);
   }
-
-  // Now gather information about all required frames
-  PMemory pmem;
-  pmem.addPFrames(cmdopts, reqd_frames.begin(), reqd_frames.end());
-
-  printResults(cmdopts, std::cout, processes, pmem);
-  exit(EXIT_SUCCESS);
+  if (cmdopts.cmd_trace_path.empty() == false) {
+    succeeded &= Tracer::write(cmdopts.cmd_trace_path);
+  }
+  exit((succeeded == true) ? EXIT_SUCCESS : EXIT_FAILURE);
 }
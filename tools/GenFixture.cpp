@@ -0,0 +1,101 @@
+//===- GenFixture.cpp -----------------------------------------------------===//
+//
+// Generates a synthetic proc tree that can be read by lsmmap --proc-root.
+//
+// Usage:
+// lsmmap-fixture [ -p <procs> ] [ -m <vmas> ] [ -s <pages> ] [ -r <ratio> ]
+//                [ -t <ratio> ] [ -S <ratio> ] [ -x <seed> ] <directory>
+//
+//===----------------------------------------------------------------------===//
+
+#include "CmdOptions.h"
+#include "Fixture.h"
+
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+
+static void printUsage(std::ostream &stream) {
+  stream << "lsmmap-fixture - generates a synthetic proc tree" << std::endl
+         << std::endl;
+  stream << "Usage:" << std::endl
+         << "lsmmap-fixture [OPTIONS] DIRECTORY" << std::endl;
+  stream << std::endl;
+  stream << "OPTIONS:" << std::endl;
+  stream << "  -p n   Number of processes (default 1)." << std::endl;
+  stream << "  -m n   Number of ranges per process (default 16)." << std::endl;
+  stream << "  -s n   Number of pages per range (default 4096)." << std::endl;
+  stream << "  -r x   Ratio of pages present in RAM (default 0.5)." << std::endl;
+  stream << "  -t x   Ratio of 2 MiB blocks backed by transparent " << std::endl
+         << "         huge pages (default 0)." << std::endl;
+  stream << "  -S x   Ratio of ranges that are shared file mappings " << std::endl
+         << "         using the same frames in all processes " << std::endl
+         << "         (default 0)." << std::endl;
+  stream << "  -x n   Seed of the random number generator (default 1)." << std::endl;
+  stream << "  -h     Print this help message." << std::endl;
+}
+
+static bool parseRatio(const char *str, double &ratio) {
+  if ((str2double(str, &ratio) == false) || (ratio < 0.0) || (ratio > 1.0)) {
+    std::cerr << str << " is not a valid ratio!" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  FixtureConfig config;
+  bool valid_opts = true;
+  unsigned long value = 0;
+  int c;
+  while ((c = getopt(argc, argv, "hp:m:s:r:t:S:x:")) != -1) {
+    switch(c) {
+      case 'h':
+        printUsage(std::cout);
+        exit(EXIT_SUCCESS);
+        break;
+      case 'p':
+        valid_opts &= str2ulong(optarg, &value, 10);
+        config.num_processes = value;
+        break;
+      case 'm':
+        valid_opts &= str2ulong(optarg, &value, 10);
+        config.vmas_per_process = value;
+        break;
+      case 's':
+        valid_opts &= str2ulong(optarg, &value, 10);
+        config.pages_per_vma = value;
+        break;
+      case 'r':
+        valid_opts &= parseRatio(optarg, config.resident_ratio);
+        break;
+      case 't':
+        valid_opts &= parseRatio(optarg, config.thp_ratio);
+        break;
+      case 'S':
+        valid_opts &= parseRatio(optarg, config.shared_ratio);
+        break;
+      case 'x':
+        valid_opts &= str2ulong(optarg, &value, 10);
+        config.seed = value;
+        break;
+      default:
+        valid_opts = false;
+        break;
+    }
+  }
+  if ((valid_opts == false) || (optind + 1 != argc)) {
+    printUsage(std::cerr);
+    exit(EXIT_FAILURE);
+  }
+
+  FixtureSummary summary;
+  if (generateFixture(config, argv[optind], &summary) == false) {
+    exit(EXIT_FAILURE);
+  }
+  std::cout << "Generated " << summary.num_processes << " processes with "
+            << summary.num_ranges << " ranges, " << summary.num_pages
+            << " pages (" << summary.num_resident_pages << " resident) and "
+            << summary.num_frames << " frames in " << argv[optind] << std::endl;
+  exit(EXIT_SUCCESS);
+}